@@ -0,0 +1,69 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Blocking FIFO with a fixed capacity that connects a producer stage to a consumer stage.
+// Producers block while it is full and consumers while it is empty. close() ends the stream:
+// pending and later pushes fail, and consumers drain what is left before receiving nullopt.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : maxItems(capacity > 0 ? capacity : 1) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Returns false, dropping item, if the queue was closed.
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        notFull.wait(lock, [&]() { return closed || items.size() < maxItems; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Returns nullopt once the queue is closed and empty.
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        notEmpty.wait(lock, [&]() { return closed || !items.empty(); });
+        if (items.empty()) {
+            return std::nullopt;
+        }
+        T item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return item;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        return items.size();
+    }
+
+    size_t capacity() const { return maxItems; }
+
+private:
+    const size_t maxItems;
+    mutable std::mutex queueMutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::deque<T> items;
+    bool closed = false;
+};
+
+#endif // BOUNDED_QUEUE_HPP
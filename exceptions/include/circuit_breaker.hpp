@@ -0,0 +1,66 @@
+#ifndef CIRCUIT_BREAKER_HPP
+#define CIRCUIT_BREAKER_HPP
+
+#include "time_source.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+enum class BreakerState {
+    CLOSED,    // Every attempt goes through
+    OPEN,      // Attempts are rejected until the cooldown has passed
+    HALF_OPEN, // One probe attempt goes through; its outcome closes or reopens the breaker
+};
+
+struct CircuitBreakerStats {
+    uint64_t trips = 0;      // Times the breaker opened
+    uint64_t rejected = 0;   // Attempts refused while open or while a probe was outstanding
+    uint64_t probes = 0;     // Attempts let through half-open
+    uint64_t recoveries = 0; // Probes that closed the breaker again
+};
+
+// Circuit breaker over the outcomes of the last `window` attempts on one server. Closed, it opens once at
+// least half the window has been recorded and failurePercent of those outcomes were failures. Open, it refuses
+// attempts for cooldown, then lets a single probe through; a successful probe closes it with an empty window,
+// a failed one opens it for another cooldown. The cooldown runs on time. Thread-safe.
+class CircuitBreaker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // A window of 0 disables the breaker: every attempt is allowed and nothing is recorded.
+    CircuitBreaker(size_t window, int failurePercent, std::chrono::milliseconds cooldown, const TimeSource& time = TimeSource::real());
+
+    bool enabled() const { return !outcomes.empty(); }
+
+    // Whether an attempt may go ahead now. In HALF_OPEN only the first caller gets true, and that caller must
+    // record the outcome.
+    bool allowAttempt();
+    void recordSuccess();
+    void recordFailure();
+
+    // OPEN reads as HALF_OPEN once its cooldown has passed.
+    BreakerState state() const;
+    CircuitBreakerStats getStats() const;
+
+private:
+    void record(bool failed);
+    void open(Clock::time_point now);
+
+    const int failurePercent;
+    const std::chrono::milliseconds cooldown;
+    const TimeSource& time;
+
+    mutable std::mutex mutex;
+    std::vector<uint8_t> outcomes; // Ring of the last attempts, 1 for a failure
+    size_t nextOutcome = 0;
+    size_t recorded = 0;           // Valid entries in outcomes
+    size_t failures = 0;           // Failures among them
+    BreakerState current = BreakerState::CLOSED;
+    Clock::time_point reopenAt;    // When an OPEN breaker lets a probe through
+    bool probing = false;          // A HALF_OPEN probe is outstanding
+    CircuitBreakerStats stats;
+};
+
+#endif // CIRCUIT_BREAKER_HPP
@@ -5,6 +5,25 @@
 #include <vector>
 #include <unordered_map> 
 
+// How ConnectionManager reaches the servers
+enum class Transport {
+    SIMULATED, // Calls the in-process Server behind a simulated connect delay
+    TCP,       // Talks to kvserver processes over loopback TCP
+    SHARED_MEMORY, // Exchanges queries with kvserver processes through shared-memory rings set up over loopback TCP
+};
+
+// How requests and responses are encoded on a kvserver connection
+enum class WireProtocol {
+    TEXT,   // One line per message (kv_protocol.hpp)
+    BINARY, // Length-prefixed frames matched by queryId (kv_wire.hpp); TCP transport only
+};
+
+// Which server GETs go to while the primary is connected
+enum class ReadBalancing {
+    PRIMARY_ONLY,      // Every query goes to the primary; the backup only takes over on failover
+    LEAST_OUTSTANDING, // GETs go to the primary or the backup, whichever has fewer outstanding requests weighted by latency
+};
+
 // Structure to hold configuration parameters
 struct AppConfig {
     std::string primaryServerAddress;
@@ -13,9 +32,21 @@ struct AppConfig {
     int backupServerPort;
     int connectionRetries;
     int connectionTimeoutMs;
+    int clientCacheCapacity;           // 0 disables the client-side GET cache
+    int clientCacheValidationPercent;  // Share of cache hits checked against the server's key version
+    int poolSize;                      // Connections per server; 0 means one per hardware thread
+    int breakerWindow;                 // Primary connection attempts the circuit breaker looks back over; 0 disables it
+    int breakerFailurePercent;         // Share of failures in the window that opens the breaker
+    int breakerCooldownMs;             // How long an open breaker sends everything to the backup before probing
+    int connectRaceDelayMs;            // Head start of the primary before the backup is tried alongside it; 0 tries them one after the other
+    int hedgePercentile;               // GETs slower than this percentile of the primary's latency are also sent to the backup; 0 disables
+    int hedgeBudgetPercent;            // Most hedges as a share of GETs
+    ReadBalancing readBalancing;
+    Transport transport;
+    WireProtocol wireProtocol;
 
     // Default values (optional, but can be useful)
-    AppConfig() : primaryServerPort(0), backupServerPort(0), connectionRetries(3), connectionTimeoutMs(5000) {}
+    AppConfig() : primaryServerPort(0), backupServerPort(0), connectionRetries(3), connectionTimeoutMs(5000), clientCacheCapacity(0), clientCacheValidationPercent(0), poolSize(0), breakerWindow(8), breakerFailurePercent(50), breakerCooldownMs(1000), connectRaceDelayMs(0), hedgePercentile(0), hedgeBudgetPercent(5), readBalancing(ReadBalancing::PRIMARY_ONLY), transport(Transport::SIMULATED), wireProtocol(WireProtocol::TEXT) {}
 };
 
 class ConfigLoader {
@@ -0,0 +1,286 @@
+#ifndef CONNECTION_POOL_HPP
+#define CONNECTION_POOL_HPP
+
+#include "deadline.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+struct ConnectionPoolStats {
+    uint64_t checkouts = 0;
+    uint64_t affinityHits = 0; // Served by the connection the thread used last
+    uint64_t waits = 0;        // Found every connection busy and the pool full, and blocked
+    uint64_t opened = 0;       // Including replacements
+    uint64_t healthChecks = 0;
+    uint64_t replaced = 0;     // Idle connections that failed their health check
+};
+
+// Fixed-capacity pool of connections to one server, each used by one request at a time.
+// Checkout and return are lock-free: every slot has an atomic state that a thread claims with a CAS, trying
+// first the slot it used last so a worker keeps reusing the same connection. Slots are opened lazily, when
+// every open connection is busy. Only a checkout that finds the pool full and busy takes a lock, to sleep.
+// A connection idle for longer than healthCheckAfterIdle is checked before it is handed out and reopened
+// if the check fails.
+template <typename Resource>
+class ConnectionPool {
+public:
+    // Opens a new connection; throws on failure.
+    using Connector = std::function<std::unique_ptr<Resource>()>;
+    using HealthCheck = std::function<bool(const Resource&)>;
+
+    // Exclusive use of one pooled connection until destroyed.
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept : pool(std::exchange(other.pool, nullptr)), slot(other.slot) {}
+        Lease& operator=(Lease&& other) noexcept {
+            if (this != &other) {
+                release();
+                pool = std::exchange(other.pool, nullptr);
+                slot = other.slot;
+            }
+            return *this;
+        }
+        ~Lease() { release(); }
+
+        explicit operator bool() const { return pool != nullptr; }
+        // Closes the connection instead of returning it; its slot is reopened when next needed.
+        void discard() {
+            if (pool != nullptr) {
+                pool->discard(slot);
+                pool = nullptr;
+            }
+        }
+        Resource& operator*() const { return *pool->slots[slot].resource; }
+        Resource* operator->() const { return pool->slots[slot].resource.get(); }
+
+    private:
+        friend class ConnectionPool;
+        Lease(ConnectionPool* pool, size_t slot) : pool(pool), slot(slot) {}
+        void release() {
+            if (pool != nullptr) {
+                pool->checkin(slot);
+                pool = nullptr;
+            }
+        }
+
+        ConnectionPool* pool = nullptr;
+        size_t slot = 0;
+    };
+
+    // first, if given, is an already open connection that fills the first slot.
+    ConnectionPool(size_t capacity, Connector connect, HealthCheck healthCheck,
+        std::chrono::nanoseconds healthCheckAfterIdle = std::chrono::seconds(1), std::unique_ptr<Resource> first = nullptr)
+        : slotCount(std::max<size_t>(capacity, 1)), slots(new Slot[slotCount]), connect(std::move(connect)),
+        healthCheck(std::move(healthCheck)), healthCheckAfterIdle(healthCheckAfterIdle) {
+        if (first) {
+            slots[0].resource = std::move(first);
+            slots[0].lastReturned = Clock::now();
+            slots[0].state.store(IDLE, std::memory_order_release);
+            openCount.fetch_add(1, std::memory_order_relaxed);
+            counters.opened.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Blocks while every connection is busy and the pool is full. Returns an empty lease if the deadline
+    // passes or a stop is requested first. Rethrows the connector's error if a connection has to be opened and fails.
+    Lease checkout(const QueryDeadline& deadline = QueryDeadline{}) {
+        counters.checkouts.fetch_add(1, std::memory_order_relaxed);
+        Affinity& affinity = threadAffinity();
+        bool hasAffinity = affinity.poolId == poolId;
+        size_t preferred = hasAffinity ? affinity.slot : std::hash<std::thread::id>{}(std::this_thread::get_id()) % slotCount;
+
+        std::optional<Claim> claim = tryClaim(preferred);
+        if (!claim) {
+            counters.waits.fetch_add(1, std::memory_order_relaxed);
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+            std::unique_lock<std::mutex> lock(waitMutex);
+            // checkin() notifies under waitMutex, so no return can slip between a failed claim and the wait
+            while (!(claim = tryClaim(preferred))) {
+                if (deadline.expired()) {
+                    waiters.fetch_sub(1, std::memory_order_relaxed);
+                    return Lease();
+                }
+                // Bounded so a stop request is noticed without a return
+                auto wakeAt = std::min(deadline.expiresAt, Clock::now() + std::chrono::milliseconds(10));
+                wakeup.wait_until(lock, wakeAt);
+            }
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return grant(*claim, preferred, hasAffinity);
+    }
+
+    // Like checkout, but returns an empty lease at once instead of waiting when every connection is busy.
+    Lease tryCheckout() {
+        counters.checkouts.fetch_add(1, std::memory_order_relaxed);
+        Affinity& affinity = threadAffinity();
+        bool hasAffinity = affinity.poolId == poolId;
+        size_t preferred = hasAffinity ? affinity.slot : std::hash<std::thread::id>{}(std::this_thread::get_id()) % slotCount;
+
+        std::optional<Claim> claim = tryClaim(preferred);
+        if (!claim) {
+            return Lease();
+        }
+        return grant(*claim, preferred, hasAffinity);
+    }
+
+    size_t capacity() const { return slotCount; }
+    size_t openConnections() const { return openCount.load(std::memory_order_relaxed); }
+
+    ConnectionPoolStats getStats() const {
+        ConnectionPoolStats stats;
+        stats.checkouts = counters.checkouts.load(std::memory_order_relaxed);
+        stats.affinityHits = counters.affinityHits.load(std::memory_order_relaxed);
+        stats.waits = counters.waits.load(std::memory_order_relaxed);
+        stats.opened = counters.opened.load(std::memory_order_relaxed);
+        stats.healthChecks = counters.healthChecks.load(std::memory_order_relaxed);
+        stats.replaced = counters.replaced.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum SlotState : uint8_t {
+        EMPTY, // No connection yet, or the last one could not be reopened
+        IDLE,
+        BUSY,  // Leased, or being opened; resource and lastReturned belong to the holder
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<uint8_t> state{ EMPTY };
+        std::unique_ptr<Resource> resource;
+        Clock::time_point lastReturned;
+    };
+
+    struct Claim {
+        size_t slot;
+        bool needsOpen;
+    };
+
+    // The slot this thread last used, and in which pool
+    struct Affinity {
+        uint64_t poolId = 0;
+        size_t slot = 0;
+    };
+
+    static Affinity& threadAffinity() {
+        thread_local Affinity affinity;
+        return affinity;
+    }
+
+    static uint64_t nextPoolId() {
+        static std::atomic<uint64_t> next{ 1 };
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // An idle connection, starting from preferred, or else an empty slot to open
+    std::optional<Claim> tryClaim(size_t preferred) {
+        for (size_t i = 0; i < slotCount; ++i) {
+            size_t index = (preferred + i) % slotCount;
+            uint8_t expected = IDLE;
+            if (slots[index].state.compare_exchange_strong(expected, BUSY, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return Claim{ index, false };
+            }
+        }
+        for (size_t i = 0; i < slotCount; ++i) {
+            uint8_t expected = EMPTY;
+            if (slots[i].state.compare_exchange_strong(expected, BUSY, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return Claim{ i, true };
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Opens or health-checks a claimed slot and leases it out
+    Lease grant(Claim claim, size_t preferred, bool hasAffinity) {
+        Slot& slot = slots[claim.slot];
+        if (claim.needsOpen) {
+            open(slot);
+        }
+        else if (Clock::now() - slot.lastReturned > healthCheckAfterIdle) {
+            counters.healthChecks.fetch_add(1, std::memory_order_relaxed);
+            if (!healthCheck(*slot.resource)) {
+                counters.replaced.fetch_add(1, std::memory_order_relaxed);
+                slot.resource.reset();
+                openCount.fetch_sub(1, std::memory_order_relaxed);
+                open(slot);
+            }
+        }
+        if (hasAffinity && claim.slot == preferred) {
+            counters.affinityHits.fetch_add(1, std::memory_order_relaxed);
+        }
+        threadAffinity() = Affinity{ poolId, claim.slot };
+        return Lease(this, claim.slot);
+    }
+
+    // Opens a connection into a slot claimed BUSY; on failure the slot is left EMPTY and the error rethrown
+    void open(Slot& slot) {
+        try {
+            slot.resource = connect();
+        }
+        catch (...) {
+            slot.state.store(EMPTY, std::memory_order_seq_cst);
+            notifyWaiter();
+            throw;
+        }
+        slot.lastReturned = Clock::now();
+        openCount.fetch_add(1, std::memory_order_relaxed);
+        counters.opened.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void checkin(size_t index) {
+        slots[index].lastReturned = Clock::now();
+        slots[index].state.store(IDLE, std::memory_order_seq_cst);
+        notifyWaiter();
+    }
+
+    void discard(size_t index) {
+        slots[index].resource.reset();
+        openCount.fetch_sub(1, std::memory_order_relaxed);
+        slots[index].state.store(EMPTY, std::memory_order_seq_cst);
+        notifyWaiter();
+    }
+
+    void notifyWaiter() {
+        if (waiters.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            wakeup.notify_one();
+        }
+    }
+
+    struct Counters {
+        std::atomic<uint64_t> checkouts{ 0 };
+        std::atomic<uint64_t> affinityHits{ 0 };
+        std::atomic<uint64_t> waits{ 0 };
+        std::atomic<uint64_t> opened{ 0 };
+        std::atomic<uint64_t> healthChecks{ 0 };
+        std::atomic<uint64_t> replaced{ 0 };
+    };
+
+    const uint64_t poolId = nextPoolId();
+    const size_t slotCount;
+    std::unique_ptr<Slot[]> slots;
+    Connector connect;
+    HealthCheck healthCheck;
+    std::chrono::nanoseconds healthCheckAfterIdle;
+    std::atomic<size_t> openCount{ 0 };
+    std::atomic<int> waiters{ 0 };
+    std::mutex waitMutex;
+    std::condition_variable wakeup;
+    Counters counters;
+};
+
+#endif // CONNECTION_POOL_HPP
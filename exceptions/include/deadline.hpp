@@ -0,0 +1,19 @@
+#ifndef DEADLINE_HPP
+#define DEADLINE_HPP
+
+#include <chrono>
+#include <stop_token>
+
+// Deadline and cancellation state that travels with a query and is checked cooperatively while it runs.
+struct QueryDeadline {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point expiresAt = Clock::time_point::max();
+    std::stop_token stopToken;
+
+    bool expired() const {
+        return stopToken.stop_requested() || (expiresAt != Clock::time_point::max() && Clock::now() >= expiresAt);
+    }
+};
+
+#endif // DEADLINE_HPP
@@ -41,4 +41,11 @@ public:
         : ProjectError("QueryError: " + message) {}
 };
 
+// Raised when a query's deadline passes or its batch is cancelled
+class TimeoutError : public QueryError {
+public:
+    explicit TimeoutError(const std::string& message)
+        : QueryError("Timeout: " + message) {}
+};
+
 #endif // ERROR_HPP
\ No newline at end of file
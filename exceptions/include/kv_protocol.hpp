@@ -0,0 +1,43 @@
+#ifndef KV_PROTOCOL_HPP
+#define KV_PROTOCOL_HPP
+
+#include "query.hpp"
+#include <chrono>
+#include <string>
+#include <string_view>
+
+// Line protocol between ConnectionManager and kvserver. Every message is one '\n'-terminated line,
+// and a connection gets its responses in the order it sent its requests.
+//
+// Request:  <depth> <timeout us, 0 for none> <query line in the query file format>
+// Response: OK <key version> <data>
+//           ERR 0 <error message>
+//           TIMEOUT 0 <error message>
+
+// Limits kvserver puts on every request. Server::processCommand recurses once per level of depth, so a larger
+// depth is rejected before it can overflow the server's stack; a longer timeout is clamped so that its deadline
+// cannot overflow the clock.
+constexpr int maxKvRequestDepth = 10000;
+constexpr std::chrono::microseconds maxKvRequestTimeout = std::chrono::hours(24);
+
+// Formats a request line, newline included.
+std::string formatKvRequest(const Query& query, int depth, std::chrono::microseconds timeout);
+
+struct KvRequest {
+    int depth = 0;
+    std::chrono::microseconds timeout{ 0 };
+    std::string_view queryLine; // Points into the parsed line
+};
+
+// Parses a request line without its newline. Throws ParseError if the header is malformed or the depth exceeds
+// maxKvRequestDepth, and clamps the timeout to maxKvRequestTimeout;
+// the query line itself is left to QueryEngine::parseQueryLine.
+KvRequest parseKvRequest(std::string_view line);
+
+// Formats a response line, newline included. Newlines in the data or message are replaced with spaces.
+std::string formatKvResponse(const QueryResult& result);
+
+// Parses a response line without its newline into a result for queryId. Throws ParseError if it is malformed.
+QueryResult parseKvResponse(std::string_view line, int queryId);
+
+#endif // KV_PROTOCOL_HPP
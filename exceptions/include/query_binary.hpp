@@ -0,0 +1,59 @@
+#ifndef QUERY_BINARY_HPP
+#define QUERY_BINARY_HPP
+
+#include "query.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Compiled query files, produced by querycompile from the text format.
+//
+// Header (12 bytes, little-endian): magic "QBIN", uint16 version, uint16 flags (none defined, must be 0),
+// uint32 query count.
+// Each record then holds:
+//   tag byte       bits 0-1 Query::Type, bits 2-3 Query::Priority, bit 4 set if a value follows
+//   varint         zigzag-encoded id
+//   varint + bytes key
+//   varint + bytes value, only if the tag has a value
+// Keys and values are stored verbatim, so a mapped file can be read into QueryViews without copying.
+constexpr uint16_t compiledQueryVersion = 1;
+constexpr size_t compiledQueryHeaderSize = 12;
+
+// Accumulates records in memory; finish() prepends the header once the count is known.
+class CompiledQueryWriter {
+public:
+    void append(const QueryView& query);
+    size_t size() const { return count; }
+    // Returns the complete file contents and resets the writer.
+    std::string finish();
+
+private:
+    std::string records;
+    uint32_t count = 0;
+};
+
+// Iterates the records of a compiled file in place; every QueryView points into data.
+// rawCommand is left empty, as compiled files do not store it.
+class CompiledQueryReader {
+public:
+    // Throws ParseError if data does not start with a valid header.
+    explicit CompiledQueryReader(std::string_view data);
+
+    // Reads the next record into query; returns false after the last one.
+    // Throws ParseError if a record is truncated or invalid, or if bytes follow the last record.
+    bool next(QueryView& query);
+
+    uint32_t size() const { return count; }
+
+private:
+    uint64_t readVarint();
+    std::string_view readBytes(size_t length);
+
+    std::string_view data;
+    size_t offset = compiledQueryHeaderSize;
+    uint32_t count = 0;
+    uint32_t consumed = 0;
+};
+
+#endif // QUERY_BINARY_HPP
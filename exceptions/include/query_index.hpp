@@ -0,0 +1,62 @@
+#ifndef QUERY_INDEX_HPP
+#define QUERY_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Sidecar index of a text query file, stored next to it as <file>.qidx.
+// The file is divided into blocks of `stride` lines; for each block the index records its byte offset and
+// the smallest and largest query id on its lines, so a line number or an id range can be mapped to the
+// byte ranges that need parsing. Ids need not be sorted, but sorted files skip the most.
+//
+// Sidecar layout (little-endian): magic "QIDX", uint16 version, uint16 reserved, uint32 stride, uint32 reserved,
+// uint64 size and int64 mtime of the indexed file, uint64 block count, then per block uint64 offset,
+// int32 min id, int32 max id. A sidecar whose size or mtime no longer matches the file is ignored.
+class QueryFileIndex {
+public:
+    static constexpr uint32_t defaultStride = 4096;
+
+    struct Block {
+        uint64_t offset = 0;
+        int32_t minId = INT32_MAX; // Left at INT32_MAX/INT32_MIN if no line of the block has an id
+        int32_t maxId = INT32_MIN;
+    };
+
+    static std::string sidecarPath(const std::string& filePath) { return filePath + ".qidx"; }
+
+    explicit QueryFileIndex(uint32_t stride = defaultStride);
+
+    // Indexes text, the whole contents of a query file.
+    static QueryFileIndex build(std::string_view text, uint32_t stride = defaultStride);
+    // Reads the sidecar of filePath; nullopt if it is missing, corrupt or stale.
+    static std::optional<QueryFileIndex> load(const std::string& filePath);
+    // Writes the sidecar of filePath, stamped with the file's current size and mtime. Returns false on failure.
+    bool save(const std::string& filePath) const;
+
+    // Incremental construction, one call per line (without its newline) in file order.
+    void addLine(uint64_t offset, std::string_view line);
+    // Records the size of the indexed file once every line has been added.
+    void finish(uint64_t fileBytes) { indexedBytes = fileBytes; }
+
+    uint32_t stride() const { return linesPerBlock; }
+    const std::vector<Block>& blocks() const { return entries; }
+    // Byte offset of the block holding 1-based lineNumber, and the line number that block starts at.
+    std::pair<uint64_t, uint64_t> locateLine(uint64_t lineNumber) const;
+    // Runs of consecutive blocks that may hold ids in [firstId, lastId], as [begin, end) block indexes.
+    std::vector<std::pair<size_t, size_t>> blocksForIds(int firstId, int lastId) const;
+    // Byte range [begin, end) covered by blocks [beginBlock, endBlock).
+    std::pair<uint64_t, uint64_t> byteRange(size_t beginBlock, size_t endBlock) const;
+
+private:
+    uint32_t linesPerBlock;
+    uint64_t lines = 0; // Added so far; not stored in the sidecar
+    uint64_t indexedBytes = 0;
+    std::vector<Block> entries;
+};
+
+#endif // QUERY_INDEX_HPP
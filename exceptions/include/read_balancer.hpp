@@ -0,0 +1,40 @@
+#ifndef READ_BALANCER_HPP
+#define READ_BALANCER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+enum class ReadTarget {
+    PRIMARY,
+    BACKUP,
+};
+
+struct ReadBalancerStats {
+    uint64_t primaryReads = 0;
+    uint64_t backupReads = 0;
+};
+
+// Chooses the server for each read by least outstanding requests weighted by latency: the one with the smaller
+// (outstanding + 1) * average latency, the primary on a tie. With two servers this is also what
+// power-of-two-choices comes down to. The average is exponentially weighted over the server's recent reads, and
+// decays while the server is passed over so it is tried again after a slow spell. Lock-free.
+class ReadBalancer {
+public:
+    // The read counts as outstanding on the chosen server until finish.
+    ReadTarget choose();
+    void finish(ReadTarget target, std::chrono::microseconds latency);
+
+    ReadBalancerStats getStats() const;
+
+private:
+    struct Target {
+        std::atomic<int64_t> outstanding{ 0 };
+        std::atomic<int64_t> averageUs{ 0 }; // 0 until the first read has finished
+        std::atomic<uint64_t> reads{ 0 };
+    };
+    std::array<Target, 2> targets; // Indexed by ReadTarget
+};
+
+#endif // READ_BALANCER_HPP
@@ -2,22 +2,55 @@
 #define SERVER_HPP
 
 #include "error.hpp"
+#include "deadline.hpp"
 #include <string>
 #include <unordered_map>
 #include <mutex>
+#include <cstdint>
+#include <vector>
 
 struct QueryResult;
 struct Query;
 
+// How the server indexes its key-value store
+enum class KeyIndexing {
+    STRING,   // Hash maps keyed by the key string
+    INTERNED, // Flat vector indexed by the KeyInterner id of the key
+};
+
 class Server {
 public:
-    QueryResult processCommand(const Query& query, int depth);
+    // INTERNED is opt-in: its vector is sized by the ids of the process-wide KeyInterner, which never frees them
+    // and also numbers keys that other parses interned, so a server holding a few keys can still need a large one.
+    explicit Server(KeyIndexing indexing = KeyIndexing::STRING) : keyIndexing(indexing) {}
+
+    // The deadline is checked every 16 recursion levels, the last one included, so an expired or
+    // cancelled query stops early without a clock read per level.
+    QueryResult processCommand(const Query& query, int depth, const QueryDeadline& deadline = QueryDeadline{});
+
+    // Returns the version stamp of the last write to key, or 0 if it has never been written.
+    uint64_t getKeyVersion(const std::string& key);
 
 private:
     std::unordered_map<std::string, std::string> keyValueStore;
     std::mutex storeMutex;
+    // Every SET/DELETE stamps its key with a new, globally increasing version
+    std::unordered_map<std::string, uint64_t> keyVersions;
+    uint64_t lastVersion = 0;
+
+    // INTERNED store: one slot per key id, grown on demand. Deleted keys keep their version.
+    struct Entry {
+        std::string value;
+        uint64_t version = 0;
+        bool present = false;
+    };
+    KeyIndexing keyIndexing;
+    std::vector<Entry> entriesById;
+
+    // Applies query to the INTERNED store; storeMutex must be held.
+    QueryResult applyInterned(const Query& query);
 
-	QueryResult processWork(const Query& query, int depth);
+	QueryResult processWork(const Query& query, int depth, const QueryDeadline& deadline);
 };
 
 #endif // SERVER_HPP
\ No newline at end of file
@@ -0,0 +1,88 @@
+#ifndef SHM_CHANNEL_HPP
+#define SHM_CHANNEL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Single-producer single-consumer ring of length-prefixed records, placed in memory shared by two processes.
+// Records never wrap, so the consumer reads each one in place. A side that finds the ring empty (or full)
+// spins briefly if the host has more than one CPU, then announces that it sleeps and waits on a futex; the
+// other side makes the wake-up system call only when it sees that announcement, so a busy ring costs no
+// system calls at all.
+class ShmRing {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t capacity = 256 * 1024;
+    static constexpr size_t maxRecord = capacity / 2 - 8; // Largest record write() accepts
+
+    // Appends record once there is room. Returns false if there was none by giveUpAt, the ring was closed
+    // or the record is larger than maxRecord.
+    bool write(std::string_view record, Clock::time_point giveUpAt);
+    // The oldest record, in place and valid until pop(), or nullopt if none arrived by giveUpAt or the ring was closed.
+    // A record whose length runs past the end of the buffer closes the ring.
+    std::optional<std::string_view> read(Clock::time_point giveUpAt);
+    // Releases the record returned by read().
+    void pop();
+
+    // Makes every later read and write fail and wakes a side waiting on the ring.
+    void close();
+    bool isClosed() const { return closed.load(std::memory_order_acquire) != 0; }
+
+private:
+    // Waits until ready() holds, sleeping on sleeping once spinning has not helped
+    template <typename Ready>
+    bool waitUntil(Ready ready, std::atomic<uint32_t>& sleeping, Clock::time_point giveUpAt);
+    void wake(std::atomic<uint32_t>& sleeping);
+
+    alignas(64) std::atomic<uint64_t> head{ 0 }; // Advanced by the consumer
+    uint64_t readEnd = 0;                        // Consumer-private: where pop() moves head
+    alignas(64) std::atomic<uint64_t> tail{ 0 }; // Advanced by the producer
+    alignas(64) std::atomic<uint32_t> readerSleeping{ 0 }; // Futex words
+    alignas(64) std::atomic<uint32_t> writerSleeping{ 0 };
+    alignas(64) std::atomic<uint32_t> closed{ 0 };
+    alignas(64) char data[capacity];
+};
+
+// The request and response rings of one client connection, in a POSIX shared memory object that the client
+// creates and names to the server.
+class ShmRegion {
+public:
+    // Creates and maps a new, uniquely named region. Throws ConnectionError on failure.
+    static std::unique_ptr<ShmRegion> create();
+    // Maps a region created by a client. Throws ConnectionError on failure.
+    static std::unique_ptr<ShmRegion> open(const std::string& name);
+    ~ShmRegion();
+
+    ShmRegion(const ShmRegion&) = delete;
+    ShmRegion& operator=(const ShmRegion&) = delete;
+
+    const std::string& name() const { return regionName; }
+    // Removes the name once the server has mapped the region; the memory lives until both sides unmap it.
+    void unlink();
+
+    ShmRing& requests() { return layout->requests; }
+    ShmRing& responses() { return layout->responses; }
+    // Closes both rings, waking whichever side is waiting.
+    void close();
+
+private:
+    struct Layout {
+        ShmRing requests;
+        ShmRing responses;
+    };
+
+    ShmRegion(std::string name, Layout* layout, bool linked) : regionName(std::move(name)), layout(layout), linked(linked) {}
+
+    std::string regionName;
+    Layout* layout;
+    bool linked; // The name still exists and this side created it
+};
+
+#endif // SHM_CHANNEL_HPP
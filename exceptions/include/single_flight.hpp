@@ -0,0 +1,103 @@
+#ifndef SINGLE_FLIGHT_HPP
+#define SINGLE_FLIGHT_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Collapses concurrent calls for the same key into a single execution.
+// The first caller for a key (the leader) runs the work; callers arriving while it is in flight wait
+// for it and receive a copy of its result. invalidate() closes the current window for a key so that
+// later callers start a fresh execution instead of joining one that began before a write.
+template <typename Result>
+class SingleFlight {
+public:
+    // Runs fn() for key, or joins the call for key that is already in flight and returns a copy of its result.
+    template <typename Fn>
+    Result run(const std::string& key, Fn&& fn) {
+        std::shared_ptr<Flight> flight;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lock(flightsMutex);
+            auto it = flights.find(key);
+            if (it != flights.end()) {
+                flight = it->second;
+            }
+            else {
+                flight = std::make_shared<Flight>();
+                flights.emplace(key, flight);
+                leader = true;
+            }
+        }
+
+        if (!leader) {
+            coalescedCount.fetch_add(1, std::memory_order_relaxed);
+            std::unique_lock<std::mutex> lock(flight->mutex);
+            flight->doneCondition.wait(lock, [&]() { return flight->done; });
+            if (flight->error) {
+                std::rethrow_exception(flight->error);
+            }
+            return *flight->result;
+        }
+
+        executedCount.fetch_add(1, std::memory_order_relaxed);
+        try {
+            Result result = fn();
+            finish(key, flight, result, nullptr);
+            return result;
+        }
+        catch (...) {
+            finish(key, flight, std::nullopt, std::current_exception());
+            throw;
+        }
+    }
+
+    // Detaches any in-flight call for key; callers already waiting on it still receive its result.
+    void invalidate(const std::string& key) {
+        std::lock_guard<std::mutex> lock(flightsMutex);
+        flights.erase(key);
+    }
+
+    uint64_t getExecutedCount() const { return executedCount.load(std::memory_order_relaxed); }
+    uint64_t getCoalescedCount() const { return coalescedCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Flight {
+        std::mutex mutex;
+        std::condition_variable doneCondition;
+        bool done = false;
+        std::optional<Result> result;
+        std::exception_ptr error;
+    };
+
+    void finish(const std::string& key, const std::shared_ptr<Flight>& flight, std::optional<Result> result, std::exception_ptr error) {
+        {
+            std::lock_guard<std::mutex> lock(flightsMutex);
+            // The window may already have been invalidated and reopened by a newer leader
+            auto it = flights.find(key);
+            if (it != flights.end() && it->second == flight) {
+                flights.erase(it);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(flight->mutex);
+            flight->result = std::move(result);
+            flight->error = error;
+            flight->done = true;
+        }
+        flight->doneCondition.notify_all();
+    }
+
+    std::mutex flightsMutex;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights;
+    std::atomic<uint64_t> executedCount{ 0 };
+    std::atomic<uint64_t> coalescedCount{ 0 };
+};
+
+#endif // SINGLE_FLIGHT_HPP
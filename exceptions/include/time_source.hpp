@@ -0,0 +1,56 @@
+#ifndef TIME_SOURCE_HPP
+#define TIME_SOURCE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+
+// The clock ConnectionManager reads and sleeps on for its connect delays, retry backoffs and breaker cooldowns.
+class TimeSource {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    virtual ~TimeSource() = default;
+    virtual Clock::time_point now() const = 0;
+    virtual void sleepUntil(Clock::time_point wakeAt) = 0;
+    void sleepFor(Clock::duration delay) { sleepUntil(now() + delay); }
+
+    // steady_clock, sleeping the calling thread
+    static TimeSource& real();
+};
+
+// Discrete-event time: the clock stands still while code runs, and each sleep is the next event, so it jumps
+// straight to the wake-up time. Hours of backoff take as long as the code between the sleeps. Starts at the
+// epoch. One timeline for one thread: sleeps from several threads would not wait for each other.
+class VirtualTime : public TimeSource {
+public:
+    Clock::time_point now() const override { return current.load(std::memory_order_relaxed); }
+    void sleepUntil(Clock::time_point wakeAt) override;
+    // Sleeps so far
+    uint64_t events() const { return sleeps.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<Clock::time_point> current{ Clock::time_point{} };
+    std::atomic<uint64_t> sleeps{ 0 };
+};
+
+// Uniform random numbers from a seeded generator, so that a run on VirtualTime repeats exactly from its seed.
+// Thread-safe.
+class RandomSource {
+public:
+    explicit RandomSource(uint64_t seed) : engine(seed) {}
+
+    // In [low, high]
+    int64_t uniform(int64_t low, int64_t high);
+
+    // From std::random_device, for runs that need not repeat
+    static uint64_t freshSeed();
+
+private:
+    std::mutex mutex;
+    std::mt19937_64 engine;
+};
+
+#endif // TIME_SOURCE_HPP
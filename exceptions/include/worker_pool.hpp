@@ -0,0 +1,82 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that execute index-addressed batches.
+// Every task index belongs to a scheduling class with its own queue. While several classes have work
+// queued, workers pick among them by weighted fair queuing (stride scheduling), so a class with weight 8
+// gets eight tasks dispatched for every one of a weight-1 class, and a long low-weight batch cannot starve
+// short high-weight ones. Within a class, tasks run in submission order.
+// Indices are handed out through an atomic cursor per queued batch and completion is tracked by an atomic
+// counter: while only one class has work, a thread keeps taking indices without the lock, and a batch whose
+// indices all share a class allocates no per-task shared state.
+class WorkerPool {
+public:
+    // classWeights[c] is the relative share of dispatches class c receives under contention; must be non-empty.
+    explicit WorkerPool(size_t workerCount, std::vector<unsigned> classWeights = { 1 });
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Runs task(i) for every i in [0, count) and blocks until all of them have finished.
+    // Index i is queued in class classOf(i), or class 0 when classOf is empty. The calling thread helps
+    // execute queued work while it waits. Batches from concurrent callers share the workers.
+    void run(size_t count, const std::function<void(size_t)>& task, const std::function<size_t(size_t)>& classOf = {});
+
+    size_t size() const { return workers.size(); }
+    size_t classCount() const { return classes.size(); }
+
+private:
+    struct Batch {
+        const std::function<void(size_t)>* task;
+        std::atomic<size_t> remaining;
+        size_t users = 0; // Threads taking indices of the batch; guarded by stateMutex
+    };
+
+    // The indices of one batch queued in one class: positions [next, end) of indices, or [next, end) themselves
+    // when indices is null.
+    struct Range {
+        Batch* batch = nullptr;
+        const size_t* indices = nullptr;
+        std::atomic<size_t> next{ 0 };
+        size_t end = 0;
+    };
+
+    struct SchedulingClass {
+        std::deque<Range*> queue;
+        uint64_t stride;
+        uint64_t pass = 0;
+    };
+
+    void workerLoop();
+    // Caller must hold stateMutex, which is released while tasks run. Takes indices from the range the scheduler
+    // picks: one, or with the only busy class as many as it has (stopping once own is done, for a caller).
+    // False if nothing was queued.
+    bool runQueuedLocked(std::unique_lock<std::mutex>& lock, const Batch* own);
+    void enqueueLocked(size_t classIndex, Range& range);
+    void retireLocked(SchedulingClass& schedulingClass, Range& range);
+    // Wakes as many workers as there are tasks to take, at most all of them.
+    void wakeWorkers(size_t tasks);
+
+    std::vector<std::thread> workers;
+    std::vector<SchedulingClass> classes;
+
+    std::mutex stateMutex;
+    std::condition_variable workQueued; // Workers wait here
+    std::condition_variable batchDone;  // Callers of run wait here
+    bool stopping = false;
+    uint64_t globalPass = 0;
+    std::atomic<size_t> busyClasses{ 0 }; // Classes with a range queued; written under stateMutex
+};
+
+#endif // WORKER_POOL_HPP
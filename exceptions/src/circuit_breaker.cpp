@@ -0,0 +1,95 @@
+#include "circuit_breaker.hpp"
+#include <algorithm>
+
+CircuitBreaker::CircuitBreaker(size_t window, int failurePercent, std::chrono::milliseconds cooldown, const TimeSource& time)
+    : failurePercent(std::clamp(failurePercent, 1, 100)), cooldown(cooldown), time(time), outcomes(window, 0) {}
+
+bool CircuitBreaker::allowAttempt() {
+    if (!enabled()) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current == BreakerState::OPEN && time.now() >= reopenAt) {
+        current = BreakerState::HALF_OPEN;
+    }
+    switch (current) {
+    case BreakerState::CLOSED:
+        return true;
+    case BreakerState::HALF_OPEN:
+        if (!probing) {
+            probing = true;
+            ++stats.probes;
+            return true;
+        }
+        break;
+    case BreakerState::OPEN:
+        break;
+    }
+    ++stats.rejected;
+    return false;
+}
+
+void CircuitBreaker::recordSuccess() {
+    record(false);
+}
+
+void CircuitBreaker::recordFailure() {
+    record(true);
+}
+
+void CircuitBreaker::record(bool failed) {
+    if (!enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current != BreakerState::CLOSED) {
+        // The probe's outcome decides; a straggler from before the breaker opened changes nothing
+        if (!probing) {
+            return;
+        }
+        probing = false;
+        if (failed) {
+            open(time.now());
+            return;
+        }
+        ++stats.recoveries;
+        current = BreakerState::CLOSED;
+        std::fill(outcomes.begin(), outcomes.end(), 0);
+        nextOutcome = recorded = failures = 0;
+        return;
+    }
+
+    if (recorded == outcomes.size()) {
+        failures -= outcomes[nextOutcome];
+    }
+    else {
+        ++recorded;
+    }
+    outcomes[nextOutcome] = failed ? 1 : 0;
+    failures += outcomes[nextOutcome];
+    nextOutcome = (nextOutcome + 1) % outcomes.size();
+
+    size_t minimumSamples = (outcomes.size() + 1) / 2;
+    if (recorded >= minimumSamples && failures * 100 >= recorded * static_cast<size_t>(failurePercent)) {
+        open(time.now());
+    }
+}
+
+void CircuitBreaker::open(Clock::time_point now) {
+    current = BreakerState::OPEN;
+    reopenAt = now + cooldown;
+    ++stats.trips;
+}
+
+BreakerState CircuitBreaker::state() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current == BreakerState::OPEN && time.now() >= reopenAt) {
+        return BreakerState::HALF_OPEN;
+    }
+    return current;
+}
+
+CircuitBreakerStats CircuitBreaker::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
@@ -0,0 +1,110 @@
+#include "client_cache.hpp"
+#include <mutex>
+
+ClientCache::ClientCache(size_t capacity, int validationPercent, VersionProbe probe)
+    : shardCapacity(capacity / shardCount > 0 ? capacity / shardCount : 1),
+      validationPercent(validationPercent),
+      versionProbe(std::move(probe)) {}
+
+ClientCache::Shard& ClientCache::shardFor(const std::string& key) {
+    return shards[std::hash<std::string>{}(key) % shardCount];
+}
+
+std::optional<std::string> ClientCache::lookup(const std::string& key) {
+    std::optional<std::string> value;
+    uint64_t version = 0;
+    {
+        Shard& shard = shardFor(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end() && it->second.value) {
+            it->second.referenced.store(true, std::memory_order_relaxed);
+            value = it->second.value;
+            version = it->second.version;
+        }
+    }
+
+    if (!value) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    // Validate a deterministic sample of hits so staleness can be measured without a round trip per hit
+    if (validationPercent > 0 && static_cast<int>(lookupSequence.fetch_add(1, std::memory_order_relaxed) % 100) < validationPercent) {
+        validations.fetch_add(1, std::memory_order_relaxed);
+        if (versionProbe(key) != version) {
+            staleHits.fetch_add(1, std::memory_order_relaxed);
+            misses.fetch_add(1, std::memory_order_relaxed);
+            dropIfVersion(key, version);
+            return std::nullopt;
+        }
+    }
+
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return value;
+}
+
+void ClientCache::fill(const std::string& key, const std::string& value, uint64_t version) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    Entry& entry = upsert(shard, key);
+    if (version < entry.version) {
+        return; // A newer write or fill has already landed
+    }
+    entry.value = value;
+    entry.version = version;
+    entry.referenced.store(true, std::memory_order_relaxed);
+}
+
+void ClientCache::invalidate(const std::string& key, uint64_t version) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    Entry& entry = upsert(shard, key);
+    if (version >= entry.version) {
+        entry.value.reset();
+        entry.version = version;
+    }
+}
+
+ClientCache::Entry& ClientCache::upsert(Shard& shard, const std::string& key) {
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        return it->second;
+    }
+    if (shard.entries.size() >= shardCapacity) {
+        evictOne(shard);
+    }
+    return shard.entries.try_emplace(key).first->second;
+}
+
+void ClientCache::evictOne(Shard& shard) {
+    // Second chance: entries read since the last sweep lose their reference bit and survive one more pass
+    for (int pass = 0; pass < 2; ++pass) {
+        for (auto it = shard.entries.begin(); it != shard.entries.end(); ++it) {
+            if (!it->second.referenced.exchange(false, std::memory_order_relaxed)) {
+                shard.entries.erase(it);
+                evictions.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+}
+
+void ClientCache::dropIfVersion(const std::string& key, uint64_t version) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end() && it->second.version == version) {
+        shard.entries.erase(it);
+    }
+}
+
+ClientCacheStats ClientCache::getStats() const {
+    ClientCacheStats stats;
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    stats.validations = validations.load(std::memory_order_relaxed);
+    stats.staleHits = staleHits.load(std::memory_order_relaxed);
+    stats.evictions = evictions.load(std::memory_order_relaxed);
+    return stats;
+}
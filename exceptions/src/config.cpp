@@ -1,5 +1,6 @@
 ﻿#include "config.hpp"
 #include "error.hpp"
+#include "diagnostics.hpp"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
@@ -23,6 +24,7 @@ AppConfig ConfigLoader::loadConfig(const std::string& filePath) {
 
     AppConfig config;
     std::unordered_map<std::string, std::string> rawConfig;
+    std::unordered_map<std::string, int> keyLines;
     std::string line;
     int lineNumber = 0;
 
@@ -34,6 +36,12 @@ AppConfig ConfigLoader::loadConfig(const std::string& filePath) {
         }
 
         auto pair = parseLine(line, lineNumber);
+        auto [seen, inserted] = keyLines.try_emplace(pair.first, lineNumber);
+        if (!inserted) {
+            DiagnosticsSink::shared().report(DiagnosticCode::CONFIG_WARNING, "Config line " + std::to_string(lineNumber) + ": '" + pair.first +
+                "' overrides the value set on line " + std::to_string(seen->second));
+            seen->second = lineNumber;
+        }
         rawConfig[pair.first] = pair.second;
     }
 
@@ -102,6 +110,114 @@ void ConfigLoader::validateAndApply(AppConfig& config, const std::unordered_map<
         config.connectionTimeoutMs = getIntValue("connection_timeout_ms", 100, 60000);
     }
 
+    if (rawConfig.count("client_cache_capacity")) {
+        config.clientCacheCapacity = getIntValue("client_cache_capacity", 0, 10000000);
+    }
+
+    if (rawConfig.count("client_cache_validation_percent")) {
+        config.clientCacheValidationPercent = getIntValue("client_cache_validation_percent", 0, 100);
+    }
+
+    if (rawConfig.count("pool_size")) {
+        config.poolSize = getIntValue("pool_size", 0, 1024);
+    }
+
+    if (rawConfig.count("breaker_window")) {
+        config.breakerWindow = getIntValue("breaker_window", 0, 1000);
+    }
+
+    if (rawConfig.count("breaker_failure_percent")) {
+        config.breakerFailurePercent = getIntValue("breaker_failure_percent", 1, 100);
+    }
+
+    if (rawConfig.count("breaker_cooldown_ms")) {
+        config.breakerCooldownMs = getIntValue("breaker_cooldown_ms", 0, 600000);
+    }
+
+    if (rawConfig.count("connect_race_delay_ms")) {
+        config.connectRaceDelayMs = getIntValue("connect_race_delay_ms", 0, 60000);
+    }
+
+    if (rawConfig.count("hedge_percentile")) {
+        config.hedgePercentile = getIntValue("hedge_percentile", 0, 99);
+    }
+
+    if (rawConfig.count("hedge_budget_percent")) {
+        config.hedgeBudgetPercent = getIntValue("hedge_budget_percent", 0, 100);
+    }
+
+    if (rawConfig.count("read_balancing")) {
+        std::string readBalancing = getValue("read_balancing");
+        if (readBalancing == "primary") {
+            config.readBalancing = ReadBalancing::PRIMARY_ONLY;
+        }
+        else if (readBalancing == "least_outstanding") {
+            config.readBalancing = ReadBalancing::LEAST_OUTSTANDING;
+        }
+        else {
+            throw ValidationError("Invalid value for parameter 'read_balancing': " + readBalancing + ". Expected 'primary' or 'least_outstanding'");
+        }
+    }
+
+    if (rawConfig.count("transport")) {
+        std::string transport = getValue("transport");
+        if (transport == "simulated") {
+            config.transport = Transport::SIMULATED;
+        }
+        else if (transport == "tcp") {
+            config.transport = Transport::TCP;
+        }
+        else if (transport == "shm") {
+            config.transport = Transport::SHARED_MEMORY;
+        }
+        else {
+            throw ValidationError("Invalid value for parameter 'transport': " + transport + ". Expected 'simulated', 'tcp' or 'shm'");
+        }
+    }
+
+    if (rawConfig.count("protocol")) {
+        std::string protocol = getValue("protocol");
+        if (protocol == "text") {
+            config.wireProtocol = WireProtocol::TEXT;
+        }
+        else if (protocol == "binary") {
+            config.wireProtocol = WireProtocol::BINARY;
+        }
+        else {
+            throw ValidationError("Invalid value for parameter 'protocol': " + protocol + ". Expected 'text' or 'binary'");
+        }
+    }
+
+    if (config.transport != Transport::TCP && config.wireProtocol == WireProtocol::BINARY) {
+        // The simulated transport has no wire, and the shared-memory rings carry lines
+        DiagnosticsSink::shared().report(DiagnosticCode::CONFIG_WARNING, "protocol = binary is ignored unless transport = tcp");
+        config.wireProtocol = WireProtocol::TEXT;
+    }
+
+    if (config.transport != Transport::SIMULATED && config.hedgePercentile > 0) {
+        // Separate kvserver processes do not replicate, so a hedge could return the backup's stale or missing value
+        DiagnosticsSink::shared().report(DiagnosticCode::CONFIG_WARNING, "hedge_percentile is ignored unless transport = simulated");
+        config.hedgePercentile = 0;
+    }
+
+    if (config.transport != Transport::SIMULATED && config.readBalancing != ReadBalancing::PRIMARY_ONLY) {
+        // Separate kvserver processes do not replicate, so reads sent to the backup would miss the primary's writes
+        DiagnosticsSink::shared().report(DiagnosticCode::CONFIG_WARNING, "read_balancing is ignored unless transport = simulated");
+        config.readBalancing = ReadBalancing::PRIMARY_ONLY;
+    }
+
+    if (config.readBalancing != ReadBalancing::PRIMARY_ONLY && config.hedgePercentile > 0) {
+        // Hedges are timed against the primary's latency alone, while balanced reads go to either server
+        DiagnosticsSink::shared().report(DiagnosticCode::CONFIG_WARNING, "hedge_percentile is ignored with read_balancing = least_outstanding");
+        config.hedgePercentile = 0;
+    }
+
+    if (config.transport != Transport::SIMULATED && config.clientCacheCapacity > 0) {
+        // The cache validates hits against the in-process server, which a kvserver client does not use
+        DiagnosticsSink::shared().report(DiagnosticCode::CONFIG_WARNING, "client_cache_capacity is ignored unless transport = simulated");
+        config.clientCacheCapacity = 0;
+    }
+
     if (config.primaryServerAddress == config.backupServerAddress && config.primaryServerPort == config.backupServerPort) {
         throw ValidationError("Primary and backup server addresses and ports cannot be identical.");
     }
@@ -1,54 +1,391 @@
 #include "connection.hpp"
 #include "query.hpp"
 #include "error.hpp"
+#include "diagnostics.hpp"
+#include "kv_protocol.hpp"
+#include "kv_wire.hpp"
+#include <algorithm>
 #include <stdexcept> 
 #include <thread>    
 #include <chrono>    
 #include <cmath>    
-#include <random>
 #include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 // Initialize static members
-int NetworkResource::next_available_handle = 1;
+std::atomic<int> NetworkResource::next_available_handle{ 1 };
+std::atomic<uint64_t> NetworkResource::syscallCount{ 0 };
 ConnectionManager::FailureSimConfig ConnectionManager::primarySim;
 ConnectionManager::FailureSimConfig ConnectionManager::backupSim;
 
-NetworkResource::NetworkResource(NetworkResource&& other) noexcept : address(std::move(other.address)), handle(other.handle) {
+ConnectionManager::ConnectionManager(const AppConfig& appConfig, Server& svr, TimeSource& time, uint64_t seed)
+    : config(appConfig), currentMode(ConnectionMode::DISCONNECTED), server(svr), timeSource(time), random(seed),
+      primaryBreaker(static_cast<size_t>(config.breakerWindow), config.breakerFailurePercent, std::chrono::milliseconds(config.breakerCooldownMs), time),
+      primaryLatency(config.hedgePercentile), hedgeBudget(config.hedgeBudgetPercent) {
+    if (config.clientCacheCapacity > 0) {
+        clientCache = std::make_unique<ClientCache>(
+            static_cast<size_t>(config.clientCacheCapacity),
+            config.clientCacheValidationPercent,
+            [this](const std::string& key) { return server.getKeyVersion(key); });
+    }
+}
+
+NetworkResource::~NetworkResource() {
+    closeSocket();
+    handle = -1;
+}
+
+NetworkResource::NetworkResource(NetworkResource&& other) noexcept
+    : address(std::move(other.address)), handle(other.handle), socketFd(other.socketFd), pending(std::move(other.pending)), abandoned(other.abandoned), binary(other.binary), sharedMemory(std::move(other.sharedMemory)) {
     other.handle = -1;
+    other.socketFd = -1;
 }
 
 NetworkResource& NetworkResource::operator=(NetworkResource&& other) noexcept {
     if (this != &other) {
+        closeSocket();
         address = std::move(other.address);
         handle = other.handle;
+        socketFd = other.socketFd;
+        pending = std::move(other.pending);
+        abandoned = other.abandoned;
+        binary = other.binary;
+        sharedMemory = std::move(other.sharedMemory);
         other.handle = -1;
+        other.socketFd = -1;
     }
     return *this;
 }
 
+void NetworkResource::closeSocket() {
+    if (sharedMemory) {
+        sharedMemory->close(); // Wakes the server's thread for this connection at once
+        sharedMemory.reset();
+    }
+    if (socketFd >= 0) {
+        ::close(socketFd);
+        socketFd = -1;
+        handle = -1;
+    }
+    pending.clear();
+}
+
+bool NetworkResource::isValid() const {
+    if (handle == -1) {
+        return false;
+    }
+    if (socketFd < 0) {
+        return true;
+    }
+    // An idle connection has nothing to read: readable means closed, failed or holding a stray response.
+    // Abandoned responses are expected, so then only a hang-up counts.
+    pollfd idle{ socketFd, static_cast<short>(abandoned > 0 ? POLLRDHUP : POLLIN | POLLRDHUP), 0 };
+    return ::poll(&idle, 1, 0) == 0;
+}
+
+void NetworkResource::fail(const std::string& what) {
+    std::string message = what + " " + address + ": " + std::strerror(errno);
+    closeSocket();
+    throw ConnectionError(message);
+}
+
+// Waits in short slices so a stop request is noticed as well as the deadline
+void NetworkResource::waitFor(short events, const QueryDeadline& deadline) {
+    while (!deadline.expired()) {
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline.expiresAt - QueryDeadline::Clock::now());
+        pollfd ready{ socketFd, events, 0 };
+        int result = ::poll(&ready, 1, static_cast<int>(std::min<int64_t>(remaining.count(), 10)));
+        syscallCount.fetch_add(1, std::memory_order_relaxed);
+        if (result > 0 || (result < 0 && errno != EINTR)) {
+            return;
+        }
+    }
+    closeSocket();
+    throw TimeoutError("Deadline exceeded waiting for " + address);
+}
+
+std::string NetworkResource::exchange(std::string_view request, const QueryDeadline& deadline) {
+    if (socketFd < 0) {
+        throw ConnectionError("Connection to " + address + " is closed");
+    }
+    if (sharedMemory) {
+        return exchangeShared(request, deadline);
+    }
+    sendRequest(request, deadline);
+    std::optional<std::string> response;
+    while (!(response = takeResponse())) {
+        waitFor(POLLIN, deadline);
+        receiveMore();
+    }
+    return std::move(*response);
+}
+
+void NetworkResource::sendRequest(std::string_view request, const QueryDeadline& deadline) {
+    if (socketFd < 0) {
+        throw ConnectionError("Connection to " + address + " is closed");
+    }
+    size_t sent = 0;
+    while (sent < request.size()) {
+        ssize_t written = ::send(socketFd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        syscallCount.fetch_add(1, std::memory_order_relaxed);
+        if (written >= 0) {
+            sent += static_cast<size_t>(written);
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            waitFor(POLLOUT, deadline);
+        }
+        else if (errno != EINTR) {
+            fail("Failed to send to");
+        }
+    }
+}
+
+std::optional<std::string> NetworkResource::pollResponse() {
+    if (socketFd < 0) {
+        throw ConnectionError("Connection to " + address + " is closed");
+    }
+    std::optional<std::string> response;
+    while (!(response = takeResponse()) && receiveMore()) {
+    }
+    return response;
+}
+
+void NetworkResource::drainAbandoned(const QueryDeadline& deadline) {
+    while (abandoned > 0) {
+        if (size_t size = responseSize()) {
+            pending.erase(0, size);
+            --abandoned;
+        }
+        else {
+            waitFor(POLLIN, deadline);
+            receiveMore();
+        }
+    }
+}
+
+size_t NetworkResource::responseSize() const {
+    if (binary) {
+        return wireFrameSize(pending); // Throws ParseError for a garbled length; the caller discards the connection
+    }
+    size_t newline = pending.find('\n');
+    return newline == std::string::npos ? 0 : newline + 1;
+}
+
+bool NetworkResource::receiveMore() {
+    char buffer[4096];
+    ssize_t received = ::recv(socketFd, buffer, sizeof(buffer), 0);
+    syscallCount.fetch_add(1, std::memory_order_relaxed);
+    if (received > 0) {
+        pending.append(buffer, static_cast<size_t>(received));
+        return true;
+    }
+    if (received == 0) {
+        errno = ECONNRESET;
+        fail("Connection closed by");
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        fail("Failed to receive from");
+    }
+    return false;
+}
+
+std::optional<std::string> NetworkResource::takeResponse() {
+    while (size_t size = responseSize()) {
+        if (abandoned == 0) {
+            std::string response = pending.substr(0, binary ? size : size - 1);
+            pending.erase(0, size);
+            return response;
+        }
+        pending.erase(0, size);
+        --abandoned;
+    }
+    return std::nullopt;
+}
+
+std::string NetworkResource::exchangeShared(std::string_view request, const QueryDeadline& deadline) {
+    if (request.size() > ShmRing::maxRecord) {
+        throw ConnectionError("Request of " + std::to_string(request.size()) + " bytes is too large for shared memory");
+    }
+    // Waits in short slices so a stop request, the deadline and a server that has gone are all noticed;
+    // only a peer that went quiet costs the poll
+    auto nextSlice = [&]() { return std::min(deadline.expiresAt, QueryDeadline::Clock::now() + std::chrono::milliseconds(10)); };
+    auto checkPeer = [&]() {
+        if (deadline.expired()) {
+            closeSocket();
+            throw TimeoutError("Deadline exceeded waiting for " + address);
+        }
+        pollfd peer{ socketFd, POLLIN | POLLRDHUP, 0 };
+        if (sharedMemory->responses().isClosed() || ::poll(&peer, 1, 0) != 0) {
+            closeSocket();
+            throw ConnectionError("Connection closed by " + address);
+        }
+        };
+
+    while (!sharedMemory->requests().write(request, nextSlice())) {
+        checkPeer();
+    }
+    std::optional<std::string_view> response;
+    while (!(response = sharedMemory->responses().read(nextSlice()))) {
+        checkPeer();
+    }
+    std::string line(response->substr(0, response->size() - (response->ends_with('\n') ? 1 : 0)));
+    sharedMemory->responses().pop();
+    return line;
+}
+
+void NetworkResource::useSharedMemory(const QueryDeadline& deadline) {
+    std::unique_ptr<ShmRegion> region = ShmRegion::create();
+    std::string reply = exchange("SHM " + region->name() + "\n", deadline);
+    if (!reply.starts_with("OK ")) {
+        throw ConnectionError("Server " + address + " refused shared memory: " + reply);
+    }
+    region->unlink(); // Both sides have it mapped; nothing is left behind if either exits
+    sharedMemory = std::move(region);
+}
+
+void NetworkResource::useBinaryProtocol(const QueryDeadline& deadline) {
+    std::string reply = exchange("BINARY\n", deadline);
+    if (!reply.starts_with("OK ")) {
+        throw ConnectionError("Server " + address + " refused the binary protocol: " + reply);
+    }
+    binary = true;
+}
+
+// Connects a non-blocking socket to a loopback address within timeoutMs. Failures to reach the server are
+// marked transient, like the simulated ones, so the retry loop backs off while a kvserver is starting.
+static int connectLoopback(const std::string& address, int port, int timeoutMs) {
+    in_addr ip{};
+    std::string host = address == "localhost" ? "127.0.0.1" : address;
+    if (::inet_pton(AF_INET, host.c_str(), &ip) != 1 || (ntohl(ip.s_addr) >> 24) != 127) {
+        throw ConnectionError("TCP transport only connects to loopback addresses, not " + address + " (permanent)");
+    }
+    std::string endpoint = address + ":" + std::to_string(port);
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw ConnectionError("Failed to create socket for " + endpoint + ": " + std::strerror(errno) + " (transient)");
+    }
+    sockaddr_in target{};
+    target.sin_family = AF_INET;
+    target.sin_port = htons(static_cast<uint16_t>(port));
+    target.sin_addr = ip;
+    int result = ::connect(fd, reinterpret_cast<sockaddr*>(&target), sizeof(target));
+    if (result < 0 && errno == EINPROGRESS) {
+        pollfd connecting{ fd, POLLOUT, 0 };
+        int error = ETIMEDOUT;
+        if (::poll(&connecting, 1, timeoutMs) == 1) {
+            socklen_t length = sizeof(error);
+            ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        }
+        errno = error;
+        result = error == 0 ? 0 : -1;
+    }
+    if (result < 0) {
+        std::string message = "Failed to connect to " + endpoint + ": " + std::strerror(errno) + " (transient)";
+        ::close(fd);
+        throw ConnectionError(message);
+    }
+    int noDelay = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return fd;
+}
+
 void ConnectionManager::setSimulatedFailureMode(const std::string& serverType, int failureCount, bool transient) {
     if (serverType == "primary") {
-        primarySim.failureCount = failureCount;
-        primarySim.isTransient = transient;
+        primarySim.failureCount.store(failureCount, std::memory_order_relaxed);
+        primarySim.isTransient.store(transient, std::memory_order_relaxed);
     }
     else if (serverType == "backup") {
-        backupSim.failureCount = failureCount;
+        backupSim.failureCount.store(failureCount, std::memory_order_relaxed);
     }
 }
 
+void ConnectionManager::setSimulatedLatency(const std::string& serverType, std::chrono::microseconds typical, int slowPercent, std::chrono::microseconds slow) {
+    FailureSimConfig* sim = serverType == "primary" ? &primarySim : serverType == "backup" ? &backupSim : nullptr;
+    if (sim) {
+        sim->typicalLatency = typical;
+        sim->slowPercent = slowPercent;
+        sim->slowLatency = slow;
+    }
+}
+
+void ConnectionManager::setSimulatedCapacity(const std::string& serverType, int concurrentRequests) {
+    FailureSimConfig* sim = serverType == "primary" ? &primarySim : serverType == "backup" ? &backupSim : nullptr;
+    if (sim) {
+        std::lock_guard<std::mutex> lock(sim->queueMutex);
+        sim->capacity = std::max(0, concurrentRequests);
+        sim->busyUntil.assign(static_cast<size_t>(sim->capacity), QueryDeadline::Clock::time_point{});
+    }
+}
+
+std::chrono::microseconds ConnectionManager::sampleLatency(const FailureSimConfig& sim) {
+    if (sim.typicalLatency.count() == 0 && sim.slowPercent == 0) {
+        return std::chrono::microseconds(0);
+    }
+    if (sim.slowPercent > 0 && random.uniform(0, 99) < sim.slowPercent) {
+        return sim.slowLatency;
+    }
+    int64_t typical = sim.typicalLatency.count();
+    return std::chrono::microseconds(random.uniform(typical / 2, typical + typical / 2));
+}
+
+QueryDeadline::Clock::time_point ConnectionManager::scheduleResponse(FailureSimConfig& sim) {
+    QueryDeadline::Clock::time_point now = QueryDeadline::Clock::now();
+    std::chrono::microseconds latency = sampleLatency(sim);
+    if (sim.capacity == 0) {
+        return now + latency;
+    }
+    // The request takes the slot that frees up first
+    std::lock_guard<std::mutex> lock(sim.queueMutex);
+    auto slot = std::min_element(sim.busyUntil.begin(), sim.busyUntil.end());
+    *slot = std::max(*slot, now) + latency;
+    return *slot;
+}
+
 std::unique_ptr<NetworkResource> ConnectionManager::connectToServer(const std::string& address, int port, int attemptNumber, int totalRetries) {
 
     std::string serverTypeForLog = (address == config.primaryServerAddress && port == config.primaryServerPort) ? "primary" : "backup";
     FailureSimConfig& simConfig = (serverTypeForLog == "primary") ? primarySim : backupSim;
 
-    // Simulate network delay
-    std::this_thread::sleep_for(std::chrono::milliseconds(5 + (rand() % 10))); 
+    // Simulate network delay; a real connect pays its own
+    if (config.transport == Transport::SIMULATED) {
+        timeSource.sleepFor(std::chrono::milliseconds(random.uniform(5, 14)));
+    }
 
-    if (simConfig.failureCount > totalRetries) {
-        std::string errorType = simConfig.isTransient ? "transient" : "permanent";
+    if (simConfig.failureCount.load(std::memory_order_relaxed) > totalRetries) {
+        bool transient = simConfig.isTransient.load(std::memory_order_relaxed);
+        std::string errorType = transient ? "transient" : "permanent";
         std::string errorMessage = "Simulated " + errorType + " connection failure to " + serverTypeForLog + " server " + address + ":" + std::to_string(port);
 
-        throw ConnectionError(errorMessage + (simConfig.isTransient ? " (transient)" : " (permanent)"));
+        throw ConnectionError(errorMessage + (transient ? " (transient)" : " (permanent)"));
+    }
+
+    if (config.transport == Transport::TCP || config.transport == Transport::SHARED_MEMORY) {
+        auto resource = std::make_unique<NetworkResource>(address + ":" + std::to_string(port), connectLoopback(address, port, config.connectionTimeoutMs));
+        // A server that refuses the shared-memory or binary upgrade will refuse it on every retry too
+        QueryDeadline handshake;
+        handshake.expiresAt = QueryDeadline::Clock::now() + std::chrono::milliseconds(config.connectionTimeoutMs);
+        try {
+            if (config.transport == Transport::SHARED_MEMORY) {
+                resource->useSharedMemory(handshake);
+            }
+            if (config.wireProtocol == WireProtocol::BINARY) {
+                resource->useBinaryProtocol(handshake);
+            }
+        }
+        catch (const TimeoutError& e) {
+            throw ConnectionError(std::string(e.what()) + " (transient)");
+        }
+        catch (const ConnectionError& e) {
+            throw ConnectionError(std::string(e.what()) + " (permanent)");
+        }
+        return resource;
     }
 
     // Simulate successful connection and resource acquisition
@@ -57,7 +394,7 @@ std::unique_ptr<NetworkResource> ConnectionManager::connectToServer(const std::s
         return resource;
     }
     catch (const std::bad_alloc& ba) {
-        std::cerr << ("Failed to allocate memory for NetworkResource: " + std::string(ba.what())) << std::endl;
+        DiagnosticsSink::shared().report(DiagnosticCode::CONNECTION_FAILURE, "Failed to allocate memory for NetworkResource: " + std::string(ba.what()));
         throw;
     }
     catch (const std::exception& e) { // Catch potential exceptions from NetworkResource constructor
@@ -66,65 +403,250 @@ std::unique_ptr<NetworkResource> ConnectionManager::connectToServer(const std::s
 }
 
 void ConnectionManager::establishConnection() {
+    if (currentMode == ConnectionMode::BACKUP) {
+        // A racer still running is already retrying the primary
+        if (!adoptRacedPrimary() && !primaryRacer.joinable()) {
+            probePrimary();
+        }
+        return;
+    }
     if (currentMode != ConnectionMode::DISCONNECTED) {
         return;
     }
 
     currentMode = ConnectionMode::DISCONNECTED; // Reset mode
-    activeConnection.reset(); // Release any previous connection explicitly
+    connectionPool.reset(); // Release any previous connections explicitly
+    if (config.connectRaceDelayMs > 0 && &timeSource == &TimeSource::real()) {
+        establishRacing();
+        return;
+    }
 
     // Try Primary Server
     try {
-        activeConnection = connectToServerWithRetries(
+        openPool(connectToServerWithRetries(
             config.primaryServerAddress,
             config.primaryServerPort,
             config.connectionRetries,
             50, 
-            "PRIMARY"
-        );
+            "PRIMARY",
+            &primaryBreaker
+        ), config.primaryServerAddress, config.primaryServerPort, config.connectionRetries + 1);
         currentMode = ConnectionMode::PRIMARY;
+        openBackupPool();
         return; // Success
     }
-	catch (const ConnectionError& _) {
+	catch (const ConnectionError& primaryError) {
+        DiagnosticsSink::shared().report(DiagnosticCode::CONNECTION_FAILURE, std::string("PRIMARY connection failed, trying BACKUP: ") + primaryError.what());
         // Try Backup Server if Primary failed
         try {
-            activeConnection = connectToServerWithRetries(
+            openPool(connectToServerWithRetries(
                 config.backupServerAddress,
                 config.backupServerPort,
                 0, 
                 0, 
                 "BACKUP"
-            );
+            ), config.backupServerAddress, config.backupServerPort, 1);
             currentMode = ConnectionMode::BACKUP;
             return; // Success
         }
         catch (const ConnectionError& _) {
             currentMode = ConnectionMode::DISCONNECTED;
-            activeConnection.reset();
+            connectionPool.reset();
         }
 	}
 
 
 }
 
-std::unique_ptr<NetworkResource> ConnectionManager::connectToServerWithRetries(const std::string& address, int port, int maxRetries, int baseDelayMs, const std::string& serverType) {
+void ConnectionManager::disconnect() {
+    primaryRacer = std::jthread();
+    currentMode = ConnectionMode::DISCONNECTED;
+    connectionPool.reset();
+    backupPool.reset();
+}
+
+void ConnectionManager::probePrimary() {
+    // Without a breaker the backup is kept, as before
+    if (!primaryBreaker.enabled() || !primaryBreaker.allowAttempt()) {
+        return;
+    }
+    std::unique_ptr<NetworkResource> connection;
+    try {
+        connection = connectToServer(config.primaryServerAddress, config.primaryServerPort, 1, config.connectionRetries + 1);
+    }
+    catch (const ConnectionError&) {
+        primaryBreaker.recordFailure();
+        return;
+    }
+    primaryBreaker.recordSuccess();
+    openPool(std::move(connection), config.primaryServerAddress, config.primaryServerPort, config.connectionRetries + 1);
+    currentMode = ConnectionMode::PRIMARY;
+    openBackupPool();
+}
+
+void ConnectionManager::establishRacing() {
+    primaryRacer = std::jthread(); // Stops a racer left from an earlier connect
+    {
+        std::lock_guard<std::mutex> lock(raceState.mutex);
+        raceState.connection.reset();
+        raceState.failures = 0;
+        raceState.permanent = false;
+        raceState.lastError.clear();
+    }
+    primaryRacer = std::jthread([this](std::stop_token stop) { racePrimary(stop); });
+
+    // The primary's head start ends early if its first attempt fails
+    {
+        std::unique_lock<std::mutex> lock(raceState.mutex);
+        raceState.changed.wait_for(lock, std::chrono::milliseconds(config.connectRaceDelayMs),
+            [this]() { return raceState.connection || raceState.failures > 0; });
+    }
+    if (adoptRacedPrimary()) {
+        return;
+    }
+
+    std::unique_ptr<NetworkResource> backup;
+    try {
+        backup = connectToServer(config.backupServerAddress, config.backupServerPort, 1, 1);
+    }
+    catch (const ConnectionError&) {
+        // The primary may still make it within its retry ladder
+    }
+    // A primary that connected while the backup was being tried got there first
+    if (adoptRacedPrimary()) {
+        return;
+    }
+    if (backup) {
+        std::string reason;
+        {
+            std::lock_guard<std::mutex> lock(raceState.mutex);
+            reason = raceState.failures > 0 ? raceState.lastError : "no connection after " + std::to_string(config.connectRaceDelayMs) + "ms";
+        }
+        DiagnosticsSink::shared().report(DiagnosticCode::CONNECTION_FAILURE, "PRIMARY not connected, using BACKUP while retrying it in the background: " + reason);
+        openPool(std::move(backup), config.backupServerAddress, config.backupServerPort, 1);
+        currentMode = ConnectionMode::BACKUP;
+        return;
+    }
+
+    // Only the primary is left; it gets as many attempts as the retry ladder would have
+    {
+        std::unique_lock<std::mutex> lock(raceState.mutex);
+        raceState.changed.wait(lock, [this]() {
+            return raceState.connection || raceState.permanent || raceState.failures > config.connectionRetries
+                || primaryBreaker.state() == BreakerState::OPEN;
+            });
+    }
+    if (!adoptRacedPrimary()) {
+        primaryRacer = std::jthread();
+        currentMode = ConnectionMode::DISCONNECTED;
+        connectionPool.reset();
+    }
+}
+
+void ConnectionManager::racePrimary(std::stop_token stop) {
+    const int baseDelayMs = 50;
+    for (int attempt = 0; !stop.stop_requested(); ++attempt) {
+        if (primaryBreaker.allowAttempt()) {
+            try {
+                std::unique_ptr<NetworkResource> connection = connectToServer(config.primaryServerAddress, config.primaryServerPort, attempt + 1, config.connectionRetries + 1);
+                primaryBreaker.recordSuccess();
+                {
+                    std::lock_guard<std::mutex> lock(raceState.mutex);
+                    raceState.connection = std::move(connection);
+                }
+                raceState.changed.notify_all();
+                return;
+            }
+            catch (const ConnectionError& e) {
+                primaryBreaker.recordFailure();
+                {
+                    std::lock_guard<std::mutex> lock(raceState.mutex);
+                    ++raceState.failures;
+                    raceState.permanent = std::string(e.what()).find("(transient)") == std::string::npos;
+                    raceState.lastError = e.what();
+                }
+                raceState.changed.notify_all();
+            }
+        }
+
+        // Backs off like the retry ladder, but keeps going: once the backup has won, this is the way back
+        long long delay = std::min<long long>(1000, baseDelayMs * (1LL << std::min(attempt, 5)));
+        delay += random.uniform(-delay / 5, delay / 5);
+        std::unique_lock<std::mutex> lock(raceState.mutex);
+        raceState.changed.wait_for(lock, stop, std::chrono::milliseconds(delay), []() { return false; });
+    }
+}
+
+bool ConnectionManager::adoptRacedPrimary() {
+    std::unique_ptr<NetworkResource> connection;
+    {
+        std::lock_guard<std::mutex> lock(raceState.mutex);
+        connection = std::move(raceState.connection);
+    }
+    if (!connection) {
+        return false;
+    }
+    primaryRacer = std::jthread(); // It has returned after connecting
+    openPool(std::move(connection), config.primaryServerAddress, config.primaryServerPort, config.connectionRetries + 1);
+    currentMode = ConnectionMode::PRIMARY;
+    openBackupPool();
+    return true;
+}
+
+void ConnectionManager::openPool(std::unique_ptr<NetworkResource> first, const std::string& address, int port, int totalRetries) {
+    backupPool.reset();
+    connectionPool = makePool(std::move(first), address, port, totalRetries);
+}
+
+void ConnectionManager::openBackupPool() {
+    if (config.hedgePercentile == 0 && config.readBalancing == ReadBalancing::PRIMARY_ONLY) {
+        return;
+    }
+    try {
+        backupPool = makePool(connectToServer(config.backupServerAddress, config.backupServerPort, 1, 1), config.backupServerAddress, config.backupServerPort, 1);
+    }
+    catch (const ConnectionError& e) {
+        DiagnosticsSink::shared().report(DiagnosticCode::CONNECTION_FAILURE, std::string("BACKUP unreachable, GETs go to the PRIMARY only: ") + e.what());
+    }
+}
+
+std::unique_ptr<ConnectionPool<NetworkResource>> ConnectionManager::makePool(std::unique_ptr<NetworkResource> first, const std::string& address, int port, int totalRetries) {
+    size_t poolSize = config.poolSize > 0 ? static_cast<size_t>(config.poolSize) : std::max(1u, std::thread::hardware_concurrency());
+    return std::make_unique<ConnectionPool<NetworkResource>>(
+        poolSize,
+        [this, address, port, totalRetries]() { return connectToServer(address, port, 1, totalRetries); },
+        [](const NetworkResource& connection) { return connection.isValid(); },
+        std::chrono::seconds(1),
+        std::move(first));
+}
+
+std::unique_ptr<NetworkResource> ConnectionManager::connectToServerWithRetries(const std::string& address, int port, int maxRetries, int baseDelayMs, const std::string& serverType, CircuitBreaker* breaker) {
     for (int i = 0; i <= maxRetries; ++i) {
+        if (breaker && !breaker->allowAttempt()) {
+            throw ConnectionError(serverType + " circuit breaker is open after " + std::to_string(i) + " attempts.");
+        }
         try {
             std::unique_ptr<NetworkResource> connection = connectToServer(address, port, i + 1, maxRetries + 1);
+            if (breaker) {
+                breaker->recordSuccess();
+            }
             return connection; 
         }
         catch (const ConnectionError& e) {
+            if (breaker) {
+                breaker->recordFailure();
+            }
             if (i < maxRetries) {
+                if (breaker && breaker->state() != BreakerState::CLOSED) {
+                    break; // Known bad now; the rest of the ladder would only delay the failover
+                }
                 if (std::string(e.what()).find("(transient)") != std::string::npos) {
                     long long delay = static_cast<long long>(baseDelayMs * std::pow(2, i));
-                    std::random_device rd;
-                    std::mt19937 gen(rd());
-                    std::uniform_int_distribution<> distrib(-delay / 5, delay / 5);
-                    delay += distrib(gen);
+                    delay += random.uniform(-delay / 5, delay / 5);
                     if (delay < baseDelayMs) delay = baseDelayMs;
                     if (delay > 1000) delay = 1000;
 
-                    std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+                    timeSource.sleepFor(std::chrono::milliseconds(delay));
                 }
                 else {
                     break; // Don't retry permanent errors
@@ -132,9 +654,12 @@ std::unique_ptr<NetworkResource> ConnectionManager::connectToServerWithRetries(c
             }
         }
         catch (const std::exception& e_std) {
-            std::cerr << ("Unexpected standard exception during " + serverType + " connection attempt " + std::to_string(i + 1) + ": " + e_std.what());
+            if (breaker) {
+                breaker->recordFailure();
+            }
+            DiagnosticsSink::shared().report(DiagnosticCode::CONNECTION_FAILURE, "Unexpected standard exception during " + serverType + " connection attempt " + std::to_string(i + 1) + ": " + e_std.what());
             if (i == maxRetries) {
-                std::cerr << ("All " + serverType + " attempts failed due to unexpected errors.") << std::endl;
+                DiagnosticsSink::shared().report(DiagnosticCode::CONNECTION_FAILURE, "All " + serverType + " attempts failed due to unexpected errors.");
             }
         }
     }
@@ -144,7 +669,7 @@ std::unique_ptr<NetworkResource> ConnectionManager::connectToServerWithRetries(c
 }
 
 bool ConnectionManager::isConnected() const {
-    return (currentMode == ConnectionMode::PRIMARY || currentMode == ConnectionMode::BACKUP) && activeConnection && activeConnection->isValid();
+    return (currentMode == ConnectionMode::PRIMARY || currentMode == ConnectionMode::BACKUP) && connectionPool != nullptr;
 }
 
 ConnectionMode ConnectionManager::getCurrentMode() const {
@@ -152,9 +677,6 @@ ConnectionMode ConnectionManager::getCurrentMode() const {
 }
 
 std::string ConnectionManager::getCurrentServerAddress() const {
-    if (activeConnection && activeConnection->isValid()) {
-        return activeConnection->getAddress();
-    }
     switch (currentMode) {
     case ConnectionMode::PRIMARY: return config.primaryServerAddress + ":" + std::to_string(config.primaryServerPort);
     case ConnectionMode::BACKUP:  return config.backupServerAddress + ":" + std::to_string(config.backupServerPort);  
@@ -163,7 +685,7 @@ std::string ConnectionManager::getCurrentServerAddress() const {
     }
 }
 
-QueryResult ConnectionManager::executeRemoteQuery(const Query& query, int depth) {
+QueryResult ConnectionManager::executeRemoteQuery(const Query& query, int depth, const QueryDeadline& deadline) {
     if (!isConnected()) {
         return QueryResult{
             query.id,
@@ -174,5 +696,470 @@ QueryResult ConnectionManager::executeRemoteQuery(const Query& query, int depth)
         };
     }
 
-    return server.processCommand(query, depth);
+    if (clientCache) {
+        return executeThroughCache(query, depth, deadline);
+    }
+    return sendToServer(query, depth, deadline);
+}
+
+// Time the server gets for a request, so it can stop early too; 0 means no deadline
+static std::chrono::microseconds serverTimeout(const QueryDeadline& deadline) {
+    if (deadline.expiresAt == QueryDeadline::Clock::time_point::max()) {
+        return std::chrono::microseconds(0);
+    }
+    return std::max(std::chrono::microseconds(1), std::chrono::ceil<std::chrono::microseconds>(deadline.expiresAt - QueryDeadline::Clock::now()));
+}
+
+// Sleeps in short slices so a stop request is noticed; false if the deadline comes before readyAt
+static bool sleepUntil(QueryDeadline::Clock::time_point readyAt, const QueryDeadline& deadline) {
+    while (QueryDeadline::Clock::now() < readyAt) {
+        if (deadline.expired()) {
+            return false;
+        }
+        std::this_thread::sleep_until(std::min({ readyAt, deadline.expiresAt, QueryDeadline::Clock::now() + std::chrono::milliseconds(10) }));
+    }
+    return true;
+}
+
+// The request for query in the connection's protocol; valid until the thread's next call
+static std::string_view encodeRequest(const NetworkResource& connection, const Query& query, int depth, const QueryDeadline& deadline) {
+    thread_local std::string frame; // Grows to the largest request once, then is reused
+    std::chrono::microseconds timeout = serverTimeout(deadline);
+    if (!connection.isBinary()) {
+        frame = formatKvRequest(query, depth, timeout);
+        return frame;
+    }
+    frame.resize(wireRequestSize(query, depth, timeout));
+    encodeWireRequest(query, depth, timeout, frame);
+    return frame;
+}
+
+// Throws ParseError if the response is garbled or answers another query
+static QueryResult decodeResponse(const NetworkResource& connection, const Query& query, const std::string& response) {
+    if (!connection.isBinary()) {
+        return parseKvResponse(response, query.id);
+    }
+    WireResponse wire = decodeWireResponse(response);
+    if (wire.queryId != query.id) {
+        throw ParseError("Response for query ID " + std::to_string(wire.queryId) + " received for query ID " + std::to_string(query.id));
+    }
+    return wire.toResult();
+}
+
+QueryResult ConnectionManager::sendToServer(const Query& query, int depth, const QueryDeadline& deadline) {
+    if (!backupPool || query.type != Query::Type::GET || currentMode != ConnectionMode::PRIMARY) {
+        return sendOver(*connectionPool, currentMode == ConnectionMode::PRIMARY ? primarySim : backupSim, query, depth, deadline);
+    }
+    if (config.readBalancing == ReadBalancing::PRIMARY_ONLY) {
+        return sendHedged(query, depth, deadline);
+    }
+    auto start = QueryDeadline::Clock::now();
+    ReadTarget target = readBalancer.choose();
+    QueryResult result = target == ReadTarget::PRIMARY
+        ? sendOver(*connectionPool, primarySim, query, depth, deadline)
+        : sendOver(*backupPool, backupSim, query, depth, deadline);
+    readBalancer.finish(target, std::chrono::duration_cast<std::chrono::microseconds>(QueryDeadline::Clock::now() - start));
+    return result;
+}
+
+QueryResult ConnectionManager::sendOver(ConnectionPool<NetworkResource>& pool, FailureSimConfig& sim, const Query& query, int depth, const QueryDeadline& deadline) {
+    ConnectionPool<NetworkResource>::Lease connection;
+    try {
+        connection = pool.checkout(deadline);
+    }
+    catch (const ConnectionError& e) {
+        return QueryResult{ query.id, false, "", "Failed to open a pooled connection for query ID " + std::to_string(query.id) + ": " + e.what(), std::chrono::milliseconds(0) };
+    }
+    if (!connection) {
+        QueryResult timeoutResult{ query.id, false, "", "Timeout: No pooled connection became free for query ID " + std::to_string(query.id), std::chrono::milliseconds(0) };
+        timeoutResult.timedOut = true;
+        return timeoutResult;
+    }
+    if (!connection->isSocket()) {
+        auto readyAt = scheduleResponse(sim);
+        QueryResult result = server.processCommand(query, depth, deadline);
+        if (!sleepUntil(readyAt, deadline)) {
+            QueryResult timeoutResult{ query.id, false, "", "Timeout: Deadline exceeded waiting for " + connection->getAddress(), std::chrono::milliseconds(0) };
+            timeoutResult.timedOut = true;
+            return timeoutResult;
+        }
+        return result;
+    }
+
+    try {
+        return decodeResponse(*connection, query, connection->exchange(encodeRequest(*connection, query, depth, deadline), deadline));
+    }
+    catch (const TimeoutError& e) {
+        connection.discard();
+        QueryResult timeoutResult{ query.id, false, "", e.what(), std::chrono::milliseconds(0) };
+        timeoutResult.timedOut = true;
+        return timeoutResult;
+    }
+    catch (const ProjectError& e) { // ConnectionError, or ParseError for a garbled response
+        connection.discard();
+        return QueryResult{ query.id, false, "", e.what(), std::chrono::milliseconds(0) };
+    }
+}
+
+struct ConnectionManager::HedgeLeg {
+    ConnectionPool<NetworkResource>::Lease connection;
+    std::optional<QueryResult> result;        // Set once the response has been read, or the leg failed
+    bool failed = false;
+    QueryDeadline::Clock::time_point readyAt; // A simulated connection's result only counts from then
+};
+
+std::optional<QueryResult> ConnectionManager::startLeg(HedgeLeg& leg, ConnectionPool<NetworkResource>& pool, bool wait, const Query& query, int depth, const QueryDeadline& deadline) {
+    try {
+        leg.connection = wait ? pool.checkout(deadline) : pool.tryCheckout();
+    }
+    catch (const ConnectionError& e) {
+        return QueryResult{ query.id, false, "", "Failed to open a pooled connection for query ID " + std::to_string(query.id) + ": " + e.what(), std::chrono::milliseconds(0) };
+    }
+    if (!leg.connection) {
+        QueryResult timeoutResult{ query.id, false, "", "Timeout: No pooled connection became free for query ID " + std::to_string(query.id), std::chrono::milliseconds(0) };
+        timeoutResult.timedOut = true;
+        return timeoutResult;
+    }
+    if (!leg.connection->isSocket()) {
+        leg.readyAt = scheduleResponse(&pool == backupPool.get() ? backupSim : primarySim);
+        leg.result = server.processCommand(query, depth, deadline);
+        return std::nullopt;
+    }
+    try {
+        leg.connection->sendRequest(encodeRequest(*leg.connection, query, depth, deadline), deadline);
+    }
+    catch (const TimeoutError& e) {
+        leg.connection.discard();
+        QueryResult timeoutResult{ query.id, false, "", e.what(), std::chrono::milliseconds(0) };
+        timeoutResult.timedOut = true;
+        return timeoutResult;
+    }
+    catch (const ProjectError& e) {
+        leg.connection.discard();
+        return QueryResult{ query.id, false, "", e.what(), std::chrono::milliseconds(0) };
+    }
+    return std::nullopt;
+}
+
+ConnectionManager::HedgeLeg* ConnectionManager::awaitLegs(std::span<HedgeLeg> legs, QueryDeadline::Clock::time_point until, const Query& query, const QueryDeadline& deadline) {
+    using Clock = QueryDeadline::Clock;
+    while (true) {
+        Clock::time_point now = Clock::now();
+        // Bounded so a stop request is noticed
+        Clock::time_point wakeAt = std::min({ until, deadline.expiresAt, now + std::chrono::milliseconds(10) });
+        pollfd sockets[2];
+        HedgeLeg* polled[2];
+        nfds_t socketCount = 0;
+        bool waiting = false;
+        for (HedgeLeg& leg : legs) {
+            if (leg.failed) {
+                continue;
+            }
+            if (leg.result) {
+                if (now >= leg.readyAt) {
+                    return &leg;
+                }
+                wakeAt = std::min(wakeAt, leg.readyAt);
+            }
+            else {
+                sockets[socketCount] = pollfd{ leg.connection->nativeSocket(), POLLIN, 0 };
+                polled[socketCount++] = &leg;
+            }
+            waiting = true;
+        }
+        if (!waiting || now >= until || deadline.expired()) {
+            return nullptr;
+        }
+
+        auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(wakeAt - now, Clock::duration::zero()));
+        timespec timeout{ static_cast<time_t>(wait.count() / 1000000000), static_cast<long>(wait.count() % 1000000000) };
+        if (::ppoll(sockets, socketCount, &timeout, nullptr) <= 0) {
+            continue;
+        }
+        for (nfds_t i = 0; i < socketCount; ++i) {
+            if (sockets[i].revents == 0) {
+                continue;
+            }
+            HedgeLeg& leg = *polled[i];
+            try {
+                if (std::optional<std::string> response = leg.connection->pollResponse()) {
+                    leg.result = decodeResponse(*leg.connection, query, *response);
+                }
+            }
+            catch (const ProjectError& e) {
+                leg.connection.discard();
+                leg.failed = true;
+                leg.result = QueryResult{ query.id, false, "", e.what(), std::chrono::milliseconds(0) };
+            }
+        }
+    }
+}
+
+QueryResult ConnectionManager::sendHedged(const Query& query, int depth, const QueryDeadline& deadline) {
+    using Clock = QueryDeadline::Clock;
+    Clock::time_point start = Clock::now();
+    hedgeCounters.eligible.fetch_add(1, std::memory_order_relaxed);
+    hedgeBudget.deposit();
+
+    HedgeLeg legs[2];
+    if (std::optional<QueryResult> failure = startLeg(legs[0], *connectionPool, true, query, depth, deadline)) {
+        return *failure;
+    }
+    size_t started = 1;
+    HedgeLeg* winner = nullptr;
+    // Until the primary has answered enough GETs there is no percentile to hedge at
+    if (std::optional<std::chrono::microseconds> hedgeDelay = primaryLatency.percentileLatency()) {
+        winner = awaitLegs(std::span(legs, 1), start + *hedgeDelay, query, deadline);
+        if (!winner && !legs[0].failed && !deadline.expired()) {
+            if (!hedgeBudget.tryWithdraw()) {
+                hedgeCounters.budgetDenied.fetch_add(1, std::memory_order_relaxed);
+            }
+            else if (!startLeg(legs[1], *backupPool, false, query, depth, deadline)) {
+                hedgeCounters.hedged.fetch_add(1, std::memory_order_relaxed);
+                started = 2;
+            }
+        }
+    }
+    if (!winner) {
+        winner = awaitLegs(std::span(legs, started), Clock::time_point::max(), query, deadline);
+    }
+
+    // A primary that lost or ran out of time is recorded at the time it was given up on, which keeps the slow tail in the window
+    if (!legs[0].failed) {
+        primaryLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start));
+    }
+    // Gives up on the requests still outstanding. A loser's connection stays pooled and drops the late response;
+    // past the deadline the server may never answer, so the connection is closed as exchange would.
+    for (HedgeLeg& leg : std::span(legs, started)) {
+        if (&leg != winner && leg.connection && !leg.result && leg.connection->isSocket()) {
+            if (winner) {
+                leg.connection->abandonResponse();
+            }
+            else {
+                leg.connection.discard();
+            }
+        }
+    }
+
+    if (winner) {
+        if (winner == &legs[1]) {
+            hedgeCounters.hedgeWins.fetch_add(1, std::memory_order_relaxed);
+        }
+        return std::move(*winner->result);
+    }
+    if (legs[0].failed) {
+        return std::move(*legs[0].result);
+    }
+    QueryResult timeoutResult{ query.id, false, "", "Timeout: No response to query ID " + std::to_string(query.id) + " before its deadline", std::chrono::milliseconds(0) };
+    timeoutResult.timedOut = true;
+    return timeoutResult;
+}
+
+HedgeStats ConnectionManager::getHedgeStats() const {
+    HedgeStats stats;
+    stats.eligible = hedgeCounters.eligible.load(std::memory_order_relaxed);
+    stats.hedged = hedgeCounters.hedged.load(std::memory_order_relaxed);
+    stats.hedgeWins = hedgeCounters.hedgeWins.load(std::memory_order_relaxed);
+    stats.budgetDenied = hedgeCounters.budgetDenied.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::vector<QueryResult> ConnectionManager::executeRemoteBatch(const std::vector<Query>& queries, int depth, const std::vector<QueryDeadline>& deadlines) {
+    std::vector<QueryResult> results(queries.size());
+    if (!isConnected() || clientCache || config.transport != Transport::TCP) {
+        for (size_t i = 0; i < queries.size(); ++i) {
+            results[i] = executeRemoteQuery(queries[i], depth, deadlines[i]);
+        }
+        return results;
+    }
+    if (queries.empty()) {
+        return results;
+    }
+
+    // The exchange runs until the latest deadline; each request carries its own to the server
+    QueryDeadline batchDeadline = deadlines.front();
+    for (const QueryDeadline& deadline : deadlines) {
+        batchDeadline.expiresAt = std::max(batchDeadline.expiresAt, deadline.expiresAt);
+    }
+
+    // Wait for one connection, then take whichever others are free right now
+    std::vector<ConnectionPool<NetworkResource>::Lease> connections;
+    std::string openError;
+    size_t wanted = std::min(connectionPool->capacity(), queries.size());
+    try {
+        if (auto first = connectionPool->checkout(batchDeadline)) {
+            connections.push_back(std::move(first));
+            while (connections.size() < wanted) {
+                auto more = connectionPool->tryCheckout();
+                if (!more) {
+                    break;
+                }
+                connections.push_back(std::move(more));
+            }
+        }
+    }
+    catch (const ConnectionError& e) {
+        openError = e.what(); // Only fatal if no connection was leased at all
+    }
+    // The batch transport reads the sockets itself, so responses abandoned by a hedge are dropped first
+    for (auto it = connections.begin(); it != connections.end();) {
+        try {
+            (*it)->drainAbandoned(batchDeadline);
+            ++it;
+        }
+        catch (const ProjectError& e) {
+            openError = e.what();
+            it->discard();
+            it = connections.erase(it);
+        }
+    }
+    if (connections.empty()) {
+        for (size_t i = 0; i < queries.size(); ++i) {
+            std::string id = std::to_string(queries[i].id);
+            results[i] = QueryResult{ queries[i].id, false, "", openError.empty()
+                ? "Timeout: No pooled connection became free for query ID " + id
+                : "Failed to open a pooled connection for query ID " + id + ": " + openError, std::chrono::milliseconds(0) };
+            results[i].timedOut = openError.empty();
+        }
+        return results;
+    }
+
+    std::vector<BatchChannel> channels(connections.size());
+    std::vector<std::vector<size_t>> assigned(connections.size()); // Query indexes in the order sent
+    for (size_t c = 0; c < connections.size(); ++c) {
+        channels[c].fd = connections[c]->nativeSocket();
+        channels[c].framed = connections[c]->isBinary();
+        channels[c].received = std::move(connections[c]->receiveBuffer());
+    }
+    for (size_t i = 0; i < queries.size(); ++i) {
+        size_t c = i % channels.size();
+        std::chrono::microseconds timeout = serverTimeout(deadlines[i]);
+        if (channels[c].framed) {
+            std::string& requests = channels[c].requests;
+            size_t offset = requests.size();
+            requests.resize(offset + wireRequestSize(queries[i], depth, timeout));
+            encodeWireRequest(queries[i], depth, timeout, std::span<char>(requests).subspan(offset));
+        }
+        else {
+            channels[c].requests += formatKvRequest(queries[i], depth, timeout);
+        }
+        ++channels[c].expectedResponses;
+        assigned[c].push_back(i);
+    }
+    {
+        std::lock_guard<std::mutex> lock(batchMutex);
+        if (!batchTransport) {
+            batchTransport = std::make_unique<BatchTransport>(ioBackend);
+        }
+        batchTransport->exchange(channels, batchDeadline);
+    }
+
+    for (size_t c = 0; c < channels.size(); ++c) {
+        BatchChannel& channel = channels[c];
+        std::string address = connections[c]->getAddress();
+        std::vector<bool> answered(assigned[c].size(), false);
+        if (channel.framed) {
+            // Each frame names the query it answers: the earliest unanswered one with that id
+            size_t firstOpen = 0;
+            for (const std::string& frame : channel.responses) {
+                try {
+                    WireResponse response = decodeWireResponse(frame);
+                    size_t k = firstOpen;
+                    while (k < assigned[c].size() && (answered[k] || queries[assigned[c][k]].id != response.queryId)) {
+                        ++k;
+                    }
+                    if (k == assigned[c].size()) {
+                        throw ParseError("Response for query ID " + std::to_string(response.queryId) + " matches no request");
+                    }
+                    results[assigned[c][k]] = response.toResult();
+                    answered[k] = true;
+                    while (firstOpen < answered.size() && answered[firstOpen]) {
+                        ++firstOpen;
+                    }
+                }
+                catch (const ParseError& e) {
+                    channel.error = e.what();
+                    break;
+                }
+            }
+        }
+        else {
+            for (size_t k = 0; k < assigned[c].size() && k < channel.responses.size(); ++k) {
+                const Query& query = queries[assigned[c][k]];
+                try {
+                    results[assigned[c][k]] = parseKvResponse(channel.responses[k], query.id);
+                }
+                catch (const ParseError& e) {
+                    results[assigned[c][k]] = QueryResult{ query.id, false, "", e.what(), std::chrono::milliseconds(0) };
+                    channel.error = e.what();
+                }
+                answered[k] = true;
+            }
+        }
+        for (size_t k = 0; k < assigned[c].size(); ++k) {
+            const Query& query = queries[assigned[c][k]];
+            QueryResult& result = results[assigned[c][k]];
+            if (answered[k]) {
+                continue;
+            }
+            if (channel.timedOut) {
+                result = QueryResult{ query.id, false, "", "Deadline exceeded waiting for " + address, std::chrono::milliseconds(0) };
+                result.timedOut = true;
+            }
+            else {
+                result = QueryResult{ query.id, false, "", channel.error + " (" + address + ")", std::chrono::milliseconds(0) };
+            }
+        }
+        // A connection with responses still on the way would answer the next request with them
+        if (channel.complete() && channel.error.empty()) {
+            connections[c]->receiveBuffer() = std::move(channel.received);
+        }
+        else {
+            connections[c].discard();
+        }
+    }
+    return results;
+}
+
+void ConnectionManager::setIoBackend(IoBackend backend) {
+    std::lock_guard<std::mutex> lock(batchMutex);
+    ioBackend = backend;
+    batchTransport.reset();
+}
+
+BatchTransportStats ConnectionManager::getBatchTransportStats() const {
+    std::lock_guard<std::mutex> lock(batchMutex);
+    return batchTransport ? batchTransport->getStats() : BatchTransportStats{};
+}
+
+QueryResult ConnectionManager::executeThroughCache(const Query& query, int depth, const QueryDeadline& deadline) {
+    if (query.type == Query::Type::GET) {
+        if (auto cached = clientCache->lookup(query.key)) {
+            QueryResult result;
+            result.queryId = query.id;
+            result.success = true;
+            result.data = std::move(*cached);
+            result.executionTime = std::chrono::milliseconds(0);
+            return result;
+        }
+        QueryResult result = sendToServer(query, depth, deadline);
+        if (result.success) {
+            clientCache->fill(query.key, result.data, result.keyVersion);
+        }
+        return result;
+    }
+
+    QueryResult result = sendToServer(query, depth, deadline);
+    if (result.success) {
+        clientCache->invalidate(query.key, result.keyVersion);
+    }
+    return result;
+}
+
+ConnectionPoolStats ConnectionManager::getConnectionPoolStats() const {
+    return connectionPool ? connectionPool->getStats() : ConnectionPoolStats{};
+}
+
+ClientCacheStats ConnectionManager::getClientCacheStats() const {
+    return clientCache ? clientCache->getStats() : ClientCacheStats{};
 }
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "diagnostics.hpp"
+#include <bit>
+#include <iostream>
+
+const char* diagnosticCodeName(DiagnosticCode code) {
+    switch (code) {
+    case DiagnosticCode::MALFORMED_QUERY_LINE: return "MalformedQueryLine";
+    case DiagnosticCode::CONNECTION_FAILURE: return "ConnectionFailure";
+    case DiagnosticCode::CONFIG_WARNING: return "ConfigWarning";
+    case DiagnosticCode::QUERY_INDEX_WARNING: return "QueryIndexWarning";
+    default: return "Unknown";
+    }
+}
+
+DiagnosticsSink& DiagnosticsSink::shared() {
+    static DiagnosticsSink sink(std::cerr);
+    return sink;
+}
+
+DiagnosticsSink::DiagnosticsSink(std::ostream& out, size_t capacity, uint32_t rateLimit)
+    : out(out), mask(std::bit_ceil(capacity > 1 ? capacity : 2) - 1), slots(new Slot[mask + 1]), rateLimit(rateLimit) {
+    for (size_t i = 0; i <= mask; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    writer = std::thread(&DiagnosticsSink::writerLoop, this);
+}
+
+DiagnosticsSink::~DiagnosticsSink() {
+    stopping.store(true, std::memory_order_release);
+    pushed.fetch_add(1, std::memory_order_release);
+    pushed.notify_one();
+    writer.join();
+    printSummary();
+}
+
+bool DiagnosticsSink::admit(CodeState& state) {
+    uint32_t limit = rateLimit.load(std::memory_order_relaxed);
+    if (limit == 0) {
+        return true;
+    }
+    constexpr int64_t window = std::chrono::nanoseconds(std::chrono::seconds(1)).count();
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t start = state.windowStart.load(std::memory_order_relaxed);
+    if (now - start >= window && state.windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+        state.windowCount.store(0, std::memory_order_relaxed);
+    }
+    return state.windowCount.fetch_add(1, std::memory_order_relaxed) < limit;
+}
+
+void DiagnosticsSink::report(DiagnosticCode code, std::string message) {
+    CodeState& state = codes[static_cast<size_t>(code)];
+    if (!admit(state)) {
+        state.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (!tryPush(code, message)) {
+        state.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    pushed.fetch_add(1, std::memory_order_release);
+    pushed.notify_one();
+}
+
+// Bounded MPMC ring after Vyukov: each slot's sequence says whether it is free for the producer at
+// position pos (sequence == pos) or holds the message for the consumer at pos (sequence == pos + 1).
+bool DiagnosticsSink::tryPush(DiagnosticCode code, std::string& message) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots[pos & mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return false; // Full
+        }
+        else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->code = code;
+    slot->message = std::move(message);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+size_t DiagnosticsSink::drain() {
+    size_t count = 0;
+    while (true) {
+        Slot& slot = slots[dequeuePos & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+            break;
+        }
+        out << slot.message << '\n';
+        codes[static_cast<size_t>(slot.code)].written.fetch_add(1, std::memory_order_relaxed);
+        slot.message.clear();
+        slot.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+        ++dequeuePos;
+        ++count;
+    }
+    if (count > 0) {
+        out.flush();
+        processed.fetch_add(count, std::memory_order_release);
+        processed.notify_all();
+    }
+    return count;
+}
+
+void DiagnosticsSink::writerLoop() {
+    while (true) {
+        // Any push that completes after this load changes pushed, so the wait below cannot miss it
+        uint64_t seen = pushed.load(std::memory_order_acquire);
+        drain();
+        if (stopping.load(std::memory_order_acquire)) {
+            drain();
+            return;
+        }
+        pushed.wait(seen, std::memory_order_acquire);
+    }
+}
+
+void DiagnosticsSink::flush() {
+    uint64_t target = enqueuePos.load(std::memory_order_acquire);
+    uint64_t done = processed.load(std::memory_order_acquire);
+    while (done < target) {
+        processed.wait(done, std::memory_order_acquire);
+        done = processed.load(std::memory_order_acquire);
+    }
+}
+
+DiagnosticsSink::Counts DiagnosticsSink::counts(DiagnosticCode code) const {
+    const CodeState& state = codes[static_cast<size_t>(code)];
+    return { state.written.load(std::memory_order_relaxed), state.suppressed.load(std::memory_order_relaxed), state.dropped.load(std::memory_order_relaxed) };
+}
+
+void DiagnosticsSink::printSummary() {
+    for (size_t i = 0; i < diagnosticCodeCount; ++i) {
+        Counts c = counts(static_cast<DiagnosticCode>(i));
+        if (c.suppressed == 0 && c.dropped == 0) {
+            continue; // Everything reported was already written
+        }
+        out << "Diagnostics summary: " << diagnosticCodeName(static_cast<DiagnosticCode>(i)) << " written " << c.written
+            << ", suppressed " << c.suppressed << ", dropped " << c.dropped << '\n';
+    }
+    out.flush();
+}
@@ -0,0 +1,110 @@
+#include "gzip_reader.hpp"
+#include "error.hpp"
+#include <zlib.h>
+
+bool GzipReader::isGzipFile(const std::string& filePath) {
+    std::ifstream in(filePath, std::ios::binary);
+    unsigned char magic[2] = {};
+    in.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    return in.gcount() == 2 && magic[0] == 0x1F && magic[1] == 0x8B;
+}
+
+GzipReader::GzipReader(const std::string& filePath, size_t blockSize) : file(filePath, std::ios::binary) {
+    if (!file.is_open()) {
+        throw IOError("Failed to open compressed file: " + filePath);
+    }
+    for (Block& block : blocks) {
+        block.bytes.resize(blockSize > 0 ? blockSize : 1);
+        freeBlocks.push(&block);
+    }
+    inflater = std::thread(&GzipReader::inflateLoop, this);
+}
+
+GzipReader::~GzipReader() {
+    freeBlocks.close();
+    filledBlocks.close();
+    inflater.join();
+}
+
+std::string_view GzipReader::next() {
+    if (current != nullptr) {
+        freeBlocks.push(current);
+        current = nullptr;
+    }
+    std::optional<Block*> block = filledBlocks.pop();
+    if (!block) {
+        if (!error.empty()) {
+            throw ParseError(error);
+        }
+        return {};
+    }
+    current = *block;
+    return std::string_view(current->bytes.data(), current->size);
+}
+
+void GzipReader::inflateLoop() {
+    using Clock = std::chrono::steady_clock;
+    z_stream stream{};
+    // 16 added to the window bits selects gzip framing
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+        error = "Failed to initialise zlib";
+        filledBlocks.close();
+        return;
+    }
+
+    std::vector<char> input(size_t(256) << 10);
+    bool memberDone = false; // The last inflate() finished a gzip member
+    bool endOfInput = false;
+    while (!endOfInput && error.empty()) {
+        std::optional<Block*> block = freeBlocks.pop();
+        if (!block) {
+            break; // Reader destroyed
+        }
+        auto busyStart = Clock::now();
+        Block* out = *block;
+        stream.next_out = reinterpret_cast<Bytef*>(out->bytes.data());
+        stream.avail_out = static_cast<uInt>(out->bytes.size());
+
+        while (stream.avail_out > 0) {
+            if (stream.avail_in == 0) {
+                file.read(input.data(), static_cast<std::streamsize>(input.size()));
+                size_t got = static_cast<size_t>(file.gcount());
+                if (got == 0) {
+                    if (file.bad()) {
+                        error = "Failed to read compressed file";
+                    }
+                    else if (!memberDone) {
+                        error = "Truncated gzip stream";
+                    }
+                    endOfInput = true;
+                    break;
+                }
+                compressedTotal.fetch_add(got, std::memory_order_release);
+                stream.next_in = reinterpret_cast<Bytef*>(input.data());
+                stream.avail_in = static_cast<uInt>(got);
+            }
+            if (memberDone) {
+                inflateReset(&stream); // Another member follows
+                memberDone = false;
+            }
+            int status = inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                memberDone = true;
+            }
+            else if (status != Z_OK && status != Z_BUF_ERROR) {
+                error = std::string("Corrupt gzip stream: ") + (stream.msg != nullptr ? stream.msg : zError(status));
+                break;
+            }
+        }
+
+        out->size = out->bytes.size() - stream.avail_out;
+        decompressedTotal.fetch_add(out->size, std::memory_order_release);
+        busyNanos.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - busyStart).count(), std::memory_order_release);
+        if (out->size > 0 && !filledBlocks.push(out)) {
+            break;
+        }
+    }
+
+    inflateEnd(&stream);
+    filledBlocks.close();
+}
@@ -0,0 +1,89 @@
+#include "kv_protocol.hpp"
+#include "error.hpp"
+#include <algorithm>
+#include <charconv>
+
+// Splits off the next space-separated field of line
+static std::string_view nextField(std::string_view& line) {
+    size_t space = line.find(' ');
+    std::string_view field = line.substr(0, space);
+    line = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+    return field;
+}
+
+template <typename Int>
+static bool parseField(std::string_view field, Int& value) {
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return error == std::errc() && end == field.data() + field.size();
+}
+
+static void appendSingleLine(std::string& out, std::string_view text) {
+    for (char c : text) {
+        out.push_back(c == '\n' || c == '\r' ? ' ' : c);
+    }
+}
+
+std::string formatKvRequest(const Query& query, int depth, std::chrono::microseconds timeout) {
+    std::string line = std::to_string(depth) + ' ' + std::to_string(timeout.count()) + ' ' + std::to_string(query.id) + ',';
+    switch (query.type) {
+    case Query::Type::GET: line += "GET "; break;
+    case Query::Type::SET: line += "SET "; break;
+    case Query::Type::DELETE: line += "DELETE "; break;
+    }
+    line += query.key;
+    if (query.type == Query::Type::SET) {
+        line += '=';
+        line += query.value.value_or("");
+    }
+    line += '\n';
+    return line;
+}
+
+KvRequest parseKvRequest(std::string_view line) {
+    KvRequest request;
+    int64_t timeoutUs = 0;
+    if (!parseField(nextField(line), request.depth) || request.depth < 0
+        || !parseField(nextField(line), timeoutUs) || timeoutUs < 0) {
+        throw ParseError("Malformed request header");
+    }
+    if (request.depth > maxKvRequestDepth) {
+        throw ParseError("Request depth " + std::to_string(request.depth) + " exceeds the limit of " + std::to_string(maxKvRequestDepth));
+    }
+    request.timeout = std::min(std::chrono::microseconds(timeoutUs), maxKvRequestTimeout);
+    request.queryLine = line;
+    return request;
+}
+
+std::string formatKvResponse(const QueryResult& result) {
+    std::string line;
+    if (result.success) {
+        line = "OK " + std::to_string(result.keyVersion) + ' ';
+        appendSingleLine(line, result.data);
+    }
+    else {
+        line = result.timedOut ? "TIMEOUT 0 " : "ERR 0 ";
+        appendSingleLine(line, result.errorMessage);
+    }
+    line += '\n';
+    return line;
+}
+
+QueryResult parseKvResponse(std::string_view line, int queryId) {
+    std::string_view status = nextField(line);
+    QueryResult result{ queryId, false, "", "", std::chrono::milliseconds(0) };
+    if (!parseField(nextField(line), result.keyVersion)) {
+        throw ParseError("Malformed response for query ID " + std::to_string(queryId));
+    }
+    if (status == "OK") {
+        result.success = true;
+        result.data.assign(line);
+    }
+    else if (status == "ERR" || status == "TIMEOUT") {
+        result.timedOut = status == "TIMEOUT";
+        result.errorMessage.assign(line);
+    }
+    else {
+        throw ParseError("Unknown response status for query ID " + std::to_string(queryId));
+    }
+    return result;
+}
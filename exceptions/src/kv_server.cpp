@@ -0,0 +1,314 @@
+#include "kv_server.hpp"
+#include "kv_protocol.hpp"
+#include "kv_wire.hpp"
+#include "query.hpp"
+#include "error.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static std::string systemError(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+KvServer::KvServer(Server& svr, uint16_t port) : server(svr) {
+    auto fail = [this](const std::string& what) {
+        ConnectionError error(systemError(what));
+        for (int fd : { listenFd, epollFd, wakeFd }) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+        throw error;
+        };
+
+    listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        fail("Failed to create listening socket");
+    }
+    int reuse = 1;
+    ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        fail("Failed to bind 127.0.0.1:" + std::to_string(port));
+    }
+    if (::listen(listenFd, SOMAXCONN) < 0) {
+        fail("Failed to listen on 127.0.0.1:" + std::to_string(port));
+    }
+    socklen_t length = sizeof(address);
+    ::getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length);
+    boundPort = ntohs(address.sin_port);
+
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        fail("Failed to create event loop");
+    }
+    for (int fd : { listenFd, wakeFd }) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            fail("Failed to watch socket");
+        }
+    }
+}
+
+KvServer::~KvServer() {
+    for (auto& [fd, client] : clients) {
+        endSharedSession(client);
+        ::close(fd);
+    }
+    ::close(listenFd);
+    ::close(epollFd);
+    ::close(wakeFd);
+}
+
+void KvServer::stop() {
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = ::write(wakeFd, &one, sizeof(one));
+}
+
+void KvServer::run() {
+    epoll_event events[64];
+    while (true) {
+        int ready = ::epoll_wait(epollFd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw ConnectionError(systemError("epoll_wait failed"));
+        }
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd) {
+                return; // The eventfd stays readable, so later calls return at once too
+            }
+            if (fd == listenFd) {
+                acceptClients();
+                continue;
+            }
+            auto it = clients.find(fd);
+            if (it == clients.end()) {
+                continue;
+            }
+            bool open = (events[i].events & EPOLLERR) == 0;
+            if (open && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP))) {
+                open = serve(fd, it->second);
+            }
+            if (open && (events[i].events & EPOLLOUT)) {
+                open = flush(fd, it->second);
+            }
+            if (!open) {
+                closeClient(fd);
+            }
+        }
+    }
+}
+
+void KvServer::acceptClients() {
+    while (true) {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return; // EAGAIN once the backlog is empty; out of descriptors leaves the rest queued
+        }
+        int noDelay = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            ::close(fd);
+            continue;
+        }
+        clients.emplace(fd, Client{});
+    }
+}
+
+// Executes one request line; malformed requests get an error response rather than closing the connection
+static std::string execute(Server& server, std::string_view line) {
+    try {
+        KvRequest request = parseKvRequest(line);
+        Query query = QueryEngine::parseQueryLine(request.queryLine, 0).materialize();
+        QueryDeadline deadline;
+        if (request.timeout.count() > 0) {
+            deadline.expiresAt = QueryDeadline::Clock::now() + request.timeout;
+        }
+        return formatKvResponse(server.processCommand(query, request.depth, deadline));
+    }
+    catch (const ParseError& e) {
+        return formatKvResponse(QueryResult{ 0, false, "", e.what(), std::chrono::milliseconds(0) });
+    }
+}
+
+// Executes one request frame and appends the response frame; a malformed body gets an error response
+void KvServer::executeFrame(Client& client, std::string_view frame) {
+    QueryResult result;
+    try {
+        WireRequest request = decodeWireRequest(frame);
+        QueryDeadline deadline;
+        if (request.timeout.count() > 0) {
+            deadline.expiresAt = QueryDeadline::Clock::now() + request.timeout;
+        }
+        result = server.processCommand(request.query.materialize(), request.depth, deadline);
+    }
+    catch (const ParseError& e) {
+        result = QueryResult{ 0, false, "", e.what(), std::chrono::milliseconds(0) };
+    }
+    size_t offset = client.output.size();
+    client.output.resize(offset + wireResponseSize(result));
+    encodeWireResponse(result, std::span<char>(client.output).subspan(offset));
+}
+
+bool KvServer::serve(int fd, Client& client) {
+    char buffer[1 << 16];
+    while (true) {
+        ssize_t received = ::read(fd, buffer, sizeof(buffer));
+        if (received == 0) {
+            return false; // Peer closed
+        }
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        client.input.append(buffer, static_cast<size_t>(received));
+
+        size_t begin = 0;
+        while (begin < client.input.size()) {
+            std::string_view rest = std::string_view(client.input).substr(begin);
+            if (client.binary) {
+                size_t size;
+                try {
+                    size = wireFrameSize(rest);
+                }
+                catch (const ParseError&) {
+                    return false; // No way to find the next frame
+                }
+                if (size == 0) {
+                    break;
+                }
+                executeFrame(client, rest.substr(0, size));
+                requests.fetch_add(1, std::memory_order_relaxed);
+                begin += size;
+                continue;
+            }
+            size_t newline = rest.find('\n');
+            if (newline == std::string_view::npos) {
+                break;
+            }
+            std::string_view line = rest.substr(0, newline);
+            begin += newline + 1;
+            if (line.starts_with("SHM ")) {
+                client.output += attachSharedMemory(client, std::string(line.substr(4)));
+                continue;
+            }
+            if (line == "BINARY") {
+                client.binary = true; // Every later request is a frame
+                client.output += formatKvResponse(QueryResult{ 0, true, "binary", "", std::chrono::milliseconds(0) });
+                continue;
+            }
+            client.output += execute(server, line);
+            requests.fetch_add(1, std::memory_order_relaxed);
+        }
+        client.input.erase(0, begin);
+    }
+    return flush(fd, client);
+}
+
+bool KvServer::flush(int fd, Client& client) {
+    while (client.outputSent < client.output.size()) {
+        ssize_t sent = ::send(fd, client.output.data() + client.outputSent, client.output.size() - client.outputSent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        client.outputSent += static_cast<size_t>(sent);
+    }
+    if (client.outputSent == client.output.size()) {
+        client.output.clear();
+        client.outputSent = 0;
+    }
+
+    // Only ask for EPOLLOUT while the socket is holding responses back
+    bool blocked = !client.output.empty();
+    if (blocked != client.writeWatched) {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP | (blocked ? static_cast<uint32_t>(EPOLLOUT) : 0);
+        event.data.fd = fd;
+        if (::epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) < 0) {
+            return false;
+        }
+        client.writeWatched = blocked;
+    }
+    return true;
+}
+
+void KvServer::closeClient(int fd) {
+    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    auto it = clients.find(fd);
+    endSharedSession(it->second);
+    clients.erase(it);
+}
+
+std::string KvServer::attachSharedMemory(Client& client, const std::string& name) {
+    if (client.shared) {
+        return formatKvResponse(QueryResult{ 0, false, "", "Connection already uses shared memory", std::chrono::milliseconds(0) });
+    }
+    auto session = std::make_unique<SharedSession>();
+    try {
+        session->region = ShmRegion::open(name);
+    }
+    catch (const ConnectionError& e) {
+        return formatKvResponse(QueryResult{ 0, false, "", e.what(), std::chrono::milliseconds(0) });
+    }
+    session->worker = std::thread([this, region = session->region.get()]() { serveShared(*region); });
+    client.shared = std::move(session);
+    return formatKvResponse(QueryResult{ 0, true, "shm", "", std::chrono::milliseconds(0) });
+}
+
+// Serves one region until either side closes it; requests are parsed where the client wrote them
+void KvServer::serveShared(ShmRegion& region) {
+    while (std::optional<std::string_view> record = region.requests().read(ShmRing::Clock::time_point::max())) {
+        std::string_view line = record->substr(0, record->size() - (record->ends_with('\n') ? 1 : 0));
+        std::string response = execute(server, line);
+        region.requests().pop();
+        requests.fetch_add(1, std::memory_order_relaxed);
+        if (response.size() > ShmRing::maxRecord) {
+            response = formatKvResponse(QueryResult{ 0, false, "", "Response too large for shared memory", std::chrono::milliseconds(0) });
+        }
+        if (!region.responses().write(response, ShmRing::Clock::time_point::max())) {
+            return;
+        }
+    }
+}
+
+void KvServer::endSharedSession(Client& client) {
+    if (client.shared) {
+        client.shared->region->close();
+        client.shared->worker.join();
+        client.shared.reset();
+    }
+}
@@ -0,0 +1,217 @@
+#include "kv_wire.hpp"
+#include "kv_protocol.hpp"
+#include "error.hpp"
+#include <algorithm>
+#include <cstring>
+
+static size_t varintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+static uint64_t zigzag(int value) {
+    uint32_t bits = static_cast<uint32_t>(value);
+    return (bits << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int unzigzag(uint64_t value) {
+    uint32_t bits = static_cast<uint32_t>(value);
+    return static_cast<int>((bits >> 1) ^ (0u - (bits & 1)));
+}
+
+static uint64_t timeoutMicros(std::chrono::microseconds timeout) {
+    return timeout.count() > 0 ? static_cast<uint64_t>(timeout.count()) : 0;
+}
+
+namespace {
+
+// Appends to a buffer already checked to be large enough
+class FrameWriter {
+public:
+    explicit FrameWriter(char* out) : cursor(out + wireFrameHeaderSize), begin(out) {}
+
+    void byte(uint8_t value) { *cursor++ = static_cast<char>(value); }
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            *cursor++ = static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        *cursor++ = static_cast<char>(value);
+    }
+    void bytes(std::string_view value) {
+        varint(value.size());
+        std::memcpy(cursor, value.data(), value.size());
+        cursor += value.size();
+    }
+    // Fills in the length prefix; returns the frame size
+    size_t finish() {
+        uint32_t length = static_cast<uint32_t>(cursor - begin - wireFrameHeaderSize);
+        for (size_t i = 0; i < wireFrameHeaderSize; ++i) {
+            begin[i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+        }
+        return static_cast<size_t>(cursor - begin);
+    }
+
+private:
+    char* cursor;
+    char* begin;
+};
+
+class FrameReader {
+public:
+    explicit FrameReader(std::string_view frame) : body(frame.substr(wireFrameHeaderSize)) {}
+
+    uint8_t byte() {
+        if (offset >= body.size()) {
+            throw ParseError("Truncated wire frame");
+        }
+        return static_cast<uint8_t>(body[offset++]);
+    }
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t next = byte();
+            value |= uint64_t(next & 0x7F) << shift;
+            if ((next & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw ParseError("Malformed varint in wire frame");
+    }
+    std::string_view bytes() {
+        uint64_t length = varint();
+        if (length > body.size() - offset) {
+            throw ParseError("Truncated wire frame");
+        }
+        std::string_view value = body.substr(offset, length);
+        offset += length;
+        return value;
+    }
+    void finish() const {
+        if (offset != body.size()) {
+            throw ParseError("Trailing bytes in wire frame");
+        }
+    }
+
+private:
+    std::string_view body;
+    size_t offset = 0;
+};
+
+} // namespace
+
+QueryResult WireResponse::toResult() const {
+    QueryResult result{ queryId, status == WireStatus::OK, "", "", std::chrono::milliseconds(0) };
+    (result.success ? result.data : result.errorMessage).assign(payload);
+    result.keyVersion = keyVersion;
+    result.timedOut = status == WireStatus::TIMEOUT;
+    return result;
+}
+
+size_t wireRequestSize(const Query& query, int depth, std::chrono::microseconds timeout) {
+    size_t size = wireFrameHeaderSize + 1 + varintSize(zigzag(query.id)) + varintSize(static_cast<uint64_t>(std::max(depth, 0)))
+        + varintSize(timeoutMicros(timeout)) + varintSize(query.key.size()) + query.key.size();
+    if (query.value) {
+        size += varintSize(query.value->size()) + query.value->size();
+    }
+    return size;
+}
+
+size_t wireResponseSize(const QueryResult& result) {
+    const std::string& payload = result.success ? result.data : result.errorMessage;
+    return wireFrameHeaderSize + 1 + varintSize(zigzag(result.queryId)) + varintSize(0) + varintSize(result.keyVersion)
+        + varintSize(payload.size()) + payload.size();
+}
+
+size_t encodeWireRequest(const Query& query, int depth, std::chrono::microseconds timeout, std::span<char> out) {
+    if (out.size() < wireRequestSize(query, depth, timeout)) {
+        return 0;
+    }
+    uint8_t tag = static_cast<uint8_t>(query.type) | static_cast<uint8_t>(static_cast<uint8_t>(query.priority) << 2);
+    if (query.value) {
+        tag |= 1 << 4;
+    }
+    FrameWriter writer(out.data());
+    writer.byte(tag);
+    writer.varint(zigzag(query.id));
+    writer.varint(static_cast<uint64_t>(std::max(depth, 0)));
+    writer.varint(timeoutMicros(timeout));
+    writer.bytes(query.key);
+    if (query.value) {
+        writer.bytes(*query.value);
+    }
+    return writer.finish();
+}
+
+size_t encodeWireResponse(const QueryResult& result, std::span<char> out) {
+    if (out.size() < wireResponseSize(result)) {
+        return 0;
+    }
+    WireStatus status = result.success ? WireStatus::OK : result.timedOut ? WireStatus::TIMEOUT : WireStatus::ERR;
+    FrameWriter writer(out.data());
+    writer.byte(static_cast<uint8_t>(status));
+    writer.varint(zigzag(result.queryId));
+    writer.varint(0);
+    writer.varint(result.keyVersion);
+    writer.bytes(result.success ? result.data : result.errorMessage);
+    return writer.finish();
+}
+
+size_t wireFrameSize(std::string_view data) {
+    if (data.size() < wireFrameHeaderSize) {
+        return 0;
+    }
+    uint32_t length = 0;
+    for (size_t i = 0; i < wireFrameHeaderSize; ++i) {
+        length |= uint32_t(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    if (length > maxWireFrameSize) {
+        throw ParseError("Wire frame of " + std::to_string(length) + " bytes exceeds the limit");
+    }
+    size_t size = wireFrameHeaderSize + length;
+    return data.size() < size ? 0 : size;
+}
+
+WireRequest decodeWireRequest(std::string_view frame) {
+    FrameReader reader(frame);
+    WireRequest request;
+    uint8_t tag = reader.byte();
+    if ((tag & 0x03) > static_cast<uint8_t>(Query::Type::DELETE) || ((tag >> 2) & 0x03) > static_cast<uint8_t>(Query::Priority::BULK) || (tag & ~0x1F) != 0) {
+        throw ParseError("Invalid request tag in wire frame");
+    }
+    request.query.type = static_cast<Query::Type>(tag & 0x03);
+    request.query.priority = static_cast<Query::Priority>((tag >> 2) & 0x03);
+    request.query.id = unzigzag(reader.varint());
+    uint64_t depth = reader.varint();
+    if (depth > static_cast<uint64_t>(maxKvRequestDepth)) {
+        throw ParseError("Request depth " + std::to_string(depth) + " exceeds the limit of " + std::to_string(maxKvRequestDepth));
+    }
+    request.depth = static_cast<int>(depth);
+    request.timeout = std::chrono::microseconds(static_cast<int64_t>(std::min<uint64_t>(reader.varint(), maxKvRequestTimeout.count())));
+    request.query.key = reader.bytes();
+    if (tag & (1 << 4)) {
+        request.query.value = reader.bytes();
+    }
+    reader.finish();
+    return request;
+}
+
+WireResponse decodeWireResponse(std::string_view frame) {
+    FrameReader reader(frame);
+    WireResponse response;
+    uint8_t status = reader.byte();
+    if (status > static_cast<uint8_t>(WireStatus::TIMEOUT)) {
+        throw ParseError("Invalid response status in wire frame");
+    }
+    response.status = static_cast<WireStatus>(status);
+    response.queryId = unzigzag(reader.varint());
+    response.errorCode = static_cast<uint32_t>(std::min<uint64_t>(reader.varint(), UINT32_MAX));
+    response.keyVersion = reader.varint();
+    response.payload = reader.bytes();
+    reader.finish();
+    return response;
+}
@@ -0,0 +1,56 @@
+// Runs a Server behind the loopback TCP and shared-memory transports until SIGINT or SIGTERM.
+// Usage: kvserver [port]    (port 0, the default, picks a free one)
+// Prints "kvserver listening on 127.0.0.1:<port>" once it accepts connections.
+#include "kv_server.hpp"
+#include "server.hpp"
+#include "error.hpp"
+
+#include <csignal>
+#include <iostream>
+#include <string>
+
+static KvServer* runningServer = nullptr;
+
+static void handleStopSignal(int) {
+    if (runningServer != nullptr) {
+        runningServer->stop();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2) {
+        std::cerr << "Usage: kvserver [port]" << std::endl;
+        return 2;
+    }
+    int port = 0;
+    if (argc == 2) {
+        try {
+            port = std::stoi(argv[1]);
+        }
+        catch (const std::exception&) {
+            port = -1;
+        }
+        if (port < 0 || port > 65535) {
+            std::cerr << "FATAL [kvserver]: Invalid port " << argv[1] << std::endl;
+            return 2;
+        }
+    }
+
+    try {
+        Server server;
+        KvServer kvServer(server, static_cast<uint16_t>(port));
+        runningServer = &kvServer;
+        std::signal(SIGINT, handleStopSignal);
+        std::signal(SIGTERM, handleStopSignal);
+
+        std::cout << "kvserver listening on 127.0.0.1:" << kvServer.port() << std::endl;
+        kvServer.run();
+        runningServer = nullptr;
+        std::cout << "kvserver served " << kvServer.requestsServed() << " requests" << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "FATAL [kvserver]: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
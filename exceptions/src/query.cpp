@@ -1,14 +1,30 @@
 #include "query.hpp"
+#include "mapped_file.hpp"
+#include "delimiter_scan.hpp"
+#include "bounded_queue.hpp"
+#include "query_binary.hpp"
+#include "diagnostics.hpp"
+#include "gzip_reader.hpp"
+#include "query_index.hpp"
 #include <thread>  
 #include <numeric>  
 #include <algorithm>
 #include <sstream>
 #include <iostream>
+#include <charconv>
+#include <future>
 #include <fstream>
 
 // Initialize static member for QueryResource
 int QueryResource::next_handle = 0;
 
+QueryEngine::QueryEngine(ConnectionManager& connManager, ExecutionMode mode) : connectionManager(connManager), executionMode(mode) {
+    if (executionMode == ExecutionMode::PREALLOCATED_SLOTS) {
+        // Dispatch weights for INTERACTIVE, NORMAL and BULK queries while they compete for workers
+        workerPool = std::make_unique<WorkerPool>(std::thread::hardware_concurrency(), std::vector<unsigned>{ 16, 4, 1 });
+    }
+}
+
 void QueryResult::print() const {
     if (success) {
         std::cout << ("Query ID " + std::to_string(queryId) + " executed successfully: " + data) << std::endl;
@@ -18,11 +34,16 @@ void QueryResult::print() const {
     }
 }
 
-QueryResult QueryEngine::executeSingleQuery(const Query& query, int depth) {
+QueryResult QueryEngine::executeSingleQuery(const Query& query, int depth, const QueryDeadline& deadline) {
+    if (deadline.expired()) {
+        QueryResult timeoutResult{ query.id, false, "", "Timeout: Deadline exceeded before query ID " + std::to_string(query.id) + " was dispatched", std::chrono::milliseconds(0) };
+        timeoutResult.timedOut = true;
+        return timeoutResult;
+    }
     auto startTime = std::chrono::high_resolution_clock::now();
     QueryResult result;
     result.queryId = query.id;
-    result = connectionManager.executeRemoteQuery(query, depth);
+    result = dispatchQuery(query, depth, deadline);
     auto endTime = std::chrono::high_resolution_clock::now();
     if (result.success)
         result.executionTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
@@ -30,25 +51,435 @@ QueryResult QueryEngine::executeSingleQuery(const Query& query, int depth) {
     return result;
 }
 
+QueryResult QueryEngine::dispatchQuery(const Query& query, int depth, const QueryDeadline& deadline) {
+    if (!coalesceGets) {
+        return connectionManager.executeRemoteQuery(query, depth, deadline);
+    }
+
+    if (query.type == Query::Type::GET) {
+        QueryResult result = inFlightGets.run(query.key, [&]() {
+            return connectionManager.executeRemoteQuery(query, depth, deadline);
+            });
+        result.queryId = query.id;
+        return result;
+    }
+
+    QueryResult result = connectionManager.executeRemoteQuery(query, depth, deadline);
+    // GETs issued after this write must not join a flight that started before it
+    inFlightGets.invalidate(query.key);
+    return result;
+}
+
+// Whitespace as understood by operator>> in the classic locale
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Returns the next whitespace-delimited token of rest and advances rest past it
+static std::string_view nextToken(std::string_view& rest) {
+    size_t begin = 0;
+    while (begin < rest.size() && isSpace(rest[begin])) {
+        ++begin;
+    }
+    size_t end = begin;
+    while (end < rest.size() && !isSpace(rest[end])) {
+        ++end;
+    }
+    std::string_view token = rest.substr(begin, end - begin);
+    rest.remove_prefix(end);
+    return token;
+}
+
+Query QueryView::materialize() const {
+    Query query;
+    query.id = id;
+    query.type = type;
+    query.priority = priority;
+    if (!rawCommand.empty()) {
+        query.rawCommand.assign(rawCommand);
+    }
+    else {
+        switch (type) {
+        case Query::Type::GET: query.rawCommand = "GET "; break;
+        case Query::Type::SET: query.rawCommand = "SET "; break;
+        case Query::Type::DELETE: query.rawCommand = "DELETE "; break;
+        }
+        query.rawCommand.append(key);
+        if (type == Query::Type::SET) {
+            query.rawCommand.push_back('=');
+            query.rawCommand.append(value.value_or(std::string_view()));
+        }
+    }
+    query.key.assign(key);
+    if (value) {
+        query.value.emplace(*value);
+    }
+    return query;
+}
+
+// Parses the optional trailing ",<priority>" field of a query line
+static std::optional<Query::Priority> priorityFromString(std::string_view name) {
+    if (name == "interactive") return Query::Priority::INTERACTIVE;
+    if (name == "normal") return Query::Priority::NORMAL;
+    if (name == "bulk") return Query::Priority::BULK;
+    return std::nullopt;
+}
+
+// Builds a query straight from the delimiter positions of a line in the canonical "id,TYPE key[=value][,priority]" form.
+// Returns false for any other shape, including malformed lines, so parseQueryLine stays the single authority.
+static bool parseDelimitedLine(std::string_view line, const LineDelimiters& delimiters, QueryView& q) {
+    const uint32_t* pos = delimiters.positions;
+    size_t count = delimiters.count;
+    if (delimiters.overflow || count < 2 || line[pos[0]] != ',' || line[pos[1]] != ' ') {
+        return false;
+    }
+    auto [idEnd, idError] = std::from_chars(line.data(), line.data() + pos[0], q.id);
+    if (idError != std::errc() || idEnd != line.data() + pos[0]) {
+        return false;
+    }
+
+    std::string_view typeToken = line.substr(pos[0] + 1, pos[1] - pos[0] - 1);
+    size_t keyStart = pos[1] + 1;
+    size_t valueStart = 0;
+    size_t next = 2;
+    if (typeToken == "SET") {
+        if (count < 3 || line[pos[2]] != '=') {
+            return false;
+        }
+        q.type = Query::Type::SET;
+        q.key = line.substr(keyStart, pos[2] - keyStart);
+        valueStart = pos[2] + 1;
+        next = 3;
+    }
+    else if (typeToken == "GET") {
+        q.type = Query::Type::GET;
+    }
+    else if (typeToken == "DELETE") {
+        q.type = Query::Type::DELETE;
+    }
+    else {
+        return false;
+    }
+
+    size_t fieldEnd = line.size();
+    if (next < count) {
+        // Only a trailing ",priority" may follow the last field
+        if (next + 1 != count || line[pos[next]] != ',') {
+            return false;
+        }
+        auto priority = priorityFromString(line.substr(pos[next] + 1));
+        if (!priority) {
+            return false;
+        }
+        q.priority = *priority;
+        fieldEnd = pos[next];
+    }
+    if (q.type == Query::Type::SET) {
+        q.value = line.substr(valueStart, fieldEnd - valueStart);
+    }
+    else {
+        q.key = line.substr(keyStart, fieldEnd - keyStart);
+    }
+    if (q.key.empty()) {
+        return false;
+    }
+    q.rawCommand = line.substr(pos[0] + 1, fieldEnd - pos[0] - 1);
+    return true;
+}
+
+QueryView QueryEngine::parseQueryLine(std::string_view line, int) { // Callers report the line number
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    if (line.empty()) {
+        throw ParseError("Missing ID!");
+    }
+    size_t commaPos = line.find(',');
+    std::string_view idToken = line.substr(0, commaPos);
+    std::string_view command = commaPos == std::string_view::npos ? std::string_view() : line.substr(commaPos + 1);
+    if (command.empty()) {
+        throw ParseError("Missing command!");
+    }
+
+    QueryView q;
+    while (!idToken.empty() && isSpace(idToken.front())) {
+        idToken.remove_prefix(1);
+    }
+    auto [idEnd, idError] = std::from_chars(idToken.data(), idToken.data() + idToken.size(), q.id);
+    if (idError != std::errc() || std::string_view(idEnd, idToken.data() + idToken.size() - idEnd).find_first_not_of(" \t") != std::string_view::npos) {
+        throw ParseError("Invalid ID!");
+    }
+
+    if (size_t priorityPos = command.rfind(','); priorityPos != std::string_view::npos) {
+        if (auto priority = priorityFromString(command.substr(priorityPos + 1))) {
+            q.priority = *priority;
+            command = command.substr(0, priorityPos);
+        }
+    }
+    q.rawCommand = command;
+
+    std::string_view rest = command;
+    std::string_view typeToken = nextToken(rest);
+    if (typeToken == "GET") {
+        q.type = Query::Type::GET;
+        q.key = nextToken(rest);
+    }
+    else if (typeToken == "SET") {
+        q.type = Query::Type::SET;
+        std::string_view pair = nextToken(rest);
+        size_t eqPos = pair.find('=');
+        if (eqPos == std::string_view::npos) {
+            throw ParseError("Malformed SET");
+        }
+        q.key = pair.substr(0, eqPos);
+        q.value = pair.substr(eqPos + 1);
+    }
+    else if (typeToken == "DELETE") {
+        q.type = Query::Type::DELETE;
+        q.key = nextToken(rest);
+    }
+    else {
+        throw ParseError("Invalid command type");
+    }
+    if (q.key.empty()) {
+        throw ParseError("Missing key");
+    }
+    return q;
+}
+
+// Splits text into at most chunkCount ranges that each end right after a '\n' (or at the end of text).
+// Chunks are kept above a minimum size so small files are not spread over idle threads.
+static std::vector<std::string_view> splitAtLineBoundaries(std::string_view text, size_t chunkCount) {
+    constexpr size_t minChunkBytes = size_t(1) << 16;
+    chunkCount = std::max<size_t>(1, std::min(chunkCount, text.size() / minChunkBytes));
+    std::vector<std::string_view> chunks;
+    size_t begin = 0;
+    for (size_t i = 1; i <= chunkCount && begin < text.size(); ++i) {
+        size_t end = text.size();
+        if (i < chunkCount) {
+            size_t newline = text.find('\n', std::max(begin, text.size() / chunkCount * i));
+            end = newline == std::string_view::npos ? text.size() : newline + 1;
+        }
+        chunks.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+    return chunks;
+}
+
+int QueryEngine::scanQueryText(std::string_view text, const std::function<void(const QueryView&)>& onQuery, const std::function<void(int, const std::string&)>& onMalformed) const {
+    int lineNumber = 0;
+    scanner.forEachLine(text, [&](std::string_view line, const LineDelimiters& delimiters) {
+        ++lineNumber;
+        QueryView query;
+        if (!parseDelimitedLine(line, delimiters, query)) {
+            try {
+                query = parseQueryLine(line, lineNumber);
+            }
+            catch (const ParseError& err) {
+                onMalformed(lineNumber, err.what());
+                return;
+            }
+        }
+        onQuery(query);
+        });
+    return lineNumber;
+}
+
+static void reportMalformedLine(int lineNumber, const std::string& message) {
+    DiagnosticsSink::shared().report(DiagnosticCode::MALFORMED_QUERY_LINE, "Skipping malformed line " + std::to_string(lineNumber) + ": " + message);
+}
+
+// A sidecar that cannot be written only costs the next replay a rebuild
+static void saveSidecarIndex(const std::string& filePath, const QueryFileIndex& index) {
+    if (!index.save(filePath)) {
+        DiagnosticsSink::shared().report(DiagnosticCode::QUERY_INDEX_WARNING, "Could not write query index " + QueryFileIndex::sidecarPath(filePath));
+    }
+}
+
+size_t QueryEngine::scanQueriesFromMappedFile(const std::string& filePath, const std::function<void(const QueryView&)>& onQuery) {
+    MappedFile file(filePath);
+    size_t parsed = 0;
+    scanQueryText(file.view(), [&](const QueryView& query) {
+        onQuery(query);
+        ++parsed;
+        }, reportMalformedLine);
+    return parsed;
+}
+
+std::vector<Query> QueryEngine::parseQueriesFromMappedFile(const std::string& filePath, size_t threadCount) {
+    MappedFile file(filePath);
+    if (sidecarIndexStride > 0 && !QueryFileIndex::load(filePath)) {
+        saveSidecarIndex(filePath, QueryFileIndex::build(file.view(), sidecarIndexStride));
+    }
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Each chunk numbers its lines from 1; malformed lines are reported once every chunk's line count is known
+    struct ChunkResult {
+        std::vector<Query> queries;
+        std::vector<std::pair<int, std::string>> malformed;
+        int lineCount = 0;
+    };
+    std::vector<std::string_view> chunks = splitAtLineBoundaries(file.view(), threadCount);
+    std::vector<ChunkResult> results(chunks.size());
+    auto parseChunk = [&](size_t index) {
+        ChunkResult& result = results[index];
+        result.lineCount = scanQueryText(chunks[index], [&](const QueryView& query) {
+            result.queries.push_back(query.materialize());
+            }, [&](int lineNumber, const std::string& message) {
+                result.malformed.emplace_back(lineNumber, message);
+            });
+        };
+
+    std::vector<std::future<void>> futures;
+    for (size_t i = 1; i < chunks.size(); ++i) {
+        futures.push_back(std::async(std::launch::async, parseChunk, i));
+    }
+    if (!chunks.empty()) {
+        parseChunk(0);
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    size_t total = 0;
+    for (const auto& result : results) {
+        total += result.queries.size();
+    }
+    std::vector<Query> queries;
+    queries.reserve(total);
+    int lineOffset = 0;
+    for (auto& result : results) {
+        for (const auto& [lineNumber, message] : result.malformed) {
+            reportMalformedLine(lineOffset + lineNumber, message);
+        }
+        std::move(result.queries.begin(), result.queries.end(), std::back_inserter(queries));
+        lineOffset += result.lineCount;
+    }
+    return queries;
+}
+
+size_t QueryEngine::scanCompiledQueries(const std::string& filePath, const std::function<void(const QueryView&)>& onQuery) {
+    MappedFile file(filePath);
+    CompiledQueryReader reader(file.view());
+    QueryView query;
+    size_t scanned = 0;
+    while (reader.next(query)) {
+        onQuery(query);
+        ++scanned;
+    }
+    return scanned;
+}
+
+std::vector<Query> QueryEngine::loadCompiledQueries(const std::string& filePath) {
+    MappedFile file(filePath);
+    CompiledQueryReader reader(file.view());
+    std::vector<Query> queries;
+    queries.reserve(reader.size());
+    QueryView query;
+    while (reader.next(query)) {
+        queries.push_back(query.materialize());
+    }
+    return queries;
+}
+
+std::vector<Query> QueryEngine::parseQueriesFromGzipFile(const std::string& filePath, IngestStats* stats) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    std::chrono::nanoseconds parseBusy{ 0 };
+    GzipReader reader(filePath);
+    std::vector<Query> queries;
+    std::string carry; // Incomplete last line of the previous block
+    int lineOffset = 0;
+    auto parseText = [&](std::string_view text) {
+        int lines = scanQueryText(text, [&](const QueryView& query) {
+            queries.push_back(query.materialize());
+            }, [&](int lineNumber, const std::string& message) {
+                reportMalformedLine(lineOffset + lineNumber, message);
+            });
+        lineOffset += lines;
+        };
+
+    for (std::string_view text = reader.next(); !text.empty(); text = reader.next()) {
+        auto parseStart = Clock::now();
+        if (!carry.empty()) {
+            size_t firstNewline = text.find('\n');
+            carry.append(text.substr(0, firstNewline == std::string_view::npos ? text.size() : firstNewline + 1));
+            if (firstNewline == std::string_view::npos) {
+                parseBusy += Clock::now() - parseStart;
+                continue;
+            }
+            parseText(carry);
+            carry.clear();
+            text.remove_prefix(firstNewline + 1);
+        }
+        size_t lastNewline = text.rfind('\n');
+        size_t complete = lastNewline == std::string_view::npos ? 0 : lastNewline + 1;
+        if (complete > 0) {
+            parseText(text.substr(0, complete));
+        }
+        carry.assign(text.substr(complete));
+        parseBusy += Clock::now() - parseStart;
+    }
+    if (!carry.empty()) {
+        auto parseStart = Clock::now();
+        parseText(carry);
+        parseBusy += Clock::now() - parseStart;
+    }
+
+    if (stats != nullptr) {
+        stats->compressedBytes = reader.compressedBytes();
+        stats->decompressedBytes = reader.decompressedBytes();
+        stats->decompressBusy = reader.decompressBusy();
+        stats->parseBusy = parseBusy;
+        stats->elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    }
+    return queries;
+}
+
 std::vector<Query> QueryEngine::parseQueriesFromFile(const std::string& filePath) {
+    if (GzipReader::isGzipFile(filePath)) {
+        return parseQueriesFromGzipFile(filePath);
+    }
     std::ifstream file(filePath);
     if (!file.is_open()) {
         throw std::runtime_error("Error: Could not open file " + filePath);
     }
+    std::optional<QueryFileIndex> index;
+    if (sidecarIndexStride > 0 && !QueryFileIndex::load(filePath)) {
+        index.emplace(sidecarIndexStride);
+    }
+    uint64_t offset = 0;
     std::vector<Query> queries;
     std::string line;
     int lineNumber = 0;
     while (std::getline(file, line)) {
         lineNumber++;
+        if (index) {
+            index->addLine(offset, line);
+            offset += line.size() + (file.eof() ? 0 : 1); // The last line may lack a newline
+        }
         std::stringstream ss(line);
         std::string id_token, command_token;
         Query q;
         try {
             if (!std::getline(ss, id_token, ',')) 
                 throw ParseError("Missing ID!");
-            q.id = std::stoi(id_token);
+            try {
+                q.id = std::stoi(id_token);
+            }
+            catch (const std::logic_error&) { // std::invalid_argument or std::out_of_range
+                throw ParseError("Invalid ID!");
+            }
             if (!std::getline(ss, command_token)) 
                 throw ParseError("Missing command!");
+            if (size_t priorityPos = command_token.rfind(','); priorityPos != std::string::npos) {
+                if (auto priority = priorityFromString(command_token.substr(priorityPos + 1))) {
+                    q.priority = *priority;
+                    command_token.erase(priorityPos);
+                }
+            }
             q.rawCommand = command_token;
             std::stringstream command_ss(q.rawCommand);
             std::string type_str;
@@ -79,25 +510,180 @@ std::vector<Query> QueryEngine::parseQueriesFromFile(const std::string& filePath
             queries.push_back(q);
         }
         catch (const ParseError& err) {
-            std::cerr << "Skipping malformed line " << lineNumber << ": " << err.what() << std::endl;
+            reportMalformedLine(lineNumber, err.what());
         }
     }
+    if (index) {
+        index->finish(offset);
+        saveSidecarIndex(filePath, *index);
+    }
     return queries;
 }
 
+std::vector<Query> QueryEngine::parseQueriesFromFile(const std::string& filePath, int firstId, int lastId) {
+    auto inRange = [&](int id) { return id >= firstId && id <= lastId; };
+    if (GzipReader::isGzipFile(filePath)) {
+        std::vector<Query> queries = parseQueriesFromGzipFile(filePath);
+        std::erase_if(queries, [&](const Query& query) { return !inRange(query.id); });
+        return queries;
+    }
 
-std::vector<QueryResult> QueryEngine::executeQueries(const std::vector<Query>& queries, int depth) {
+    MappedFile file(filePath);
+    std::optional<QueryFileIndex> index = QueryFileIndex::load(filePath);
+    if (!index || index->byteRange(0, index->blocks().size()).second != file.size()) {
+        index = QueryFileIndex::build(file.view(), sidecarIndexStride > 0 ? sidecarIndexStride : QueryFileIndex::defaultStride);
+        saveSidecarIndex(filePath, *index);
+    }
+
+    std::vector<Query> queries;
+    for (auto [beginBlock, endBlock] : index->blocksForIds(firstId, lastId)) {
+        auto [begin, end] = index->byteRange(beginBlock, endBlock);
+        int lineOffset = static_cast<int>(beginBlock * index->stride());
+        scanQueryText(file.view().substr(begin, end - begin), [&](const QueryView& query) {
+            if (inRange(query.id)) {
+                queries.push_back(query.materialize());
+            }
+            }, [&](int lineNumber, const std::string& message) {
+                reportMalformedLine(lineOffset + lineNumber, message);
+            });
+    }
+    return queries;
+}
+
+
+std::vector<QueryResult> QueryEngine::executeQueries(const std::vector<Query>& queries, int depth, std::stop_token stopToken) {
     if (queries.empty()) {
         return {};
     }
 
+    BatchDeadline batch;
+    batch.startedAt = QueryDeadline::Clock::now();
+    batch.limit.stopToken = std::move(stopToken);
+    if (batchTimeout.count() > 0) {
+        batch.limit.expiresAt = batch.startedAt + batchTimeout;
+    }
+
+    if (executionMode == ExecutionMode::PREALLOCATED_SLOTS) {
+        return executeIntoSlots(queries, depth, batch);
+    }
+    if (executionMode == ExecutionMode::PIPELINED_BATCH) {
+        return executePipelined(queries, depth, batch);
+    }
+    return executeWithFutures(queries, depth, batch);
+}
+
+PipelineStats QueryEngine::executeQueryFilePipelined(const std::string& filePath, int depth, size_t batchSize, size_t queueCapacity,
+    const std::function<void(const std::vector<Query>&, std::vector<QueryResult>&)>& onResults, std::stop_token stopToken) {
+    using Clock = std::chrono::steady_clock;
+    auto openedAt = Clock::now();
+    batchSize = std::max<size_t>(1, batchSize);
+    PipelineStats stats;
+    BoundedQueue<std::vector<Query>> queue(queueCapacity);
+    std::exception_ptr parseError;
+
+    std::thread parser([&]() {
+        auto parseStart = Clock::now();
+        std::vector<Query> batch;
+        batch.reserve(batchSize);
+        bool accepting = true;
+        auto pushBatch = [&]() {
+            auto waitStart = Clock::now();
+            accepting = queue.push(std::move(batch));
+            stats.parseBlocked += Clock::now() - waitStart;
+            batch = std::vector<Query>();
+            batch.reserve(batchSize);
+            };
+        try {
+            scanQueriesFromMappedFile(filePath, [&](const QueryView& query) {
+                // Once the executor has stopped the remaining lines are only scanned, not materialised
+                if (!accepting) {
+                    return;
+                }
+                batch.push_back(query.materialize());
+                ++stats.parsedQueries;
+                if (batch.size() == batchSize) {
+                    pushBatch();
+                }
+                });
+        }
+        catch (...) {
+            parseError = std::current_exception();
+        }
+        if (accepting && !batch.empty()) {
+            pushBatch();
+        }
+        stats.parseBusy = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - parseStart) - stats.parseBlocked;
+        queue.close();
+        });
+
+    size_t depthSamples = 0;
+    try {
+        for (;;) {
+            if (stopToken.stop_requested()) {
+                break;
+            }
+            auto waitStart = Clock::now();
+            size_t queuedBatches = queue.size();
+            std::optional<std::vector<Query>> batch = queue.pop();
+            auto executeStart = Clock::now();
+            stats.executeStarved += executeStart - waitStart;
+            if (!batch) {
+                break;
+            }
+            stats.averageQueueDepth += static_cast<double>(queuedBatches);
+            stats.maxQueueDepth = std::max(stats.maxQueueDepth, queuedBatches);
+            ++depthSamples;
+
+            std::vector<QueryResult> results = executeQueries(*batch, depth, stopToken);
+            auto executeEnd = Clock::now();
+            stats.executeBusy += executeEnd - executeStart;
+            if (stats.batches == 0) {
+                stats.firstResultLatency = executeEnd - openedAt;
+            }
+            ++stats.batches;
+            stats.executedQueries += batch->size();
+            if (onResults) {
+                onResults(*batch, results);
+            }
+        }
+    }
+    catch (...) {
+        queue.close();
+        parser.join();
+        throw;
+    }
+    // Unblocks the parser if the executor stopped early
+    queue.close();
+    parser.join();
+    if (parseError) {
+        std::rethrow_exception(parseError);
+    }
+
+    if (depthSamples > 0) {
+        stats.averageQueueDepth /= static_cast<double>(depthSamples);
+    }
+    stats.elapsed = Clock::now() - openedAt;
+    return stats;
+}
+
+QueryDeadline QueryEngine::deadlineFor(const Query& query, const BatchDeadline& batch) const {
+    QueryDeadline deadline = batch.limit;
+    std::chrono::microseconds timeout = query.timeout.value_or(queryTimeout);
+    if (timeout.count() > 0) {
+        deadline.expiresAt = std::min(deadline.expiresAt, batch.startedAt + timeout);
+    }
+    return deadline;
+}
+
+std::vector<QueryResult> QueryEngine::executeWithFutures(const std::vector<Query>& queries, int depth, const BatchDeadline& batch) {
+
     std::vector<std::future<QueryResult>> futures;
     std::vector<QueryResult> results;
 
     // Launch queries asynchronously
     for (const auto& query : queries) {
-        futures.push_back(std::async(std::launch::async, [this, query, depth]() { 
-            return executeSingleQuery(query, depth);
+        futures.push_back(std::async(std::launch::async, [this, query, depth, deadline = deadlineFor(query, batch)]() { 
+            return executeSingleQuery(query, depth, deadline);
             }));
     }
 
@@ -116,4 +702,43 @@ std::vector<QueryResult> QueryEngine::executeQueries(const std::vector<Query>& q
     }
 
     return results;
-}
\ No newline at end of file
+}
+
+std::vector<QueryResult> QueryEngine::executeIntoSlots(const std::vector<Query>& queries, int depth, const BatchDeadline& batch) {
+    // Every slot is sized up front; workers only ever write to their own index.
+    std::vector<QueryResult> results(queries.size());
+
+    workerPool->run(queries.size(), [&](size_t i) {
+        try {
+            results[i] = executeSingleQuery(queries[i], depth, deadlineFor(queries[i], batch));
+        }
+        catch (const std::exception& e) {
+            QueryResult& errorResult = results[i];
+            errorResult.queryId = queries[i].id;
+            errorResult.success = false;
+            errorResult.errorMessage = "Worker execution failed: " + std::string(e.what());
+            errorResult.executionTime = std::chrono::milliseconds(0);
+        }
+        },
+        [&](size_t i) { return static_cast<size_t>(queries[i].priority); });
+
+    return results;
+}
+
+std::vector<QueryResult> QueryEngine::executePipelined(const std::vector<Query>& queries, int depth, const BatchDeadline& batch) {
+    std::vector<QueryDeadline> deadlines;
+    deadlines.reserve(queries.size());
+    for (const Query& query : queries) {
+        deadlines.push_back(deadlineFor(query, batch));
+    }
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::vector<QueryResult> results = connectionManager.executeRemoteBatch(queries, depth, deadlines);
+    // Every query waited for the whole round trip of the batch
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime);
+    for (QueryResult& result : results) {
+        if (result.success) {
+            result.executionTime = elapsed;
+        }
+    }
+    return results;
+}
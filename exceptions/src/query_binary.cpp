@@ -0,0 +1,125 @@
+#include "query_binary.hpp"
+#include "error.hpp"
+#include <cstring>
+
+static constexpr char compiledQueryMagic[4] = { 'Q', 'B', 'I', 'N' };
+
+static void appendLittleEndian(std::string& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static uint64_t readLittleEndian(const char* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= uint64_t(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+static void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void CompiledQueryWriter::append(const QueryView& query) {
+    uint8_t tag = static_cast<uint8_t>(query.type) | static_cast<uint8_t>(static_cast<uint8_t>(query.priority) << 2);
+    if (query.value) {
+        tag |= 1 << 4;
+    }
+    records.push_back(static_cast<char>(tag));
+    // Zigzag keeps small negative ids short
+    uint32_t id = static_cast<uint32_t>(query.id);
+    appendVarint(records, (id << 1) ^ static_cast<uint32_t>(query.id >> 31));
+    appendVarint(records, query.key.size());
+    records.append(query.key);
+    if (query.value) {
+        appendVarint(records, query.value->size());
+        records.append(*query.value);
+    }
+    ++count;
+}
+
+std::string CompiledQueryWriter::finish() {
+    std::string out;
+    out.reserve(compiledQueryHeaderSize + records.size());
+    out.append(compiledQueryMagic, sizeof(compiledQueryMagic));
+    appendLittleEndian(out, compiledQueryVersion, 2);
+    appendLittleEndian(out, 0, 2); // Flags
+    appendLittleEndian(out, count, 4);
+    out += records;
+    records.clear();
+    count = 0;
+    return out;
+}
+
+CompiledQueryReader::CompiledQueryReader(std::string_view data) : data(data) {
+    if (data.size() < compiledQueryHeaderSize || std::memcmp(data.data(), compiledQueryMagic, sizeof(compiledQueryMagic)) != 0) {
+        throw ParseError("Not a compiled query file");
+    }
+    uint16_t version = static_cast<uint16_t>(readLittleEndian(data.data() + 4, 2));
+    if (version != compiledQueryVersion) {
+        throw ParseError("Unsupported compiled query version " + std::to_string(version));
+    }
+    if (readLittleEndian(data.data() + 6, 2) != 0) {
+        throw ParseError("Unknown compiled query flags");
+    }
+    count = static_cast<uint32_t>(readLittleEndian(data.data() + 8, 4));
+}
+
+uint64_t CompiledQueryReader::readVarint() {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (offset >= data.size()) {
+            throw ParseError("Truncated compiled query record " + std::to_string(consumed + 1));
+        }
+        uint8_t byte = static_cast<uint8_t>(data[offset++]);
+        value |= uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw ParseError("Overlong varint in compiled query record " + std::to_string(consumed + 1));
+}
+
+std::string_view CompiledQueryReader::readBytes(size_t length) {
+    if (length > data.size() - offset) {
+        throw ParseError("Truncated compiled query record " + std::to_string(consumed + 1));
+    }
+    std::string_view bytes = data.substr(offset, length);
+    offset += length;
+    return bytes;
+}
+
+bool CompiledQueryReader::next(QueryView& query) {
+    if (consumed == count) {
+        if (offset != data.size()) {
+            throw ParseError("Trailing bytes after the last compiled query record");
+        }
+        return false;
+    }
+
+    uint8_t tag = static_cast<uint8_t>(readBytes(1)[0]);
+    uint8_t type = tag & 0x3;
+    uint8_t priority = (tag >> 2) & 0x3;
+    if (type > static_cast<uint8_t>(Query::Type::DELETE) || priority > static_cast<uint8_t>(Query::Priority::BULK) || (tag >> 5) != 0) {
+        throw ParseError("Invalid tag in compiled query record " + std::to_string(consumed + 1));
+    }
+    query.type = static_cast<Query::Type>(type);
+    query.priority = static_cast<Query::Priority>(priority);
+
+    uint32_t zigzag = static_cast<uint32_t>(readVarint());
+    query.id = static_cast<int>((zigzag >> 1) ^ (0u - (zigzag & 1)));
+    query.key = readBytes(readVarint());
+    query.value.reset();
+    if (tag & (1 << 4)) {
+        query.value = readBytes(readVarint());
+    }
+    query.rawCommand = {};
+    ++consumed;
+    return true;
+}
@@ -0,0 +1,40 @@
+#include "read_balancer.hpp"
+#include <algorithm>
+
+ReadTarget ReadBalancer::choose() {
+    Target& primary = targets[static_cast<size_t>(ReadTarget::PRIMARY)];
+    Target& backup = targets[static_cast<size_t>(ReadTarget::BACKUP)];
+    int64_t primaryLatency = primary.averageUs.load(std::memory_order_relaxed);
+    int64_t backupLatency = backup.averageUs.load(std::memory_order_relaxed);
+    // Until both have answered, outstanding requests alone decide
+    if (primaryLatency == 0 || backupLatency == 0) {
+        primaryLatency = backupLatency = 1;
+    }
+    int64_t primaryCost = (primary.outstanding.load(std::memory_order_relaxed) + 1) * primaryLatency;
+    int64_t backupCost = (backup.outstanding.load(std::memory_order_relaxed) + 1) * backupLatency;
+    ReadTarget chosen = backupCost < primaryCost ? ReadTarget::BACKUP : ReadTarget::PRIMARY;
+
+    targets[static_cast<size_t>(chosen)].outstanding.fetch_add(1, std::memory_order_relaxed);
+    Target& passed = chosen == ReadTarget::PRIMARY ? backup : primary;
+    if (int64_t average = passed.averageUs.load(std::memory_order_relaxed); average > 1) {
+        passed.averageUs.store(average - std::max<int64_t>(1, average / 64), std::memory_order_relaxed);
+    }
+    return chosen;
+}
+
+void ReadBalancer::finish(ReadTarget target, std::chrono::microseconds latency) {
+    Target& finished = targets[static_cast<size_t>(target)];
+    finished.outstanding.fetch_sub(1, std::memory_order_relaxed);
+    finished.reads.fetch_add(1, std::memory_order_relaxed);
+    // Concurrent finishes may overwrite each other's update, which only slows the average down
+    int64_t sample = std::max<int64_t>(1, latency.count());
+    int64_t average = finished.averageUs.load(std::memory_order_relaxed);
+    finished.averageUs.store(average == 0 ? sample : average + (sample - average) / 8, std::memory_order_relaxed);
+}
+
+ReadBalancerStats ReadBalancer::getStats() const {
+    ReadBalancerStats stats;
+    stats.primaryReads = targets[static_cast<size_t>(ReadTarget::PRIMARY)].reads.load(std::memory_order_relaxed);
+    stats.backupReads = targets[static_cast<size_t>(ReadTarget::BACKUP)].reads.load(std::memory_order_relaxed);
+    return stats;
+}
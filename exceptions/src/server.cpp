@@ -1,11 +1,20 @@
 #include "server.hpp"
 #include "query.hpp"
+#include "key_interner.hpp"
 
-QueryResult Server::processCommand(const Query& query, int depth) {
+static constexpr int deadlineCheckLevels = 16;
+
+QueryResult Server::processCommand(const Query& query, int depth, const QueryDeadline& deadline) {
     QueryResult result;
 
     try {
-		result = processWork(query, depth);
+		result = processWork(query, depth, deadline);
+    }
+    catch (const TimeoutError& te) {
+        result.queryId = query.id;
+        result.success = false;
+        result.timedOut = true;
+        result.errorMessage = te.what();
     }
     catch (const QueryError& qe) {
         result.success = false;
@@ -19,15 +28,21 @@ QueryResult Server::processCommand(const Query& query, int depth) {
     return result;
 }
 
-QueryResult Server::processWork(const Query& query, int depth)
+QueryResult Server::processWork(const Query& query, int depth, const QueryDeadline& deadline)
 {
+    if (depth % deadlineCheckLevels == 0 && deadline.expired()) {
+        throw TimeoutError("Deadline exceeded while processing query ID " + std::to_string(query.id));
+    }
     if (depth > 0) {
-        auto tmp = processCommand(query, depth - 1);
+        auto tmp = processCommand(query, depth - 1, deadline);
         static volatile int sink = 0;
-        sink += 1;
+        sink = sink + 1;
         return tmp;
     }
     std::lock_guard<std::mutex> lock(storeMutex);
+    if (keyIndexing == KeyIndexing::INTERNED) {
+        return applyInterned(query);
+    }
 
     QueryResult result;
     result.queryId = query.id;
@@ -37,6 +52,7 @@ QueryResult Server::processWork(const Query& query, int depth)
         if (auto it = keyValueStore.find(query.key); it != keyValueStore.end()) {
             result.success = true;
             result.data = "GET successful. Value: '" + it->second + "'";
+            result.keyVersion = keyVersions[query.key];
         }
         else {
             throw QueryError("Key not found for GET: '" + query.key + "'");
@@ -45,12 +61,14 @@ QueryResult Server::processWork(const Query& query, int depth)
     }
     case Query::Type::SET: {
         keyValueStore[query.key] = query.value.value_or("");
+        result.keyVersion = keyVersions[query.key] = ++lastVersion;
         result.success = true;
         result.data = "SET successful for key '" + query.key + "'";
         break;
     }
     case Query::Type::DELETE: {
         if (keyValueStore.erase(query.key) > 0) {
+            result.keyVersion = keyVersions[query.key] = ++lastVersion;
             result.success = true;
             result.data = "DELETE successful for key '" + query.key + "'";
         }
@@ -64,3 +82,63 @@ QueryResult Server::processWork(const Query& query, int depth)
 	return result;
 }
 
+QueryResult Server::applyInterned(const Query& query) {
+    // Parsers leave the id unset, so that only a process with an INTERNED store pays for the table
+    uint32_t keyId = query.keyId != KeyInterner::noId ? query.keyId : KeyInterner::shared().intern(query.key);
+    Entry* entry = keyId < entriesById.size() ? &entriesById[keyId] : nullptr;
+
+    QueryResult result;
+    result.queryId = query.id;
+
+    switch (query.type) {
+    case Query::Type::GET: {
+        if (entry && entry->present) {
+            result.success = true;
+            result.data = "GET successful. Value: '" + entry->value + "'";
+            result.keyVersion = entry->version;
+        }
+        else {
+            throw QueryError("Key not found for GET: '" + query.key + "'");
+        }
+        break;
+    }
+    case Query::Type::SET: {
+        if (!entry) {
+            entriesById.resize(static_cast<size_t>(keyId) + 1);
+            entry = &entriesById[keyId];
+        }
+        entry->value = query.value.value_or("");
+        entry->present = true;
+        result.keyVersion = entry->version = ++lastVersion;
+        result.success = true;
+        result.data = "SET successful for key '" + query.key + "'";
+        break;
+    }
+    case Query::Type::DELETE: {
+        if (entry && entry->present) {
+            entry->value.clear();
+            entry->value.shrink_to_fit();
+            entry->present = false;
+            result.keyVersion = entry->version = ++lastVersion;
+            result.success = true;
+            result.data = "DELETE successful for key '" + query.key + "'";
+        }
+        else {
+            throw QueryError("Key not found for DELETE: '" + query.key + "'");
+        }
+        break;
+    }
+    }
+
+    return result;
+}
+
+uint64_t Server::getKeyVersion(const std::string& key) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (keyIndexing == KeyIndexing::INTERNED) {
+        uint32_t keyId = KeyInterner::shared().find(key);
+        return keyId < entriesById.size() ? entriesById[keyId].version : 0;
+    }
+    auto it = keyVersions.find(key);
+    return it != keyVersions.end() ? it->second : 0;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "time_source.hpp"
+#include <thread>
+
+namespace {
+
+class RealTime : public TimeSource {
+public:
+    Clock::time_point now() const override { return Clock::now(); }
+    void sleepUntil(Clock::time_point wakeAt) override { std::this_thread::sleep_until(wakeAt); }
+};
+
+} // namespace
+
+TimeSource& TimeSource::real() {
+    static RealTime realTime;
+    return realTime;
+}
+
+void VirtualTime::sleepUntil(Clock::time_point wakeAt) {
+    sleeps.fetch_add(1, std::memory_order_relaxed);
+    Clock::time_point observed = current.load(std::memory_order_relaxed);
+    // Never backwards: a wake-up time already passed is no sleep at all
+    while (observed < wakeAt && !current.compare_exchange_weak(observed, wakeAt, std::memory_order_relaxed)) {
+    }
+}
+
+int64_t RandomSource::uniform(int64_t low, int64_t high) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::uniform_int_distribution<int64_t>(low, high)(engine);
+}
+
+uint64_t RandomSource::freshSeed() {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) | device();
+}
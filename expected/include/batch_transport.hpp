@@ -0,0 +1,75 @@
+#ifndef BATCH_TRANSPORT_HPP
+#define BATCH_TRANSPORT_HPP
+
+#include "deadline.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class IoBackend {
+    EPOLL,
+    IO_URING,
+};
+
+// IO_URING if the kernel accepts a ring with provided buffer rings and multishot receive, else EPOLL; probed once.
+IoBackend detectIoBackend();
+const char* ioBackendName(IoBackend backend);
+
+// One connected socket's share of a batch: requests pipelined back to back and the responses they are
+// answered with, in order.
+struct BatchChannel {
+    int fd = -1;
+    bool framed = false;           // Binary wire frames (kv_wire.hpp) rather than lines
+    std::string requests;          // Concatenated '\n'-terminated request lines, or request frames
+    size_t expectedResponses = 0;
+    std::string received;          // Bytes already read past the last response; left holding any extra
+    std::vector<std::string> responses; // Response lines without their '\n', or whole response frames
+    std::string error;             // Set if the socket failed; the connection must not be reused
+    bool timedOut = false;         // The deadline passed with responses outstanding
+
+    bool complete() const { return responses.size() == expectedResponses; }
+};
+
+struct BatchTransportStats {
+    uint64_t batches = 0;
+    uint64_t requests = 0;
+    uint64_t syscalls = 0; // Every system call made on behalf of a batch, ring submissions included
+};
+
+// Sends the pipelined requests of many sockets at once and gathers their responses. The io_uring backend
+// queues one send per socket from a registered buffer and one multishot receive into a ring of provided
+// buffers, so a whole batch costs a few io_uring_enter calls whatever its size. The epoll backend sends,
+// waits and reads with plain system calls, and is used wherever io_uring is unavailable.
+// Not thread-safe: one batch at a time.
+class BatchTransport {
+public:
+    // Falls back to EPOLL if an io_uring ring cannot be set up.
+    explicit BatchTransport(IoBackend backend = detectIoBackend());
+    ~BatchTransport();
+
+    BatchTransport(const BatchTransport&) = delete;
+    BatchTransport& operator=(const BatchTransport&) = delete;
+
+    IoBackend backend() const { return selected; }
+
+    // Runs until every channel is complete or failed, or the deadline passes. Socket failures are reported
+    // per channel, never thrown, so the other channels of the batch still complete.
+    void exchange(std::vector<BatchChannel>& channels, const QueryDeadline& deadline);
+
+    BatchTransportStats getStats() const { return stats; }
+
+private:
+    struct Ring;
+
+    void exchangeEpoll(std::vector<BatchChannel>& channels, const QueryDeadline& deadline);
+    void exchangeUring(std::vector<BatchChannel>& channels, const QueryDeadline& deadline);
+
+    IoBackend selected;
+    std::unique_ptr<Ring> ring;
+    int epollFd = -1;
+    BatchTransportStats stats;
+};
+
+#endif // BATCH_TRANSPORT_HPP
@@ -0,0 +1,80 @@
+#ifndef CLIENT_CACHE_HPP
+#define CLIENT_CACHE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+struct ClientCacheStats {
+    uint64_t hits = 0;        // GETs answered from the cache
+    uint64_t misses = 0;      // GETs that had to go to the server, including stale hits
+    uint64_t validations = 0; // Hits whose version was checked against the server
+    uint64_t staleHits = 0;   // Validated hits whose cached version was out of date
+    uint64_t evictions = 0;
+};
+
+// Bounded, sharded read-through cache for GET results.
+// Each shard has its own reader/writer lock, so concurrent hits on different shards never contend and
+// hits on the same shard only take a shared lock. Every entry carries the server-side version stamp it
+// was read at; writes leave a versioned tombstone so a slower, older fill cannot resurrect a stale value.
+class ClientCache {
+public:
+    // Returns the server's current version for a key, used to detect stale entries.
+    using VersionProbe = std::function<uint64_t(const std::string&)>;
+
+    // validationPercent of hits (0-100) are checked against versionProbe before being served.
+    ClientCache(size_t capacity, int validationPercent, VersionProbe probe);
+
+    ClientCache(const ClientCache&) = delete;
+    ClientCache& operator=(const ClientCache&) = delete;
+
+    std::optional<std::string> lookup(const std::string& key);
+
+    // Stores a value read from the server at the given version unless a newer version is already known.
+    void fill(const std::string& key, const std::string& value, uint64_t version);
+
+    // Drops the cached value after a write that produced the given version.
+    void invalidate(const std::string& key, uint64_t version);
+
+    ClientCacheStats getStats() const;
+
+private:
+    static constexpr size_t shardCount = 16;
+
+    struct Entry {
+        std::optional<std::string> value; // Empty for tombstones left by writes
+        uint64_t version = 0;
+        std::atomic<bool> referenced{ true };
+    };
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    Shard& shardFor(const std::string& key);
+    // Caller must hold the shard's exclusive lock.
+    Entry& upsert(Shard& shard, const std::string& key);
+    void evictOne(Shard& shard);
+    void dropIfVersion(const std::string& key, uint64_t version);
+
+    size_t shardCapacity;
+    int validationPercent;
+    VersionProbe versionProbe;
+    std::array<Shard, shardCount> shards;
+
+    std::atomic<uint64_t> lookupSequence{ 0 };
+    std::atomic<uint64_t> hits{ 0 };
+    std::atomic<uint64_t> misses{ 0 };
+    std::atomic<uint64_t> validations{ 0 };
+    std::atomic<uint64_t> staleHits{ 0 };
+    std::atomic<uint64_t> evictions{ 0 };
+};
+
+#endif // CLIENT_CACHE_HPP
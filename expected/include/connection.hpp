@@ -5,32 +5,104 @@
 #include "config.hpp" 
 #include "error.hpp" 
 #include "server.hpp"
+#include "client_cache.hpp"
+#include "connection_pool.hpp"
+#include "batch_transport.hpp"
+#include "shm_channel.hpp"
+#include "circuit_breaker.hpp"
+#include "hedging.hpp"
+#include "read_balancer.hpp"
+#include "time_source.hpp"
 #include <string>
+#include <string_view>
+#include <atomic>
+#include <chrono>
 #include <memory>        
 #include <expected>  
+#include <mutex>
+#include <condition_variable>
+#include <stop_token>
+#include <thread>
+#include <optional>
+#include <span>
+#include <vector>
 
 
 class NetworkResource {
 public:
     NetworkResource(const std::string& serverAddress) : address(serverAddress), handle(next_available_handle++) {}
+    // Takes ownership of a connected TCP socket.
+    NetworkResource(const std::string& serverAddress, int socketFd) : address(serverAddress), handle(next_available_handle++), socketFd(socketFd) {}
 
-    ~NetworkResource() {
-        handle = -1;
-    }
+    ~NetworkResource();
 
     NetworkResource(const NetworkResource&) = delete;
     NetworkResource& operator=(const NetworkResource&) = delete;
     NetworkResource(NetworkResource&& other) noexcept;
     NetworkResource& operator=(NetworkResource&& other) noexcept;
 
-    bool isValid() const { return handle != -1; }
+    // For a socket, also false once the peer has closed it or sent data nobody asked for.
+    bool isValid() const;
     std::string getAddress() const { return address; }
     int getHandle() const { return handle; }
+    bool isSocket() const { return socketFd >= 0; }
+
+    // Sends one request line and returns the response line without its newline; after useBinaryProtocol,
+    // sends one request frame and returns the whole response frame.
+    // Returns ConnectionErrorDuringQuery if the socket fails and QueryTimeout if the deadline passes first; either
+    // way the connection is closed, since a late response would otherwise answer the next request.
+    std::expected<std::string, ErrorInfo> exchange(std::string_view request, const QueryDeadline& deadline);
+
+    // The two halves of exchange, for a caller that waits on several sockets itself: sendRequest writes the
+    // whole request, and pollResponse reads what has arrived without blocking and returns the response once it is
+    // complete. They fail like exchange and do not work over shared memory.
+    std::expected<void, ErrorInfo> sendRequest(std::string_view request, const QueryDeadline& deadline);
+    std::expected<std::optional<std::string>, ErrorInfo> pollResponse();
+
+    // Gives up on the response to the last request sent: it is read and dropped before the next response, so
+    // the connection can be reused. drainAbandoned reads them right away, for a caller that takes over the socket.
+    void abandonResponse() { ++abandoned; }
+    std::expected<void, ErrorInfo> drainAbandoned(const QueryDeadline& deadline);
+
+    // Moves the exchanges of this connection into a shared-memory region it names to the server over the
+    // socket; the socket then only tells either side when the other has gone. Returns ConnectionFailed if the
+    // region cannot be set up or the server refuses it.
+    std::expected<void, ErrorInfo> useSharedMemory(const QueryDeadline& deadline);
+    bool isSharedMemory() const { return sharedMemory != nullptr; }
+
+    // Switches the connection to the binary framing of kv_wire.hpp. Returns ConnectionFailed if the server refuses it.
+    std::expected<void, ErrorInfo> useBinaryProtocol(const QueryDeadline& deadline);
+    bool isBinary() const { return binary; }
+
+    // The socket and the bytes received past its last response, for BatchTransport; -1 for a simulated connection.
+    int nativeSocket() const { return socketFd; }
+    std::string& receiveBuffer() { return pending; }
+
+    // send, poll and recv calls made by exchange, over every connection
+    static uint64_t exchangeSyscalls() { return syscallCount.load(std::memory_order_relaxed); }
 
 private:
+    void closeSocket();
+    // Closes the connection and returns the error for what failed, with errno
+    std::unexpected<ErrorInfo> fail(const std::string& what);
+    std::expected<void, ErrorInfo> waitFor(short events, const QueryDeadline& deadline);
+    // Size of the complete response at the front of pending, its newline included; 0 until it has all arrived
+    std::expected<size_t, ErrorInfo> responseSize() const;
+    // One recv into pending; false if nothing was there
+    std::expected<bool, ErrorInfo> receiveMore();
+    // Removes the next complete response from pending, after any abandoned ones; empty until it has all arrived
+    std::expected<std::optional<std::string>, ErrorInfo> takeResponse();
+    std::expected<std::string, ErrorInfo> exchangeShared(std::string_view request, const QueryDeadline& deadline);
+
     std::string address;
     int handle;
-    static int next_available_handle;
+    int socketFd = -1;
+    std::string pending; // Bytes received after the last response
+    int abandoned = 0;   // Responses still to come for requests given up on
+    bool binary = false;
+    std::unique_ptr<ShmRegion> sharedMemory;
+    static std::atomic<int> next_available_handle; // Pools open connections concurrently
+    static std::atomic<uint64_t> syscallCount;
 };
 
 
@@ -42,19 +114,72 @@ enum class ConnectionMode {
 
 class ConnectionManager {
 public:
-    explicit ConnectionManager(const AppConfig& appConfig, Server& svr) : config(appConfig), server(svr), currentMode(ConnectionMode::DISCONNECTED) {}
+    // Connect delays, retry backoffs and breaker cooldowns run on time, and their jitter and the simulated
+    // connect delays are drawn from seed. On a VirtualTime a single thread can replay hours of reconnects in
+    // moments, the same way for the same seed; queries still run on the steady clock.
+    explicit ConnectionManager(const AppConfig& appConfig, Server& svr, TimeSource& time = TimeSource::real(), uint64_t seed = RandomSource::freshSeed());
 
     // Attempts to establish a connection. Returns void on success, ErrorInfo if it ends in OFFLINE_CACHE or DISCONNECTED after all attempts.
     // Note: The internal state (currentMode) reflects the outcome. This function's error primarily signals failure to get *any* server.
+    // While the primary's circuit breaker is open, goes straight to the backup. Once connected to the backup,
+    // each call makes a single attempt on the primary whenever the breaker allows one, and moves the pool back
+    // to the primary if it succeeds. Like the initial connect, that replaces the pool, so no query may be in flight.
+    // With connect_race_delay_ms, the primary is tried on a background thread instead, and the backup is tried
+    // as well once that delay has passed or the primary has failed once; the first to connect is kept. If the
+    // backup wins, the thread keeps trying the primary, and the next call switches over once it has connected.
+    // The race needs the thread to wait alongside the caller, so on a TimeSource other than the real one the
+    // primary's retry ladder runs first instead.
     std::expected<void, ErrorInfo> establishConnection();
 
+    // Releases every connection; the next establishConnection starts over.
+    void disconnect();
+
     bool isConnected() const;
     ConnectionMode getCurrentMode() const;
     std::string getCurrentServerAddress() const;
 
-    QueryResult executeRemoteQuery(const Query& query, int depth);
+    QueryResult executeRemoteQuery(const Query& query, int depth, const QueryDeadline& deadline = QueryDeadline{});
+
+    // Pipelines a whole batch over the pooled TCP connections in one BatchTransport exchange: the queries are
+    // dealt round-robin across as many connections as the pool can spare at once, and deadlines[i] bounds
+    // queries[i]. Batches from different threads take turns. Over the simulated transport, or with the client
+    // cache enabled, each query goes through executeRemoteQuery instead.
+    std::vector<QueryResult> executeRemoteBatch(const std::vector<Query>& queries, int depth, const std::vector<QueryDeadline>& deadlines);
+
+    // Backend of the batch transport, detected by default; takes effect from the next batch.
+    void setIoBackend(IoBackend backend);
+    BatchTransportStats getBatchTransportStats() const;
+
+    // Checkout statistics of the connection pool (all zero while disconnected).
+    ConnectionPoolStats getConnectionPoolStats() const;
+
+    // Statistics of the optional client-side GET cache (all zero when client_cache_capacity is 0).
+    ClientCacheStats getClientCacheStats() const;
+
+    // Circuit breaker over the connection attempts on the primary (breaker_* settings).
+    BreakerState getPrimaryBreakerState() const { return primaryBreaker.state(); }
+    CircuitBreakerStats getPrimaryBreakerStats() const { return primaryBreaker.getStats(); }
+
+    // Hedging of GETs (hedge_* settings): while connected to the primary, a GET that has not been answered
+    // within hedge_percentile of the primary's recent latencies is also sent to the backup, as far as the
+    // budget allows. The first response is returned and the other request abandoned. Loaded configs only
+    // enable it with transport = simulated, where both servers share the data.
+    // Covers queries sent one at a time, not the pipelined batches of executeRemoteBatch.
+    HedgeStats getHedgeStats() const;
+
+    // Reads served by each server under read_balancing = least_outstanding: while connected to the primary, each
+    // GET goes to the primary or the backup; writes, and everything while on the backup, go to the current server.
+    // The backup must hold the same data, so loaded configs only enable it with transport = simulated. Like
+    // hedging, this covers queries sent one at a time.
+    ReadBalancerStats getReadBalancerStats() const { return readBalancer.getStats(); }
 
     static void setSimulatedFailureMode(const std::string& serverType, int failureCount = 0, bool transient = false);
+    // Simulated latency of each request to a server over the simulated transport: typical, give or take half, or
+    // slow for slowPercent of requests. Zero, the default, answers at once.
+    static void setSimulatedLatency(const std::string& serverType, std::chrono::microseconds typical, int slowPercent = 0, std::chrono::microseconds slow = {});
+    // Requests a server over the simulated transport works on at once; more queue up behind them. Zero, the
+    // default, is unlimited.
+    static void setSimulatedCapacity(const std::string& serverType, int concurrentRequests);
 
 private:
     // Attempts to connect to a specific server.
@@ -62,17 +187,95 @@ private:
     std::expected<std::unique_ptr<NetworkResource>, ErrorInfo> connectToServer(
         const std::string& address, int port, int attemptNumber, int totalRetries);
 
+    // From the backup, tries the primary once if its breaker allows and switches the pool over on success.
+    void probePrimary();
+
+    // The racing connect of connect_race_delay_ms: starts primaryRacer and waits until a server has connected,
+    // or both have failed for good.
+    std::expected<void, ErrorInfo> establishRacing();
+    // Runs on primaryRacer: tries the primary, backing off like the retry ladder, until it connects or stop is
+    // requested, and leaves the connection in raceState.
+    void racePrimary(std::stop_token stop);
+    // Switches to the connection primaryRacer made, if there is one yet.
+    bool adoptRacedPrimary();
+
+    // Replaces the pool with one around first, an open connection to address:port; further connections
+    // are opened on demand with the retry budget that first succeeded within.
+    void openPool(std::unique_ptr<NetworkResource> first, const std::string& address, int port, int totalRetries);
+    std::unique_ptr<ConnectionPool<NetworkResource>> makePool(std::unique_ptr<NetworkResource> first, const std::string& address, int port, int totalRetries);
+    // Opens backupPool once connected to the primary, if hedging or read balancing is on.
+    void openBackupPool();
+
+    // Sends a query over a pooled connection, waiting for one until the deadline.
+    QueryResult sendToServer(const Query& query, int depth, const QueryDeadline& deadline);
+
+    // A request sent over a pooled connection whose response has not been read yet
+    struct HedgeLeg;
+    // Sends a GET to the primary and, if it is slow to answer, to the backup as well.
+    QueryResult sendHedged(const Query& query, int depth, const QueryDeadline& deadline);
+    // Leases a connection from pool and sends query over it; returns the result instead if that fails.
+    std::optional<QueryResult> startLeg(HedgeLeg& leg, ConnectionPool<NetworkResource>& pool, bool wait, const Query& query, int depth, const QueryDeadline& deadline);
+    // Waits until a leg has its response, every leg has failed, or until passes; returns that leg, or nullptr.
+    HedgeLeg* awaitLegs(std::span<HedgeLeg> legs, QueryDeadline::Clock::time_point until, const Query& query, const QueryDeadline& deadline);
+
     AppConfig config;
     ConnectionMode currentMode;
-    std::unique_ptr<NetworkResource> activeConnection;
+    std::unique_ptr<ConnectionPool<NetworkResource>> connectionPool;
     Server& server;
+    TimeSource& timeSource;
+    RandomSource random;
+    CircuitBreaker primaryBreaker;
+
+    std::unique_ptr<ConnectionPool<NetworkResource>> backupPool; // For hedged and balanced GETs, while connected to the primary
+    ReadBalancer readBalancer;
+    LatencyTracker primaryLatency;
+    HedgeBudget hedgeBudget;
+    struct {
+        std::atomic<uint64_t> eligible{ 0 };
+        std::atomic<uint64_t> hedged{ 0 };
+        std::atomic<uint64_t> hedgeWins{ 0 };
+        std::atomic<uint64_t> budgetDenied{ 0 };
+    } hedgeCounters;
+
+    mutable std::mutex batchMutex; // Guards batchTransport and ioBackend
+    std::unique_ptr<BatchTransport> batchTransport; // Created by the first batch
+    IoBackend ioBackend = detectIoBackend();
+
+    struct {
+        std::mutex mutex;
+        std::condition_variable_any changed;
+        std::unique_ptr<NetworkResource> connection; // The primary's, once primaryRacer has connected
+        int failures = 0;                            // Attempts primaryRacer has failed
+        bool permanent = false;                      // The last of them failed permanently
+        ErrorInfo lastError;
+    } raceState;
+
+    // Serves GETs from clientCache when possible; writes invalidate the key with the server's new version.
+    QueryResult executeThroughCache(const Query& query, int depth, const QueryDeadline& deadline);
+    std::unique_ptr<ClientCache> clientCache;
 
     struct FailureSimConfig {
-        int failureCount = 0;
-        bool isTransient = false;
+        // Set by setSimulatedFailureMode while the primary racer thread may be reading them
+        std::atomic<int> failureCount{ 0 };
+        std::atomic<bool> isTransient{ false };
+        std::chrono::microseconds typicalLatency{ 0 };
+        int slowPercent = 0;
+        std::chrono::microseconds slowLatency{ 0 };
+        int capacity = 0;
+        std::mutex queueMutex; // Guards busyUntil
+        std::vector<QueryDeadline::Clock::time_point> busyUntil; // When each of the capacity slots is free again
     };
+    // One request's latency to the server sim describes
+    std::chrono::microseconds sampleLatency(const FailureSimConfig& sim);
+    // When the server sim describes answers a request sent now, after the requests queued ahead of it
+    QueryDeadline::Clock::time_point scheduleResponse(FailureSimConfig& sim);
     static FailureSimConfig primarySim;
     static FailureSimConfig backupSim;
+
+    // Sends a query over a connection from pool, waiting for one until the deadline; sim times a simulated connection.
+    QueryResult sendOver(ConnectionPool<NetworkResource>& pool, FailureSimConfig& sim, const Query& query, int depth, const QueryDeadline& deadline);
+
+    std::jthread primaryRacer; // Last, so it is stopped and joined before the members it uses are destroyed
 };
 
 #endif // CONNECTION_HPP
\ No newline at end of file
@@ -0,0 +1,100 @@
+#ifndef DELIMITER_SCAN_HPP
+#define DELIMITER_SCAN_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+enum class ScanBackend {
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+// Widest backend the running CPU supports, detected once via CPUID.
+ScanBackend detectScanBackend();
+const char* scanBackendName(ScanBackend backend);
+
+// Structural bitmaps for one 64-byte block; bit i describes byte i.
+struct DelimiterMasks {
+    uint64_t newline = 0;
+    uint64_t field = 0; // ',', '=', ' ' and the other whitespace characters except '\n'
+};
+
+// Offsets of the field delimiters of one line, relative to the line start.
+struct LineDelimiters {
+    static constexpr size_t maxCount = 6;
+    uint32_t positions[maxCount];
+    size_t count = 0;
+    bool overflow = false; // More than maxCount delimiters; positions holds the first maxCount
+};
+
+// Splits text into lines and locates the field delimiters of each line 64 bytes at a time,
+// in the style of simdjson's structural index.
+class DelimiterScanner {
+public:
+    explicit DelimiterScanner(ScanBackend backend = detectScanBackend());
+
+    ScanBackend backend() const { return selected; }
+
+    // Calls onLine(line, delimiters) for every line of text, without its '\n'.
+    // A final line without a trailing newline is reported as well, but an empty one is not.
+    template<typename OnLine>
+    void forEachLine(std::string_view text, OnLine&& onLine) const;
+
+private:
+    ScanBackend selected;
+    DelimiterMasks (*classifyBlock)(const char* block);
+};
+
+template<typename OnLine>
+void DelimiterScanner::forEachLine(std::string_view text, OnLine&& onLine) const {
+    const char* base = text.data();
+    size_t lineStart = 0;
+    LineDelimiters delimiters;
+
+    for (size_t blockStart = 0; blockStart < text.size(); blockStart += 64) {
+        DelimiterMasks masks;
+        size_t blockLength = text.size() - blockStart;
+        if (blockLength >= 64) {
+            masks = classifyBlock(base + blockStart);
+        }
+        else {
+            // Pad the tail so the classifier never reads past the end of the text
+            char tail[64];
+            std::memset(tail, 'x', sizeof(tail));
+            std::memcpy(tail, base + blockStart, blockLength);
+            masks = classifyBlock(tail);
+            uint64_t valid = (uint64_t(1) << blockLength) - 1;
+            masks.newline &= valid;
+            masks.field &= valid;
+        }
+
+        uint64_t structural = masks.newline | masks.field;
+        while (structural != 0) {
+            unsigned bit = static_cast<unsigned>(std::countr_zero(structural));
+            structural &= structural - 1;
+            size_t position = blockStart + bit;
+            if (masks.newline & (uint64_t(1) << bit)) {
+                onLine(std::string_view(base + lineStart, position - lineStart), static_cast<const LineDelimiters&>(delimiters));
+                lineStart = position + 1;
+                delimiters.count = 0;
+                delimiters.overflow = false;
+            }
+            else if (delimiters.count < LineDelimiters::maxCount) {
+                delimiters.positions[delimiters.count++] = static_cast<uint32_t>(position - lineStart);
+            }
+            else {
+                delimiters.overflow = true;
+            }
+        }
+    }
+
+    if (lineStart < text.size()) {
+        onLine(std::string_view(base + lineStart, text.size() - lineStart), static_cast<const LineDelimiters&>(delimiters));
+    }
+}
+
+#endif // DELIMITER_SCAN_HPP
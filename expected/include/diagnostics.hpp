@@ -0,0 +1,82 @@
+#ifndef DIAGNOSTICS_HPP
+#define DIAGNOSTICS_HPP
+
+#include "error.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <thread>
+
+// UnknownError is the last code
+constexpr size_t errorCodeCount = static_cast<size_t>(ErrorCode::UnknownError) + 1;
+
+// Asynchronous sink for diagnostics from the parsers, the connection manager and the config loader.
+// report() never blocks and never does I/O: messages go into a lock-free bounded ring that a background
+// thread drains to the output stream. Each code may emit at most rateLimit messages per second; the rest,
+// and any that arrive while the ring is full, are only counted. The destructor drains the ring and
+// prints a per-code summary of what was written, suppressed and dropped.
+class DiagnosticsSink {
+public:
+    struct Counts {
+        uint64_t written = 0;
+        uint64_t suppressed = 0; // Over the per-code rate limit
+        uint64_t dropped = 0;    // Ring was full
+    };
+
+    // Process-wide sink writing to std::cerr.
+    static DiagnosticsSink& shared();
+
+    explicit DiagnosticsSink(std::ostream& out, size_t capacity = 4096, uint32_t rateLimit = 100);
+    ~DiagnosticsSink();
+
+    DiagnosticsSink(const DiagnosticsSink&) = delete;
+    DiagnosticsSink& operator=(const DiagnosticsSink&) = delete;
+
+    void report(ErrorCode code, std::string message);
+    // Blocks until every message reported so far has been written.
+    void flush();
+
+    // Messages per code per second; 0 disables the limit.
+    void setRateLimit(uint32_t messagesPerSecond) { rateLimit.store(messagesPerSecond, std::memory_order_relaxed); }
+    Counts counts(ErrorCode code) const;
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        ErrorCode code;
+        std::string message;
+    };
+
+    struct CodeState {
+        std::atomic<int64_t> windowStart{ 0 }; // Steady-clock nanoseconds
+        std::atomic<uint32_t> windowCount{ 0 };
+        std::atomic<uint64_t> written{ 0 };
+        std::atomic<uint64_t> suppressed{ 0 };
+        std::atomic<uint64_t> dropped{ 0 };
+    };
+
+    bool admit(CodeState& state);
+    bool tryPush(ErrorCode code, std::string& message);
+    size_t drain();
+    void writerLoop();
+    void printSummary();
+
+    std::ostream& out;
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<size_t> enqueuePos{ 0 };
+    alignas(64) size_t dequeuePos = 0; // Writer thread only
+    alignas(64) std::atomic<uint64_t> pushed{ 0 };    // Bumped after every push; the writer waits on it
+    std::atomic<uint64_t> processed{ 0 };            // Messages taken off the ring; flush() waits on it
+    std::atomic<uint32_t> rateLimit;
+    std::array<CodeState, errorCodeCount> codes;
+    std::atomic<bool> stopping{ false };
+    std::thread writer;
+};
+
+#endif // DIAGNOSTICS_HPP
@@ -28,6 +28,7 @@ enum class ErrorCode {
     SimulatedQueryFailure,
     ConnectionErrorDuringQuery,
     NoActiveConnectionForQuery,
+    QueryTimeout,
 
     // General/Unknown
     UnknownError
@@ -59,6 +60,7 @@ struct ErrorInfo {
         case ErrorCode::SimulatedQueryFailure: return "SimulatedQueryFailure";
         case ErrorCode::ConnectionErrorDuringQuery: return "ConnectionErrorDuringQuery";
         case ErrorCode::NoActiveConnectionForQuery: return "NoActiveConnectionForQuery";
+        case ErrorCode::QueryTimeout: return "QueryTimeout";
         case ErrorCode::UnknownError: return "UnknownError";
         default: return "UnknownErrorCode";
         }
@@ -0,0 +1,65 @@
+#ifndef GZIP_READER_HPP
+#define GZIP_READER_HPP
+
+#include "bounded_queue.hpp"
+#include "error.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Streams the decompressed contents of a gzip file. A background thread inflates into one of two buffers
+// while the caller reads the other, so decompression overlaps whatever the caller does with each block.
+// Concatenated gzip members are read as one stream.
+class GzipReader {
+public:
+    // True if the file starts with the gzip magic bytes.
+    static bool isGzipFile(const std::string& filePath);
+
+    // Opens the file and starts decompressing, or returns FileOpenFailed if it cannot be opened.
+    // The reader is heap-allocated because the decompression thread keeps a pointer to it.
+    static std::expected<std::unique_ptr<GzipReader>, ErrorInfo> open(const std::string& filePath, size_t blockSize = size_t(1) << 20);
+    ~GzipReader();
+
+    GzipReader(const GzipReader&) = delete;
+    GzipReader& operator=(const GzipReader&) = delete;
+
+    // Returns the next block of decompressed bytes, valid until the following call; empty at the end of the stream.
+    // Returns ParseError if the compressed data is corrupt or truncated.
+    std::expected<std::string_view, ErrorInfo> next();
+
+    // Totals so far; final once next() has returned an empty block.
+    uint64_t compressedBytes() const { return compressedTotal.load(std::memory_order_acquire); }
+    uint64_t decompressedBytes() const { return decompressedTotal.load(std::memory_order_acquire); }
+    // Time the background thread spent reading and inflating, excluding waits for a free buffer.
+    std::chrono::nanoseconds decompressBusy() const { return std::chrono::nanoseconds(busyNanos.load(std::memory_order_acquire)); }
+
+private:
+    struct Block {
+        std::vector<char> bytes;
+        size_t size = 0;
+    };
+
+    GzipReader(const std::string& filePath, size_t blockSize);
+    void inflateLoop();
+
+    std::ifstream file;
+    Block blocks[2];
+    BoundedQueue<Block*> freeBlocks{ 2 };
+    BoundedQueue<Block*> filledBlocks{ 2 };
+    Block* current = nullptr; // Held by the caller until the next call
+    std::string error;        // Set by the inflater before it closes filledBlocks
+    std::atomic<uint64_t> compressedTotal{ 0 };
+    std::atomic<uint64_t> decompressedTotal{ 0 };
+    std::atomic<int64_t> busyNanos{ 0 };
+    std::thread inflater;
+};
+
+#endif // GZIP_READER_HPP
@@ -0,0 +1,57 @@
+#ifndef HEDGING_HPP
+#define HEDGING_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+struct HedgeStats {
+    uint64_t eligible = 0;      // GETs that could have been hedged
+    uint64_t hedged = 0;        // Duplicates sent to the other server
+    uint64_t hedgeWins = 0;     // Duplicates that answered first
+    uint64_t budgetDenied = 0;  // Hedges skipped because the budget was spent
+};
+
+// Latencies of the last windowSize requests to one server, and a percentile of them that is refreshed every
+// refreshInterval records. Lock-free: concurrent records may overwrite each other's slots, which only blurs
+// the window a little.
+class LatencyTracker {
+public:
+    static constexpr size_t windowSize = 1024;
+    static constexpr size_t refreshInterval = 64;
+
+    explicit LatencyTracker(int percentile) : percentile(percentile) {}
+
+    void record(std::chrono::microseconds latency);
+    // Empty until a full refreshInterval has been recorded.
+    std::optional<std::chrono::microseconds> percentileLatency() const;
+
+private:
+    void refresh(size_t recorded);
+
+    const int percentile;
+    std::array<std::atomic<uint32_t>, windowSize> samples{}; // Microseconds, saturated
+    std::atomic<uint64_t> recordCount{ 0 };
+    std::atomic<int64_t> cachedPercentile{ -1 };
+};
+
+// Token bucket that caps hedges at budgetPercent of eligible requests: each request deposits budgetPercent
+// hundredths of a hedge, up to maxBurst hedges, and each hedge withdraws a whole one.
+class HedgeBudget {
+public:
+    static constexpr int64_t maxBurst = 10;
+
+    explicit HedgeBudget(int budgetPercent) : budgetPercent(budgetPercent) {}
+
+    void deposit();
+    bool tryWithdraw();
+
+private:
+    const int budgetPercent;
+    std::atomic<int64_t> hundredths{ 0 };
+};
+
+#endif // HEDGING_HPP
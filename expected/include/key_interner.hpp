@@ -0,0 +1,58 @@
+#ifndef KEY_INTERNER_HPP
+#define KEY_INTERNER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Concurrent symbol table that maps keys to dense 32-bit ids, assigned in first-seen order from 0.
+// Ids are never reused, and the name of an id stays valid and unmoved for the lifetime of the table,
+// so name() needs no lock. Lookups take a shared lock on one of several shards.
+class KeyInterner {
+public:
+    static constexpr uint32_t noId = UINT32_MAX;
+
+    // Process-wide table of the ids INTERNED Servers index by.
+    static KeyInterner& shared();
+
+    KeyInterner();
+    ~KeyInterner();
+
+    KeyInterner(const KeyInterner&) = delete;
+    KeyInterner& operator=(const KeyInterner&) = delete;
+
+    // Returns the id of key, assigning the next free one if key is new.
+    uint32_t intern(std::string_view key);
+    // Returns the id of key, or noId if it has not been interned.
+    uint32_t find(std::string_view key) const;
+    // id must have been returned by intern().
+    std::string_view name(uint32_t id) const;
+    size_t size() const { return nextId.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t shardCount = 16;
+    static constexpr unsigned chunkBits = 16; // Names are stored in chunks of 65536 that never move
+    static constexpr size_t chunkSize = size_t(1) << chunkBits;
+    static constexpr size_t maxChunks = size_t(1) << (32 - chunkBits);
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string_view, uint32_t> ids; // Views point into the name chunks
+    };
+
+    std::string* slotFor(uint32_t id);
+
+    std::array<Shard, shardCount> shards;
+    std::unique_ptr<std::atomic<std::string*>[]> chunks;
+    std::mutex chunkMutex;
+    std::atomic<uint32_t> nextId{ 0 };
+};
+
+#endif // KEY_INTERNER_HPP
@@ -0,0 +1,80 @@
+#ifndef KV_SERVER_HPP
+#define KV_SERVER_HPP
+
+#include "server.hpp"
+#include "error.hpp"
+#include "shm_channel.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+// Serves a Server to ConnectionManagers over loopback TCP, speaking the line protocol of kv_protocol.hpp.
+// One thread runs a non-blocking epoll loop over the listening socket and every client; requests are
+// executed as they are read, and clients may pipeline any number of them. A request deeper than
+// maxKvRequestDepth is answered with a ParseError instead of being executed.
+// A client on the same host may instead send "SHM <region name>" to move its requests into a shared-memory
+// region it created (see ShmRegion); a thread of its own then serves that region until the socket closes.
+// After the line "BINARY" a client speaks the length-prefixed framing of kv_wire.hpp instead of lines.
+class KvServer {
+public:
+    // Listens on 127.0.0.1:port; port 0 picks a free one. Returns ConnectionFailed if the socket cannot be set up.
+    static std::expected<std::unique_ptr<KvServer>, ErrorInfo> open(Server& server, uint16_t port);
+    ~KvServer();
+
+    KvServer(const KvServer&) = delete;
+    KvServer& operator=(const KvServer&) = delete;
+
+    uint16_t port() const { return boundPort; }
+
+    // Runs the event loop until stop() is called. Returns ConnectionFailed if epoll fails.
+    std::expected<void, ErrorInfo> run();
+    // Makes run() return; safe to call from another thread or a signal handler.
+    void stop();
+
+    uint64_t requestsServed() const { return requests.load(std::memory_order_relaxed); }
+
+private:
+    struct SharedSession {
+        std::unique_ptr<ShmRegion> region;
+        std::thread worker;
+    };
+
+    explicit KvServer(Server& server) : server(server) {}
+
+    struct Client {
+        std::string input;  // Bytes after the last complete request
+        std::string output; // Responses not yet accepted by the socket
+        size_t outputSent = 0;
+        bool writeWatched = false;
+        bool binary = false; // Sent "BINARY": requests are kv_wire.hpp frames
+        std::unique_ptr<SharedSession> shared;
+    };
+
+    void acceptClients();
+    // Reads and serves what the client sent; returns false once the client should be closed.
+    bool serve(int fd, Client& client);
+    void executeFrame(Client& client, std::string_view frame);
+    // Writes pending responses; returns false if the socket failed.
+    bool flush(int fd, Client& client);
+    void closeClient(int fd);
+    // Maps the client's region and starts serving it; returns the response line for the handshake.
+    std::string attachSharedMemory(Client& client, const std::string& name);
+    void serveShared(ShmRegion& region);
+    static void endSharedSession(Client& client);
+
+    Server& server;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1; // eventfd written by stop()
+    uint16_t boundPort = 0;
+    std::unordered_map<int, Client> clients;
+    std::atomic<uint64_t> requests{ 0 };
+};
+
+#endif // KV_SERVER_HPP
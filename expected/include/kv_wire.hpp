@@ -0,0 +1,68 @@
+#ifndef KV_WIRE_HPP
+#define KV_WIRE_HPP
+
+#include "query.hpp"
+#include "error.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string_view>
+
+// Binary framing of the kvserver protocol, which a connection switches to by sending the line "BINARY" (answered
+// "OK 0 binary"). Requests carry the parsed query instead of its text, so the server does not parse it again.
+// Responses carry the queryId they answer, and a client may pipeline any number of requests and match the
+// responses by that id.
+//
+// Every frame is a uint32 little-endian body length followed by the body. Integers are varints; ids are zigzag-encoded.
+//   Request:  tag byte (bits 0-1 Query::Type, bits 2-3 Query::Priority, bit 4 set if a value follows),
+//             id, depth, timeout in us (0 for none), key length + key, [value length + value]
+//   Response: status byte (WireStatus), queryId, error code, key version, length + data or error message
+// Failed results carry their ErrorCode; a QueryTimeout is sent with the TIMEOUT status.
+//
+// Encoding and decoding work on buffers the caller provides and never allocate; decoded frames point into them.
+constexpr size_t wireFrameHeaderSize = 4;
+constexpr size_t maxWireFrameSize = 16 * 1024 * 1024; // Larger length prefixes are rejected as garbage
+
+enum class WireStatus : uint8_t {
+    OK,
+    ERR,
+    TIMEOUT,
+};
+
+struct WireRequest {
+    QueryView query; // rawCommand is left empty
+    int depth = 0;
+    std::chrono::microseconds timeout{ 0 };
+};
+
+struct WireResponse {
+    int queryId = 0;
+    WireStatus status = WireStatus::OK;
+    ErrorCode errorCode = ErrorCode::UnknownError; // Only for ERR and TIMEOUT
+    uint64_t keyVersion = 0;
+    std::string_view payload; // Data if OK, else the error message
+
+    // Copies the response into an owning result.
+    QueryResult toResult() const;
+};
+
+// Exact size of the frame the matching encode call writes.
+size_t wireRequestSize(const Query& query, int depth, std::chrono::microseconds timeout);
+size_t wireResponseSize(const QueryResult& result);
+
+// Write one frame to the front of out and return its size, or 0 if out is too small.
+size_t encodeWireRequest(const Query& query, int depth, std::chrono::microseconds timeout, std::span<char> out);
+size_t encodeWireResponse(const QueryResult& result, std::span<char> out);
+
+// Size of the complete frame at the front of data, or 0 if it has not all arrived yet.
+// Returns ParseError if the length prefix exceeds maxWireFrameSize, as the stream cannot be resynchronised.
+std::expected<size_t, ErrorInfo> wireFrameSize(std::string_view data);
+
+// Decode a complete frame, header included. Return ParseError if the body is malformed. A request is held to the
+// depth and timeout limits of kv_protocol.hpp.
+std::expected<WireRequest, ErrorInfo> decodeWireRequest(std::string_view frame);
+std::expected<WireResponse, ErrorInfo> decodeWireResponse(std::string_view frame);
+
+#endif // KV_WIRE_HPP
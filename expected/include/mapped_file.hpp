@@ -0,0 +1,38 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <expected>
+#include "error.hpp"
+
+// Read-only memory mapping of a whole file; the mapping is released on destruction.
+// Empty files are represented by an empty view without a mapping.
+class MappedFile {
+public:
+    // Maps the file, or returns FileOpenFailed if it cannot be opened or mapped.
+    static std::expected<MappedFile, ErrorInfo> open(const std::string& filePath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    std::string_view view() const { return std::string_view(data, length); }
+    size_t size() const { return length; }
+
+private:
+    MappedFile() = default;
+    void release() noexcept;
+
+    const char* data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+#endif // MAPPED_FILE_HPP
@@ -3,22 +3,51 @@
 
 #include "connection.hpp" 
 #include "error.hpp"         
+#include "worker_pool.hpp"
+#include "single_flight.hpp"
+#include "deadline.hpp"
+#include "delimiter_scan.hpp"
+#include "key_interner.hpp"
 #include <string>
+#include <string_view>
+#include <functional>
 #include <vector>
 #include <future>         
 #include <memory>         
-#include <chrono>         
+#include <cstdint>
+#include <chrono>
+#include <stop_token>         
 #include <expected> 
+#include <optional>
 
 // Represents a single query to be executed
 struct Query {
     int id;
     enum class Type { GET, SET, DELETE };
+    // Scheduling class; the value doubles as the WorkerPool class index
+    enum class Priority { INTERACTIVE, NORMAL, BULK };
 
     Type type;
     std::string rawCommand;
     std::string key;
     std::optional<std::string> value;
+    std::optional<std::chrono::microseconds> timeout; // Overrides the engine's per-query timeout
+    Priority priority = Priority::NORMAL;
+    uint32_t keyId = KeyInterner::noId; // Set by callers that pre-intern for an INTERNED Server, which interns the rest itself
+};
+
+// Non-owning view of a parsed query line. Its fields point into the parsed buffer, so owned strings
+// are only created when the query is materialized for storage.
+struct QueryView {
+    int id = 0;
+    Query::Type type = Query::Type::GET;
+    Query::Priority priority = Query::Priority::NORMAL;
+    std::string_view rawCommand;
+    std::string_view key;
+    std::optional<std::string_view> value;
+
+    // Copies the view into an owning Query; an empty rawCommand is rebuilt from type, key and value.
+    Query materialize() const;
 };
 
 // Represents the result of a single query
@@ -26,6 +55,7 @@ struct QueryResult {
     int queryId;
 	std::expected<std::string, ErrorInfo> result;
     std::chrono::milliseconds executionTime;
+    uint64_t keyVersion = 0; // Server-side version of the key after this query
 
     void print() const;
 };
@@ -44,20 +74,128 @@ private:
     static int next_handle;
 };
 
+// Selects how executeQueries dispatches a batch
+enum class ExecutionMode {
+    ASYNC_FUTURES,      // One std::async task and future shared state per query
+    PREALLOCATED_SLOTS, // Pooled workers write each result straight into a presized slot;
+                        // Query::priority is honoured by weighted fair queuing across the workers
+    PIPELINED_BATCH,    // The whole batch goes out in one ConnectionManager::executeRemoteBatch call, pipelined over
+                        // the pooled connections; priorities and GET coalescing do not apply
+};
+
+// Stage counters of one executeQueryFilePipelined run. A parser that spends its time blocked on a full queue
+// means execution is the bottleneck; an executor starved by an empty queue means parsing is.
+struct PipelineStats {
+    size_t parsedQueries = 0;
+    size_t executedQueries = 0;
+    size_t batches = 0;
+    std::chrono::nanoseconds parseBusy{ 0 };
+    std::chrono::nanoseconds parseBlocked{ 0 };     // Parser waiting for queue space
+    std::chrono::nanoseconds executeBusy{ 0 };
+    std::chrono::nanoseconds executeStarved{ 0 };   // Executor waiting for a parsed batch
+    std::chrono::nanoseconds firstResultLatency{ 0 }; // From opening the file until the first batch has executed
+    std::chrono::nanoseconds elapsed{ 0 };
+    double averageQueueDepth = 0; // Batches waiting in the queue, sampled whenever the executor takes one
+    size_t maxQueueDepth = 0;
+};
+
+// Stage counters of one parseQueriesFromGzipFile run. Decompression runs on its own thread and overlaps parsing,
+// so the two busy times can add up to more than elapsed.
+struct IngestStats {
+    uint64_t compressedBytes = 0;
+    uint64_t decompressedBytes = 0;
+    std::chrono::nanoseconds decompressBusy{ 0 };
+    std::chrono::nanoseconds parseBusy{ 0 };
+    std::chrono::nanoseconds elapsed{ 0 };
+};
+
 class QueryEngine {
 public:
-    explicit QueryEngine(ConnectionManager& connManager) : connectionManager(connManager) {}
+    explicit QueryEngine(ConnectionManager& connManager, ExecutionMode mode = ExecutionMode::ASYNC_FUTURES);
 
-    std::vector<Query> parseQueriesFromFile(const std::string& filePath);
+    // Line-by-line stream parser; malformed lines are skipped. Returns FileOpenFailed if the file cannot be opened.
+    // gzip-compressed files are detected by their magic bytes and read through parseQueriesFromGzipFile.
+    std::expected<std::vector<Query>, ErrorInfo> parseQueriesFromFile(const std::string& filePath);
+    // Parses a gzip-compressed query file while it is decompressed: a background thread inflates the next block
+    // while this one is parsed, and nothing is written to disk. Malformed lines are skipped. stats, if given,
+    // receives the byte counts and busy time of each stage. Returns FileOpenFailed if the file cannot be opened
+    // and ParseError if the compressed data is corrupt.
+    std::expected<std::vector<Query>, ErrorInfo> parseQueriesFromGzipFile(const std::string& filePath, IngestStats* stats = nullptr);
+    // Parses only the queries with firstId <= id <= lastId, in file order, seeking straight to the lines that can
+    // hold them through the file's sidecar index (see QueryFileIndex). A missing or stale index is rebuilt and saved
+    // first. gzip files have no index and are parsed in full, then filtered. Returns FileOpenFailed if the file
+    // cannot be mapped.
+    std::expected<std::vector<Query>, ErrorInfo> parseQueriesFromFile(const std::string& filePath, int firstId, int lastId);
 
+    // Parses one "id,COMMAND[,priority]" line in place, without allocating.
+    static std::expected<QueryView, ErrorInfo> parseQueryLine(std::string_view line, int lineNumber);
+    // Memory-maps the file and parses it in place; only the stored queries allocate. Malformed lines are skipped.
+    // Large files are split at line boundaries and parsed on up to threadCount threads (0 = one per core);
+    // queries keep file order and diagnostics keep file line numbers.
+    std::expected<std::vector<Query>, ErrorInfo> parseQueriesFromMappedFile(const std::string& filePath, size_t threadCount = 1);
+    // Like parseQueriesFromMappedFile, but hands every well-formed line to onQuery instead of storing it.
+    // Returns the number of well-formed lines.
+    std::expected<size_t, ErrorInfo> scanQueriesFromMappedFile(const std::string& filePath, const std::function<void(const QueryView&)>& onQuery);
+    // Memory-maps a file written by querycompile and hands every record to onQuery without copying it.
+    // Returns the number of records, FileOpenFailed if the file cannot be mapped or ParseError if it is corrupt.
+    static std::expected<size_t, ErrorInfo> scanCompiledQueries(const std::string& filePath, const std::function<void(const QueryView&)>& onQuery);
+    static std::expected<std::vector<Query>, ErrorInfo> loadCompiledQueries(const std::string& filePath);
+    // Lines per sidecar index block. When non-zero, parseQueriesFromFile and parseQueriesFromMappedFile also save a
+    // sidecar index for every text file they parse that lacks a valid one. 0, the default, leaves sidecars alone.
+    void setSidecarIndexStride(uint32_t stride) { sidecarIndexStride = stride; }
+    // Delimiter scanning for the mapped-file parsers; defaults to the widest SIMD backend the CPU supports.
+    void setScanBackend(ScanBackend backend) { scanner = DelimiterScanner(backend); }
+    ScanBackend getScanBackend() const { return scanner.backend(); }
     // Executes a batch of queries, potentially in parallel
     // Returns a vector of QueryResult. Each QueryResult indicates success/failure.
-    std::vector<QueryResult> executeQueries(const std::vector<Query>& queries, int depth);
+    // Requesting a stop on stopToken cancels the queries of the batch that have not finished yet.
+    std::vector<QueryResult> executeQueries(const std::vector<Query>& queries, int depth, std::stop_token stopToken = {});
+
+    // Streams the file through a parser thread into the calling thread instead of parsing it up front: the parser
+    // pushes batches of up to batchSize queries into a queue of at most queueCapacity batches and each batch is
+    // executed as soon as it is taken, so memory is bounded by the queue rather than the file size.
+    // onResults receives every batch with its results, in file order.
+    std::expected<PipelineStats, ErrorInfo> executeQueryFilePipelined(const std::string& filePath, int depth, size_t batchSize, size_t queueCapacity,
+        const std::function<void(const std::vector<Query>&, std::vector<QueryResult>&)>& onResults = {}, std::stop_token stopToken = {});
+
+    // Deadline for queries without their own Query::timeout, counted from the start of the batch; zero, the
+    // default, disables it.
+    void setQueryTimeout(std::chrono::microseconds timeout) { queryTimeout = timeout; }
+    // Deadline for a whole executeQueries call; zero disables it.
+    void setBatchTimeout(std::chrono::microseconds timeout) { batchTimeout = timeout; }
+
+    // When enabled, concurrent GETs for the same key share a single server round trip.
+    // A completed SET/DELETE on a key closes its coalescing window.
+    void setGetCoalescing(bool enabled) { coalesceGets = enabled; }
+    uint64_t getExecutedGetCount() const { return inFlightGets.getExecutedCount(); }
+    uint64_t getCoalescedGetCount() const { return inFlightGets.getCoalescedCount(); }
 
 private:
-    QueryResult executeSingleQuery(const Query& query, int depth);
+    // Deadline state shared by every query of one executeQueries call
+    struct BatchDeadline {
+        QueryDeadline::Clock::time_point startedAt;
+        QueryDeadline limit; // Batch-wide deadline and cancellation token
+    };
+
+    QueryResult executeSingleQuery(const Query& query, int depth, const QueryDeadline& deadline);
+    QueryResult dispatchQuery(const Query& query, int depth, const QueryDeadline& deadline);
+    std::vector<QueryResult> executeWithFutures(const std::vector<Query>& queries, int depth, const BatchDeadline& batch);
+    std::vector<QueryResult> executeIntoSlots(const std::vector<Query>& queries, int depth, const BatchDeadline& batch);
+    std::vector<QueryResult> executePipelined(const std::vector<Query>& queries, int depth, const BatchDeadline& batch);
+    // The query's own timeout counted from the start of the batch, capped by the batch deadline.
+    QueryDeadline deadlineFor(const Query& query, const BatchDeadline& batch) const;
+    // Parses every line of text, numbering lines from 1, and returns the number of lines.
+    int scanQueryText(std::string_view text, const std::function<void(const QueryView&)>& onQuery, const std::function<void(const ErrorInfo&)>& onMalformed) const;
 
     ConnectionManager& connectionManager;
+    ExecutionMode executionMode;
+    std::unique_ptr<WorkerPool> workerPool;
+    bool coalesceGets = false;
+    SingleFlight<QueryResult> inFlightGets;
+    std::chrono::microseconds queryTimeout{ 0 };
+    std::chrono::microseconds batchTimeout{ 0 };
+    DelimiterScanner scanner;
+    uint32_t sidecarIndexStride = 0;
 };
 
 #endif // QUERY_HPP
\ No newline at end of file
@@ -0,0 +1,602 @@
+#include "batch_transport.hpp"
+#include "kv_wire.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr unsigned ringEntries = 256;
+constexpr unsigned receiveBufferCount = 64; // Power of two, as the provided buffer ring requires
+constexpr size_t receiveBufferSize = 16 * 1024;
+constexpr size_t sendArenaSize = 1 << 20;
+constexpr uint16_t receiveGroup = 0;
+constexpr std::chrono::milliseconds waitSlice(10); // Upper bound on one wait, so a stop request is noticed
+
+// user_data of a submission: the channel index above the operation
+enum Operation : uint64_t {
+    SEND = 1,
+    RECEIVE = 2,
+    CANCEL = 3,
+};
+
+uint64_t tag(size_t channel, Operation operation) {
+    return (static_cast<uint64_t>(channel) << 8) | operation;
+}
+
+void* mapMemory(size_t size, int fd = -1, off_t offset = 0) {
+    int flags = fd < 0 ? MAP_PRIVATE | MAP_ANONYMOUS : MAP_SHARED | MAP_POPULATE;
+    return ::mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, offset);
+}
+
+// Whether the kernel behind ringFd implements opcode, asked with IORING_REGISTER_PROBE
+bool supportsOperation(int ringFd, uint8_t opcode) {
+    constexpr unsigned probedOps = 256;
+    alignas(io_uring_probe) char buffer[sizeof(io_uring_probe) + probedOps * sizeof(io_uring_probe_op)] = {};
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer);
+    if (::syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, probedOps) < 0) {
+        return false;
+    }
+    return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+// Moves every complete line or frame of channel.received into channel.responses, up to the number expected
+void takeResponses(BatchChannel& channel) {
+    size_t begin = 0;
+    if (channel.framed) {
+        while (channel.responses.size() < channel.expectedResponses) {
+            auto size = wireFrameSize(std::string_view(channel.received).substr(begin));
+            if (!size) {
+                channel.error = size.error().message;
+                break;
+            }
+            if (*size == 0) {
+                break;
+            }
+            channel.responses.emplace_back(channel.received, begin, *size);
+            begin += *size;
+        }
+    }
+    else {
+        for (size_t newline; channel.responses.size() < channel.expectedResponses
+            && (newline = channel.received.find('\n', begin)) != std::string::npos; begin = newline + 1) {
+            channel.responses.emplace_back(channel.received, begin, newline - begin);
+        }
+    }
+    channel.received.erase(0, begin);
+}
+
+std::string systemError(const std::string& what, int error) {
+    return what + ": " + std::strerror(error);
+}
+
+// Time left before the deadline, capped at one wait slice
+std::chrono::milliseconds nextWait(const QueryDeadline& deadline) {
+    if (deadline.expiresAt == QueryDeadline::Clock::time_point::max()) {
+        return waitSlice;
+    }
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline.expiresAt - QueryDeadline::Clock::now());
+    return std::clamp(remaining, std::chrono::milliseconds(0), waitSlice);
+}
+
+} // namespace
+
+// An io_uring instance mapped by hand: liburing is not a dependency, so setup, registration and submission
+// go through the raw system calls. Owns a registered send arena and a provided buffer ring for receives.
+struct BatchTransport::Ring {
+    int fd = -1;
+    void* sqMap = MAP_FAILED;
+    size_t sqMapSize = 0;
+    void* cqMap = MAP_FAILED;
+    size_t cqMapSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned queued = 0; // Written to the SQ but not yet submitted
+
+    char* sendArena = static_cast<char*>(MAP_FAILED);
+    // Entries of the provided buffer ring. The kernel overlays the ring tail on the first entry's resv field;
+    // io_uring_buf_ring is not used because g++ lays out its flexible array member 8 bytes further in.
+    io_uring_buf* receiveRing = static_cast<io_uring_buf*>(MAP_FAILED);
+    char* receiveBuffers = static_cast<char*>(MAP_FAILED);
+    uint16_t receiveTail = 0;
+    bool zeroCopy = true; // Cleared once a socket refuses SEND_ZC, as only TCP sockets support it
+
+    // nullptr if the kernel lacks any of the features used
+    static std::unique_ptr<Ring> open();
+    ~Ring();
+
+    int enter(unsigned submit, unsigned waitFor, unsigned flags, const void* argument = nullptr, size_t argumentSize = 0) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, submit, waitFor, flags, argument, argumentSize));
+    }
+
+    // Next free SQE, zeroed, or nullptr if the SQ is full until the queued ones are submitted
+    io_uring_sqe* nextSqe() {
+        unsigned tail = *sqTail;
+        if (tail - std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire) > sqMask) {
+            return nullptr;
+        }
+        io_uring_sqe* sqe = &sqes[tail & sqMask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        std::atomic_ref<unsigned>(*sqTail).store(tail + 1, std::memory_order_release);
+        ++queued;
+        return sqe;
+    }
+
+    // Hands a receive buffer back to the kernel
+    void provide(uint16_t bufferId) {
+        io_uring_buf& buffer = receiveRing[receiveTail & (receiveBufferCount - 1)];
+        buffer.addr = reinterpret_cast<uint64_t>(receiveBuffers + size_t(bufferId) * receiveBufferSize);
+        buffer.len = static_cast<uint32_t>(receiveBufferSize);
+        buffer.bid = bufferId;
+        ++receiveTail;
+        std::atomic_ref<uint16_t>(receiveRing[0].resv).store(receiveTail, std::memory_order_release);
+    }
+};
+
+std::unique_ptr<BatchTransport::Ring> BatchTransport::Ring::open() {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_COOP_TASKRUN; // Completions are only ever reaped by the submitting thread
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, ringEntries, &params));
+    if (fd < 0) {
+        return nullptr;
+    }
+    auto ring = std::make_unique<Ring>();
+    ring->fd = fd;
+    // SEND_ZC and multishot receive both arrived in 6.0, so a kernel that implements the first has the second;
+    // an older one would accept the ring and the buffer registrations, then fail every send with -EINVAL
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !supportsOperation(fd, IORING_OP_SEND_ZC)) {
+        return nullptr;
+    }
+
+    ring->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap) {
+        ring->sqMapSize = ring->cqMapSize = std::max(ring->sqMapSize, ring->cqMapSize);
+    }
+    ring->sqMap = mapMemory(ring->sqMapSize, fd, IORING_OFF_SQ_RING);
+    if (ring->sqMap == MAP_FAILED) {
+        return nullptr;
+    }
+    ring->cqMap = singleMap ? ring->sqMap : mapMemory(ring->cqMapSize, fd, IORING_OFF_CQ_RING);
+    ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes = static_cast<io_uring_sqe*>(mapMemory(ring->sqesSize, fd, IORING_OFF_SQES));
+    if (ring->cqMap == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        return nullptr;
+    }
+    char* sq = static_cast<char*>(ring->sqMap);
+    char* cq = static_cast<char*>(ring->cqMap);
+    ring->sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    unsigned* sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; ++i) {
+        sqArray[i] = i; // SQEs are used in ring order, so the indirection array stays the identity
+    }
+    ring->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // Requests are copied into a registered arena and sent from it with SEND_ZC, saving the per-send page pinning
+    ring->sendArena = static_cast<char*>(mapMemory(sendArenaSize));
+    if (ring->sendArena == MAP_FAILED) {
+        return nullptr;
+    }
+    iovec arena{ ring->sendArena, sendArenaSize };
+    if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, &arena, 1) < 0) {
+        return nullptr;
+    }
+
+    // Multishot receives pick their buffers from a ring shared with the kernel
+    ring->receiveRing = static_cast<io_uring_buf*>(mapMemory(receiveBufferCount * sizeof(io_uring_buf)));
+    ring->receiveBuffers = static_cast<char*>(mapMemory(receiveBufferCount * receiveBufferSize));
+    if (ring->receiveRing == MAP_FAILED || ring->receiveBuffers == MAP_FAILED) {
+        return nullptr;
+    }
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(ring->receiveRing);
+    registration.ring_entries = receiveBufferCount;
+    registration.bgid = receiveGroup;
+    if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        return nullptr;
+    }
+    for (uint16_t bufferId = 0; bufferId < receiveBufferCount; ++bufferId) {
+        ring->provide(bufferId);
+    }
+    return ring;
+}
+
+BatchTransport::Ring::~Ring() {
+    if (fd >= 0) {
+        ::close(fd); // Also drops the registered buffers
+    }
+    if (receiveBuffers != MAP_FAILED) {
+        ::munmap(receiveBuffers, receiveBufferCount * receiveBufferSize);
+    }
+    if (receiveRing != MAP_FAILED) {
+        ::munmap(receiveRing, receiveBufferCount * sizeof(io_uring_buf));
+    }
+    if (sendArena != MAP_FAILED) {
+        ::munmap(sendArena, sendArenaSize);
+    }
+    if (sqes != MAP_FAILED) {
+        ::munmap(sqes, sqesSize);
+    }
+    if (cqMap != MAP_FAILED && cqMap != sqMap) {
+        ::munmap(cqMap, cqMapSize);
+    }
+    if (sqMap != MAP_FAILED) {
+        ::munmap(sqMap, sqMapSize);
+    }
+}
+
+IoBackend detectIoBackend() {
+    static const IoBackend detected = BatchTransport(IoBackend::IO_URING).backend();
+    return detected;
+}
+
+const char* ioBackendName(IoBackend backend) {
+    switch (backend) {
+    case IoBackend::EPOLL: return "epoll";
+    case IoBackend::IO_URING: return "io_uring";
+    default: return "unknown";
+    }
+}
+
+BatchTransport::BatchTransport(IoBackend backend) : selected(IoBackend::EPOLL) {
+    if (backend == IoBackend::IO_URING) {
+        ring = Ring::open();
+        if (ring) {
+            selected = IoBackend::IO_URING;
+        }
+    }
+}
+
+BatchTransport::~BatchTransport() {
+    if (epollFd >= 0) {
+        ::close(epollFd);
+    }
+}
+
+void BatchTransport::exchange(std::vector<BatchChannel>& channels, const QueryDeadline& deadline) {
+    ++stats.batches;
+    for (BatchChannel& channel : channels) {
+        stats.requests += channel.expectedResponses;
+        takeResponses(channel); // Lines that arrived before the batch answer its first requests
+    }
+    if (selected == IoBackend::IO_URING) {
+        exchangeUring(channels, deadline);
+    }
+    else {
+        exchangeEpoll(channels, deadline);
+    }
+    for (BatchChannel& channel : channels) {
+        if (!channel.complete() && channel.error.empty()) {
+            channel.timedOut = true;
+        }
+    }
+}
+
+void BatchTransport::exchangeUring(std::vector<BatchChannel>& channels, const QueryDeadline& deadline) {
+    // Each channel sends through its own slice of the arena, a slice at a time, so the kernel only ever
+    // reads memory the ring owns even if the batch is abandoned at the deadline
+    struct Progress {
+        size_t sent = 0;
+        size_t inFlight = 0;  // Bytes of the send in progress
+        bool sending = false; // Until the kernel is done with the channel's arena slice
+        bool zeroCopy = false;
+        bool receiving = false;
+        bool cancelled = false;
+    };
+    std::vector<Progress> progress(channels.size());
+    size_t sliceSize = channels.empty() ? 0 : sendArenaSize / channels.size();
+    size_t outstanding = 0; // Submitted operations whose final completion has not been reaped
+
+    auto submit = [&](unsigned waitFor, const void* argument, size_t argumentSize) {
+        unsigned flags = waitFor > 0 ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0;
+        int result = ring->enter(ring->queued, waitFor, flags, argument, argumentSize);
+        ++stats.syscalls;
+        ring->queued = *ring->sqTail - std::atomic_ref<unsigned>(*ring->sqHead).load(std::memory_order_acquire);
+        return result;
+        };
+    auto sqe = [&]() {
+        io_uring_sqe* entry = ring->nextSqe();
+        while (entry == nullptr) {
+            submit(0, nullptr, 0);
+            entry = ring->nextSqe();
+        }
+        ++outstanding;
+        return entry;
+        };
+    auto queueSend = [&](size_t i) {
+        Progress& state = progress[i];
+        const std::string& requests = channels[i].requests;
+        state.inFlight = std::min(sliceSize, requests.size() - state.sent);
+        char* slice = ring->sendArena + i * sliceSize;
+        std::memcpy(slice, requests.data() + state.sent, state.inFlight);
+        io_uring_sqe* entry = sqe();
+        state.zeroCopy = ring->zeroCopy;
+        if (state.zeroCopy) {
+            entry->opcode = IORING_OP_SEND_ZC;
+            entry->ioprio = IORING_RECVSEND_FIXED_BUF;
+            entry->buf_index = 0;
+        }
+        else {
+            entry->opcode = IORING_OP_SEND;
+        }
+        entry->fd = channels[i].fd;
+        entry->addr = reinterpret_cast<uint64_t>(slice);
+        entry->len = static_cast<uint32_t>(state.inFlight);
+        entry->msg_flags = MSG_NOSIGNAL; // A write would raise SIGPIPE on a closed connection
+        entry->user_data = tag(i, SEND);
+        state.sending = true;
+        };
+    auto queueReceive = [&](size_t i) {
+        io_uring_sqe* entry = sqe();
+        entry->opcode = IORING_OP_RECV;
+        entry->fd = channels[i].fd;
+        entry->ioprio = IORING_RECV_MULTISHOT;
+        entry->flags = IOSQE_BUFFER_SELECT;
+        entry->buf_group = receiveGroup;
+        entry->user_data = tag(i, RECEIVE);
+        progress[i].receiving = true;
+        };
+    // Stops the channel's multishot receive, so no later read on its socket races with the ring
+    auto queueCancel = [&](size_t i) {
+        if (progress[i].cancelled || (!progress[i].receiving && !progress[i].sending)) {
+            return;
+        }
+        io_uring_sqe* entry = sqe();
+        entry->opcode = IORING_OP_ASYNC_CANCEL;
+        entry->fd = channels[i].fd;
+        entry->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        entry->user_data = tag(i, CANCEL);
+        progress[i].cancelled = true;
+        };
+    auto finished = [&](size_t i) { return channels[i].complete() || !channels[i].error.empty(); };
+
+    for (size_t i = 0; i < channels.size(); ++i) {
+        if (finished(i)) {
+            continue;
+        }
+        if (!channels[i].requests.empty()) {
+            queueSend(i);
+        }
+        queueReceive(i);
+    }
+
+    bool expired = false;
+    while (outstanding > 0) {
+        if (!expired && deadline.expired()) {
+            expired = true;
+            for (size_t i = 0; i < channels.size(); ++i) {
+                queueCancel(i);
+            }
+        }
+        __kernel_timespec timeout{};
+        timeout.tv_nsec = std::chrono::nanoseconds(expired ? waitSlice : nextWait(deadline)).count();
+        io_uring_getevents_arg argument{};
+        argument.ts = reinterpret_cast<uint64_t>(&timeout);
+        int result = submit(1, &argument, sizeof(argument));
+        if (result < 0 && errno != ETIME && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+            // The ring itself failed; abandon it and let later batches use epoll
+            std::string message = systemError("io_uring_enter failed", errno);
+            for (BatchChannel& channel : channels) {
+                if (!channel.complete()) {
+                    channel.error = message;
+                }
+            }
+            ring.reset();
+            selected = IoBackend::EPOLL;
+            return;
+        }
+
+        unsigned head = *ring->cqHead;
+        unsigned tail = std::atomic_ref<unsigned>(*ring->cqTail).load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = ring->cqes[head & ring->cqMask];
+            size_t i = static_cast<size_t>(cqe.user_data >> 8);
+            BatchChannel& channel = channels[i];
+            Progress& state = progress[i];
+            switch (static_cast<Operation>(cqe.user_data & 0xff)) {
+            case SEND:
+                if (!(cqe.flags & IORING_CQE_F_NOTIF)) {
+                    if (cqe.res == -EOPNOTSUPP && state.zeroCopy) {
+                        ring->zeroCopy = false; // Sent again below, copying
+                    }
+                    else if (cqe.res < 0) {
+                        if (cqe.res != -ECANCELED && channel.error.empty()) {
+                            channel.error = systemError("Failed to send", -cqe.res);
+                        }
+                    }
+                    else {
+                        state.sent += static_cast<size_t>(cqe.res);
+                    }
+                    if (cqe.flags & IORING_CQE_F_MORE) {
+                        break; // A zero-copy send is followed by a notification once the slice may be reused
+                    }
+                }
+                --outstanding;
+                state.sending = false;
+                if (state.sent < channel.requests.size() && !state.cancelled && channel.error.empty()) {
+                    queueSend(i);
+                }
+                break;
+            case RECEIVE:
+                if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                    uint16_t bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                    channel.received.append(ring->receiveBuffers + size_t(bufferId) * receiveBufferSize, static_cast<size_t>(cqe.res));
+                    ring->provide(bufferId);
+                    takeResponses(channel);
+                }
+                else if (cqe.res == 0 && !channel.complete() && channel.error.empty()) {
+                    channel.error = "Connection closed by peer";
+                }
+                else if (cqe.res < 0 && cqe.res != -ECANCELED && cqe.res != -ENOBUFS && channel.error.empty()) {
+                    channel.error = systemError("Failed to receive", -cqe.res);
+                }
+                if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                    --outstanding;
+                    state.receiving = false;
+                    // Out of buffers, or the kernel ended the multishot early: arm it again
+                    if (!finished(i) && !state.cancelled && cqe.res != 0) {
+                        queueReceive(i);
+                    }
+                }
+                if (finished(i)) {
+                    queueCancel(i);
+                }
+                break;
+            case CANCEL:
+                --outstanding;
+                break;
+            }
+        }
+        std::atomic_ref<unsigned>(*ring->cqHead).store(head, std::memory_order_release);
+    }
+}
+
+void BatchTransport::exchangeEpoll(std::vector<BatchChannel>& channels, const QueryDeadline& deadline) {
+    if (epollFd < 0) {
+        epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        ++stats.syscalls;
+        if (epollFd < 0) {
+            std::string message = systemError("Failed to create epoll instance", errno);
+            for (BatchChannel& channel : channels) {
+                channel.error = message;
+            }
+            return;
+        }
+    }
+
+    std::vector<size_t> sent(channels.size(), 0);
+    std::vector<bool> watched(channels.size(), false);
+    size_t active = 0;
+
+    // Sends what the socket accepts; false if it failed
+    auto sendMore = [&](size_t i) {
+        BatchChannel& channel = channels[i];
+        while (sent[i] < channel.requests.size()) {
+            ssize_t written = ::send(channel.fd, channel.requests.data() + sent[i], channel.requests.size() - sent[i], MSG_NOSIGNAL | MSG_DONTWAIT);
+            ++stats.syscalls;
+            if (written >= 0) {
+                sent[i] += static_cast<size_t>(written);
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            else if (errno != EINTR) {
+                channel.error = systemError("Failed to send", errno);
+                return false;
+            }
+        }
+        return true;
+        };
+    // Reads until the socket is drained; false if it failed or closed
+    auto receiveMore = [&](size_t i) {
+        BatchChannel& channel = channels[i];
+        char buffer[receiveBufferSize];
+        while (!channel.complete()) {
+            ssize_t received = ::recv(channel.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            ++stats.syscalls;
+            if (received > 0) {
+                channel.received.append(buffer, static_cast<size_t>(received));
+                takeResponses(channel);
+                if (!channel.error.empty()) {
+                    return false;
+                }
+            }
+            else if (received == 0) {
+                channel.error = "Connection closed by peer";
+                return false;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            else if (errno != EINTR) {
+                channel.error = systemError("Failed to receive", errno);
+                return false;
+            }
+        }
+        return true;
+        };
+    auto watch = [&](size_t i, int operation) {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP | (sent[i] < channels[i].requests.size() ? static_cast<uint32_t>(EPOLLOUT) : 0);
+        event.data.u64 = i;
+        ++stats.syscalls;
+        return ::epoll_ctl(epollFd, operation, channels[i].fd, &event) == 0;
+        };
+    auto unwatch = [&](size_t i) {
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, channels[i].fd, nullptr);
+        ++stats.syscalls;
+        watched[i] = false;
+        --active;
+        };
+
+    for (size_t i = 0; i < channels.size(); ++i) {
+        if (channels[i].complete() || !sendMore(i)) {
+            continue;
+        }
+        if (!watch(i, EPOLL_CTL_ADD)) {
+            channels[i].error = systemError("Failed to watch socket", errno);
+            continue;
+        }
+        watched[i] = true;
+        ++active;
+    }
+
+    epoll_event events[64];
+    while (active > 0 && !deadline.expired()) {
+        int ready = ::epoll_wait(epollFd, events, 64, static_cast<int>(nextWait(deadline).count()));
+        ++stats.syscalls;
+        if (ready < 0 && errno != EINTR) {
+            std::string message = systemError("epoll_wait failed", errno);
+            for (BatchChannel& channel : channels) {
+                if (!channel.complete()) {
+                    channel.error = message;
+                }
+            }
+            break;
+        }
+        for (int e = 0; e < ready; ++e) {
+            size_t i = static_cast<size_t>(events[e].data.u64);
+            bool writable = (events[e].events & EPOLLOUT) != 0;
+            bool ok = true;
+            if (writable) {
+                ok = sendMore(i);
+                // Stop asking for EPOLLOUT once everything is sent
+                if (ok && sent[i] == channels[i].requests.size()) {
+                    watch(i, EPOLL_CTL_MOD);
+                }
+            }
+            if (ok && (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR))) {
+                ok = receiveMore(i);
+            }
+            if (!ok || channels[i].complete()) {
+                unwatch(i);
+            }
+        }
+    }
+    for (size_t i = 0; i < channels.size(); ++i) {
+        if (watched[i]) {
+            unwatch(i);
+        }
+    }
+}
@@ -1,8 +1,11 @@
 ﻿#include "config.hpp"
+#include "diagnostics.hpp"
 #include "utility.hpp"
 #include <fstream>
 #include <sstream>
 #include <algorithm> 
+#include <charconv>
+#include <cctype>
 
 std::expected<AppConfig, ErrorInfo> ConfigLoader::loadConfig(const std::string& filePath) {
     std::ifstream configFile(filePath);
@@ -14,6 +17,7 @@ std::expected<AppConfig, ErrorInfo> ConfigLoader::loadConfig(const std::string&
 
     AppConfig config;
     std::unordered_map<std::string, std::string> rawConfig;
+    std::unordered_map<std::string, int> keyLines;
     std::string line;
     int lineNumber = 0;
     while (std::getline(configFile, line)) {
@@ -28,6 +32,12 @@ std::expected<AppConfig, ErrorInfo> ConfigLoader::loadConfig(const std::string&
             // Log and return the error
             return std::unexpected(parseResult.error());
         }
+        auto [seen, inserted] = keyLines.try_emplace(parseResult.value().first, lineNumber);
+        if (!inserted) {
+            DiagnosticsSink::shared().report(ErrorCode::InvalidParameterValue, ErrorInfo{ ErrorCode::InvalidParameterValue,
+                "'" + parseResult.value().first + "' overrides the value set on line " + std::to_string(seen->second), lineNumber }.fullMessage());
+            seen->second = lineNumber;
+        }
         rawConfig[parseResult.value().first] = parseResult.value().second;
     }
 
@@ -82,19 +92,26 @@ std::expected<void, ErrorInfo> ConfigLoader::validateAndApply(AppConfig& config,
         }
         std::string valStr = valStrExpected.value();
 
-        int valInt;
-        try {
-            valInt = std::stoi(valStr);
+        // Same leniency as std::stoi: leading whitespace and '+' are accepted, trailing characters ignored
+        const char* first = valStr.data();
+        const char* last = valStr.data() + valStr.size();
+        while (first != last && std::isspace(static_cast<unsigned char>(*first))) {
+            ++first;
+        }
+        if (first != last && *first == '+' && first + 1 != last && *(first + 1) != '-') {
+            ++first;
         }
-        catch (const std::invalid_argument& ia) {
+        int valInt = 0;
+        auto [end, ec] = std::from_chars(first, last, valInt);
+        if (ec == std::errc::invalid_argument) {
             return std::unexpected(ErrorInfo{
                 ErrorCode::InvalidParameterValue,
-                "Invalid integer value for parameter '" + key + "': " + valStr + ". " + ia.what() });
+                "Invalid integer value for parameter '" + key + "': " + valStr + "." });
         }
-        catch (const std::out_of_range& oor) {
+        if (ec == std::errc::result_out_of_range) {
             return std::unexpected(ErrorInfo{
                 ErrorCode::ParameterValueOutOfRange,
-                "Integer value out of range for parameter '" + key + "': " + valStr + ". " + oor.what() });
+                "Integer value out of range for parameter '" + key + "': " + valStr + "." });
         }
 
         if (minValue != -1 && valInt < minValue) {
@@ -126,6 +143,128 @@ std::expected<void, ErrorInfo> ConfigLoader::validateAndApply(AppConfig& config,
         ASSIGN_OR_RETURN_ERROR(config.connectionTimeoutMs, getIntValue("connection_timeout_ms", 100, 60000));
     }
 
+    if (rawConfig.count("client_cache_capacity")) {
+        ASSIGN_OR_RETURN_ERROR(config.clientCacheCapacity, getIntValue("client_cache_capacity", 0, 10000000));
+    }
+
+    if (rawConfig.count("client_cache_validation_percent")) {
+        ASSIGN_OR_RETURN_ERROR(config.clientCacheValidationPercent, getIntValue("client_cache_validation_percent", 0, 100));
+    }
+
+    if (rawConfig.count("pool_size")) {
+        ASSIGN_OR_RETURN_ERROR(config.poolSize, getIntValue("pool_size", 0, 1024));
+    }
+
+    if (rawConfig.count("breaker_window")) {
+        ASSIGN_OR_RETURN_ERROR(config.breakerWindow, getIntValue("breaker_window", 0, 1000));
+    }
+
+    if (rawConfig.count("breaker_failure_percent")) {
+        ASSIGN_OR_RETURN_ERROR(config.breakerFailurePercent, getIntValue("breaker_failure_percent", 1, 100));
+    }
+
+    if (rawConfig.count("breaker_cooldown_ms")) {
+        ASSIGN_OR_RETURN_ERROR(config.breakerCooldownMs, getIntValue("breaker_cooldown_ms", 0, 600000));
+    }
+
+    if (rawConfig.count("connect_race_delay_ms")) {
+        ASSIGN_OR_RETURN_ERROR(config.connectRaceDelayMs, getIntValue("connect_race_delay_ms", 0, 60000));
+    }
+
+    if (rawConfig.count("hedge_percentile")) {
+        ASSIGN_OR_RETURN_ERROR(config.hedgePercentile, getIntValue("hedge_percentile", 0, 99));
+    }
+
+    if (rawConfig.count("hedge_budget_percent")) {
+        ASSIGN_OR_RETURN_ERROR(config.hedgeBudgetPercent, getIntValue("hedge_budget_percent", 0, 100));
+    }
+
+    if (rawConfig.count("read_balancing")) {
+        std::string readBalancing;
+        ASSIGN_OR_RETURN_ERROR(readBalancing, getValue("read_balancing"));
+        if (readBalancing == "primary") {
+            config.readBalancing = ReadBalancing::PRIMARY_ONLY;
+        }
+        else if (readBalancing == "least_outstanding") {
+            config.readBalancing = ReadBalancing::LEAST_OUTSTANDING;
+        }
+        else {
+            return std::unexpected(ErrorInfo{
+                ErrorCode::InvalidParameterValue,
+                "Invalid value for parameter 'read_balancing': " + readBalancing + ". Expected 'primary' or 'least_outstanding'" });
+        }
+    }
+
+    if (rawConfig.count("transport")) {
+        std::string transport;
+        ASSIGN_OR_RETURN_ERROR(transport, getValue("transport"));
+        if (transport == "simulated") {
+            config.transport = Transport::SIMULATED;
+        }
+        else if (transport == "tcp") {
+            config.transport = Transport::TCP;
+        }
+        else if (transport == "shm") {
+            config.transport = Transport::SHARED_MEMORY;
+        }
+        else {
+            return std::unexpected(ErrorInfo{
+                ErrorCode::InvalidParameterValue,
+                "Invalid value for parameter 'transport': " + transport + ". Expected 'simulated', 'tcp' or 'shm'" });
+        }
+    }
+
+    if (rawConfig.count("protocol")) {
+        std::string protocol;
+        ASSIGN_OR_RETURN_ERROR(protocol, getValue("protocol"));
+        if (protocol == "text") {
+            config.wireProtocol = WireProtocol::TEXT;
+        }
+        else if (protocol == "binary") {
+            config.wireProtocol = WireProtocol::BINARY;
+        }
+        else {
+            return std::unexpected(ErrorInfo{
+                ErrorCode::InvalidParameterValue,
+                "Invalid value for parameter 'protocol': " + protocol + ". Expected 'text' or 'binary'" });
+        }
+    }
+
+    if (config.transport != Transport::TCP && config.wireProtocol == WireProtocol::BINARY) {
+        // The simulated transport has no wire, and the shared-memory rings carry lines
+        DiagnosticsSink::shared().report(ErrorCode::InvalidParameterValue, ErrorInfo{ ErrorCode::InvalidParameterValue,
+            "protocol = binary is ignored unless transport = tcp" }.fullMessage());
+        config.wireProtocol = WireProtocol::TEXT;
+    }
+
+    if (config.transport != Transport::SIMULATED && config.hedgePercentile > 0) {
+        // Separate kvserver processes do not replicate, so a hedge could return the backup's stale or missing value
+        DiagnosticsSink::shared().report(ErrorCode::InvalidParameterValue, ErrorInfo{ ErrorCode::InvalidParameterValue,
+            "hedge_percentile is ignored unless transport = simulated" }.fullMessage());
+        config.hedgePercentile = 0;
+    }
+
+    if (config.transport != Transport::SIMULATED && config.readBalancing != ReadBalancing::PRIMARY_ONLY) {
+        // Separate kvserver processes do not replicate, so reads sent to the backup would miss the primary's writes
+        DiagnosticsSink::shared().report(ErrorCode::InvalidParameterValue, ErrorInfo{ ErrorCode::InvalidParameterValue,
+            "read_balancing is ignored unless transport = simulated" }.fullMessage());
+        config.readBalancing = ReadBalancing::PRIMARY_ONLY;
+    }
+
+    if (config.readBalancing != ReadBalancing::PRIMARY_ONLY && config.hedgePercentile > 0) {
+        // Hedges are timed against the primary's latency alone, while balanced reads go to either server
+        DiagnosticsSink::shared().report(ErrorCode::InvalidParameterValue, ErrorInfo{ ErrorCode::InvalidParameterValue,
+            "hedge_percentile is ignored with read_balancing = least_outstanding" }.fullMessage());
+        config.hedgePercentile = 0;
+    }
+
+    if (config.transport != Transport::SIMULATED && config.clientCacheCapacity > 0) {
+        // The cache validates hits against the in-process server, which a kvserver client does not use
+        DiagnosticsSink::shared().report(ErrorCode::InvalidParameterValue, ErrorInfo{ ErrorCode::InvalidParameterValue,
+            "client_cache_capacity is ignored unless transport = simulated" }.fullMessage());
+        config.clientCacheCapacity = 0;
+    }
+
     // Custom semantic validation
     if (config.primaryServerAddress == config.backupServerAddress && config.primaryServerPort == config.backupServerPort) {
         return std::unexpected(ErrorInfo{
@@ -1,112 +1,507 @@
 #include "connection.hpp"
 #include "query.hpp"
+#include "diagnostics.hpp"
+#include "kv_protocol.hpp"
+#include "kv_wire.hpp"
+#include <algorithm>
 #include <thread>   
 #include <chrono>
 #include <cmath>  
-#include <random> 
 #include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 // Initialize static members
-int NetworkResource::next_available_handle = 1;
+std::atomic<int> NetworkResource::next_available_handle{ 1 };
+std::atomic<uint64_t> NetworkResource::syscallCount{ 0 };
 ConnectionManager::FailureSimConfig ConnectionManager::primarySim;
 ConnectionManager::FailureSimConfig ConnectionManager::backupSim;
 
-NetworkResource::NetworkResource(NetworkResource&& other) noexcept : address(std::move(other.address)), handle(other.handle) {
+ConnectionManager::ConnectionManager(const AppConfig& appConfig, Server& svr, TimeSource& time, uint64_t seed)
+    : config(appConfig), currentMode(ConnectionMode::DISCONNECTED), server(svr), timeSource(time), random(seed),
+      primaryBreaker(static_cast<size_t>(config.breakerWindow), config.breakerFailurePercent, std::chrono::milliseconds(config.breakerCooldownMs), time),
+      primaryLatency(config.hedgePercentile), hedgeBudget(config.hedgeBudgetPercent) {
+    if (config.clientCacheCapacity > 0) {
+        clientCache = std::make_unique<ClientCache>(
+            static_cast<size_t>(config.clientCacheCapacity),
+            config.clientCacheValidationPercent,
+            [this](const std::string& key) { return server.getKeyVersion(key); });
+    }
+}
+
+NetworkResource::~NetworkResource() {
+    closeSocket();
+    handle = -1;
+}
+
+NetworkResource::NetworkResource(NetworkResource&& other) noexcept
+    : address(std::move(other.address)), handle(other.handle), socketFd(other.socketFd), pending(std::move(other.pending)), abandoned(other.abandoned), binary(other.binary), sharedMemory(std::move(other.sharedMemory)) {
     other.handle = -1;
+    other.socketFd = -1;
 }
 
 NetworkResource& NetworkResource::operator=(NetworkResource&& other) noexcept {
     if (this != &other) {
+        closeSocket();
         address = std::move(other.address);
         handle = other.handle;
+        socketFd = other.socketFd;
+        pending = std::move(other.pending);
+        abandoned = other.abandoned;
+        binary = other.binary;
+        sharedMemory = std::move(other.sharedMemory);
         other.handle = -1;
+        other.socketFd = -1;
     }
     return *this;
 }
 
+void NetworkResource::closeSocket() {
+    if (sharedMemory) {
+        sharedMemory->close(); // Wakes the server's thread for this connection at once
+        sharedMemory.reset();
+    }
+    if (socketFd >= 0) {
+        ::close(socketFd);
+        socketFd = -1;
+        handle = -1;
+    }
+    pending.clear();
+}
+
+bool NetworkResource::isValid() const {
+    if (handle == -1) {
+        return false;
+    }
+    if (socketFd < 0) {
+        return true;
+    }
+    // An idle connection has nothing to read: readable means closed, failed or holding a stray response.
+    // Abandoned responses are expected, so then only a hang-up counts.
+    pollfd idle{ socketFd, static_cast<short>(abandoned > 0 ? POLLRDHUP : POLLIN | POLLRDHUP), 0 };
+    return ::poll(&idle, 1, 0) == 0;
+}
+
+std::unexpected<ErrorInfo> NetworkResource::fail(const std::string& what) {
+    ErrorInfo error{ ErrorCode::ConnectionErrorDuringQuery, what + " " + address + ": " + std::strerror(errno) };
+    closeSocket();
+    return std::unexpected(std::move(error));
+}
+
+// Waits in short slices so a stop request is noticed as well as the deadline
+std::expected<void, ErrorInfo> NetworkResource::waitFor(short events, const QueryDeadline& deadline) {
+    while (!deadline.expired()) {
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline.expiresAt - QueryDeadline::Clock::now());
+        pollfd ready{ socketFd, events, 0 };
+        int result = ::poll(&ready, 1, static_cast<int>(std::min<int64_t>(remaining.count(), 10)));
+        syscallCount.fetch_add(1, std::memory_order_relaxed);
+        if (result > 0 || (result < 0 && errno != EINTR)) {
+            return {};
+        }
+    }
+    closeSocket();
+    return std::unexpected(ErrorInfo{ ErrorCode::QueryTimeout, "Deadline exceeded waiting for " + address });
+}
+
+std::expected<std::string, ErrorInfo> NetworkResource::exchange(std::string_view request, const QueryDeadline& deadline) {
+    if (socketFd < 0) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ConnectionErrorDuringQuery, "Connection to " + address + " is closed" });
+    }
+    if (sharedMemory) {
+        return exchangeShared(request, deadline);
+    }
+    if (auto sent = sendRequest(request, deadline); !sent) {
+        return std::unexpected(sent.error());
+    }
+    while (true) {
+        auto response = takeResponse();
+        if (!response) {
+            return std::unexpected(response.error());
+        }
+        if (*response) {
+            return std::move(**response);
+        }
+        if (auto ready = waitFor(POLLIN, deadline); !ready) {
+            return std::unexpected(ready.error());
+        }
+        if (auto received = receiveMore(); !received) {
+            return std::unexpected(received.error());
+        }
+    }
+}
+
+std::expected<void, ErrorInfo> NetworkResource::sendRequest(std::string_view request, const QueryDeadline& deadline) {
+    if (socketFd < 0) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ConnectionErrorDuringQuery, "Connection to " + address + " is closed" });
+    }
+    size_t sent = 0;
+    while (sent < request.size()) {
+        ssize_t written = ::send(socketFd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        syscallCount.fetch_add(1, std::memory_order_relaxed);
+        if (written >= 0) {
+            sent += static_cast<size_t>(written);
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (auto ready = waitFor(POLLOUT, deadline); !ready) {
+                return std::unexpected(ready.error());
+            }
+        }
+        else if (errno != EINTR) {
+            return fail("Failed to send to");
+        }
+    }
+    return {};
+}
+
+std::expected<std::optional<std::string>, ErrorInfo> NetworkResource::pollResponse() {
+    if (socketFd < 0) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ConnectionErrorDuringQuery, "Connection to " + address + " is closed" });
+    }
+    while (true) {
+        auto response = takeResponse();
+        if (!response || *response) {
+            return response;
+        }
+        auto received = receiveMore();
+        if (!received) {
+            return std::unexpected(received.error());
+        }
+        if (!*received) {
+            return std::nullopt;
+        }
+    }
+}
+
+std::expected<void, ErrorInfo> NetworkResource::drainAbandoned(const QueryDeadline& deadline) {
+    while (abandoned > 0) {
+        auto size = responseSize();
+        if (!size) {
+            return std::unexpected(size.error());
+        }
+        if (*size != 0) {
+            pending.erase(0, *size);
+            --abandoned;
+            continue;
+        }
+        if (auto ready = waitFor(POLLIN, deadline); !ready) {
+            return std::unexpected(ready.error());
+        }
+        if (auto received = receiveMore(); !received) {
+            return std::unexpected(received.error());
+        }
+    }
+    return {};
+}
+
+std::expected<size_t, ErrorInfo> NetworkResource::responseSize() const {
+    if (binary) {
+        return wireFrameSize(pending); // ParseError for a garbled length; the caller discards the connection
+    }
+    size_t newline = pending.find('\n');
+    return newline == std::string::npos ? 0 : newline + 1;
+}
+
+std::expected<bool, ErrorInfo> NetworkResource::receiveMore() {
+    char buffer[4096];
+    ssize_t received = ::recv(socketFd, buffer, sizeof(buffer), 0);
+    syscallCount.fetch_add(1, std::memory_order_relaxed);
+    if (received > 0) {
+        pending.append(buffer, static_cast<size_t>(received));
+        return true;
+    }
+    if (received == 0) {
+        errno = ECONNRESET;
+        return fail("Connection closed by");
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        return fail("Failed to receive from");
+    }
+    return false;
+}
+
+std::expected<std::optional<std::string>, ErrorInfo> NetworkResource::takeResponse() {
+    while (true) {
+        auto size = responseSize();
+        if (!size) {
+            return std::unexpected(size.error());
+        }
+        if (*size == 0) {
+            return std::nullopt;
+        }
+        if (abandoned == 0) {
+            std::string response = pending.substr(0, binary ? *size : *size - 1);
+            pending.erase(0, *size);
+            return response;
+        }
+        pending.erase(0, *size);
+        --abandoned;
+    }
+}
+
+std::expected<std::string, ErrorInfo> NetworkResource::exchangeShared(std::string_view request, const QueryDeadline& deadline) {
+    if (request.size() > ShmRing::maxRecord) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ConnectionErrorDuringQuery, "Request of " + std::to_string(request.size()) + " bytes is too large for shared memory" });
+    }
+    // Waits in short slices so a stop request, the deadline and a server that has gone are all noticed;
+    // only a peer that went quiet costs the poll
+    auto nextSlice = [&]() { return std::min(deadline.expiresAt, QueryDeadline::Clock::now() + std::chrono::milliseconds(10)); };
+    auto checkPeer = [&]() -> std::expected<void, ErrorInfo> {
+        if (deadline.expired()) {
+            closeSocket();
+            return std::unexpected(ErrorInfo{ ErrorCode::QueryTimeout, "Deadline exceeded waiting for " + address });
+        }
+        pollfd peer{ socketFd, POLLIN | POLLRDHUP, 0 };
+        if (sharedMemory->responses().isClosed() || ::poll(&peer, 1, 0) != 0) {
+            closeSocket();
+            return std::unexpected(ErrorInfo{ ErrorCode::ConnectionErrorDuringQuery, "Connection closed by " + address });
+        }
+        return {};
+        };
+
+    while (!sharedMemory->requests().write(request, nextSlice())) {
+        if (auto alive = checkPeer(); !alive) {
+            return std::unexpected(alive.error());
+        }
+    }
+    std::optional<std::string_view> response;
+    while (!(response = sharedMemory->responses().read(nextSlice()))) {
+        if (auto alive = checkPeer(); !alive) {
+            return std::unexpected(alive.error());
+        }
+    }
+    std::string line(response->substr(0, response->size() - (response->ends_with('\n') ? 1 : 0)));
+    sharedMemory->responses().pop();
+    return line;
+}
+
+std::expected<void, ErrorInfo> NetworkResource::useSharedMemory(const QueryDeadline& deadline) {
+    auto region = ShmRegion::create();
+    if (!region) {
+        return std::unexpected(region.error());
+    }
+    auto reply = exchange("SHM " + (*region)->name() + "\n", deadline);
+    if (!reply) {
+        return std::unexpected(reply.error());
+    }
+    if (!reply->starts_with("OK ")) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ConnectionFailed, "Server " + address + " refused shared memory: " + *reply });
+    }
+    (*region)->unlink(); // Both sides have it mapped; nothing is left behind if either exits
+    sharedMemory = std::move(*region);
+    return {};
+}
+
+std::expected<void, ErrorInfo> NetworkResource::useBinaryProtocol(const QueryDeadline& deadline) {
+    auto reply = exchange("BINARY\n", deadline);
+    if (!reply) {
+        return std::unexpected(reply.error());
+    }
+    if (!reply->starts_with("OK ")) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ConnectionFailed, "Server " + address + " refused the binary protocol: " + *reply });
+    }
+    binary = true;
+    return {};
+}
+
+// Connects a non-blocking socket to a loopback address within timeoutMs. Failures to reach the server are
+// transient, like the simulated ones, so the retry loop backs off while a kvserver is starting.
+static std::expected<int, ErrorInfo> connectLoopback(const std::string& address, int port, int timeoutMs) {
+    in_addr ip{};
+    std::string host = address == "localhost" ? "127.0.0.1" : address;
+    if (::inet_pton(AF_INET, host.c_str(), &ip) != 1 || (ntohl(ip.s_addr) >> 24) != 127) {
+        return std::unexpected(ErrorInfo{ ErrorCode::PermanentConnectionFailure, "TCP transport only connects to loopback addresses, not " + address });
+    }
+    std::string endpoint = address + ":" + std::to_string(port);
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return std::unexpected(ErrorInfo{ ErrorCode::TransientConnectionFailure, "Failed to create socket for " + endpoint + ": " + std::strerror(errno) });
+    }
+    sockaddr_in target{};
+    target.sin_family = AF_INET;
+    target.sin_port = htons(static_cast<uint16_t>(port));
+    target.sin_addr = ip;
+    int result = ::connect(fd, reinterpret_cast<sockaddr*>(&target), sizeof(target));
+    if (result < 0 && errno == EINPROGRESS) {
+        pollfd connecting{ fd, POLLOUT, 0 };
+        int error = ETIMEDOUT;
+        if (::poll(&connecting, 1, timeoutMs) == 1) {
+            socklen_t length = sizeof(error);
+            ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        }
+        errno = error;
+        result = error == 0 ? 0 : -1;
+    }
+    if (result < 0) {
+        ErrorInfo error{ ErrorCode::TransientConnectionFailure, "Failed to connect to " + endpoint + ": " + std::strerror(errno) };
+        ::close(fd);
+        return std::unexpected(std::move(error));
+    }
+    int noDelay = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return fd;
+}
+
 void ConnectionManager::setSimulatedFailureMode(const std::string& serverType, int failureCount, bool transient) {
     if (serverType == "primary") {
-        primarySim.failureCount = failureCount;
-        primarySim.isTransient = transient;
+        primarySim.failureCount.store(failureCount, std::memory_order_relaxed);
+        primarySim.isTransient.store(transient, std::memory_order_relaxed);
     }
     else if (serverType == "backup") {
-        backupSim.failureCount = failureCount;
+        backupSim.failureCount.store(failureCount, std::memory_order_relaxed);
     }
 }
 
+void ConnectionManager::setSimulatedLatency(const std::string& serverType, std::chrono::microseconds typical, int slowPercent, std::chrono::microseconds slow) {
+    FailureSimConfig* sim = serverType == "primary" ? &primarySim : serverType == "backup" ? &backupSim : nullptr;
+    if (sim) {
+        sim->typicalLatency = typical;
+        sim->slowPercent = slowPercent;
+        sim->slowLatency = slow;
+    }
+}
+
+void ConnectionManager::setSimulatedCapacity(const std::string& serverType, int concurrentRequests) {
+    FailureSimConfig* sim = serverType == "primary" ? &primarySim : serverType == "backup" ? &backupSim : nullptr;
+    if (sim) {
+        std::lock_guard<std::mutex> lock(sim->queueMutex);
+        sim->capacity = std::max(0, concurrentRequests);
+        sim->busyUntil.assign(static_cast<size_t>(sim->capacity), QueryDeadline::Clock::time_point{});
+    }
+}
+
+std::chrono::microseconds ConnectionManager::sampleLatency(const FailureSimConfig& sim) {
+    if (sim.typicalLatency.count() == 0 && sim.slowPercent == 0) {
+        return std::chrono::microseconds(0);
+    }
+    if (sim.slowPercent > 0 && random.uniform(0, 99) < sim.slowPercent) {
+        return sim.slowLatency;
+    }
+    int64_t typical = sim.typicalLatency.count();
+    return std::chrono::microseconds(random.uniform(typical / 2, typical + typical / 2));
+}
+
+QueryDeadline::Clock::time_point ConnectionManager::scheduleResponse(FailureSimConfig& sim) {
+    QueryDeadline::Clock::time_point now = QueryDeadline::Clock::now();
+    std::chrono::microseconds latency = sampleLatency(sim);
+    if (sim.capacity == 0) {
+        return now + latency;
+    }
+    // The request takes the slot that frees up first
+    std::lock_guard<std::mutex> lock(sim.queueMutex);
+    auto slot = std::min_element(sim.busyUntil.begin(), sim.busyUntil.end());
+    *slot = std::max(*slot, now) + latency;
+    return *slot;
+}
+
 std::expected<std::unique_ptr<NetworkResource>, ErrorInfo> ConnectionManager::connectToServer(
     const std::string& address, int port, int attemptNumber, int totalRetries) {
 
     std::string serverTypeForLog = (address == config.primaryServerAddress && port == config.primaryServerPort) ? "primary" : "backup";
     FailureSimConfig& simConfig = (serverTypeForLog == "primary") ? primarySim : backupSim;
 
-    // Simulate network delay
-    std::this_thread::sleep_for(std::chrono::milliseconds(5 + (rand() % 10)));
+    // Simulate network delay; a real connect pays its own
+    if (config.transport == Transport::SIMULATED) {
+        timeSource.sleepFor(std::chrono::milliseconds(random.uniform(5, 14)));
+    }
 
-    if (simConfig.failureCount > totalRetries) {
-		std::string errorType = simConfig.isTransient ? "transient" : "permanent";
+    if (simConfig.failureCount.load(std::memory_order_relaxed) > totalRetries) {
+        bool transient = simConfig.isTransient.load(std::memory_order_relaxed);
+		std::string errorType = transient ? "transient" : "permanent";
         return std::unexpected(ErrorInfo{
-		    simConfig.isTransient ? ErrorCode::TransientConnectionFailure : ErrorCode::PermanentConnectionFailure,
+		    transient ? ErrorCode::TransientConnectionFailure : ErrorCode::PermanentConnectionFailure,
             "Simulated " + errorType + " connection failure to " + serverTypeForLog +
             " server " + address + ":" + std::to_string(port)
             });
     }
 
-    try {
-        auto resource = std::make_unique<NetworkResource>(address + ":" + std::to_string(port));
+    if (config.transport == Transport::TCP || config.transport == Transport::SHARED_MEMORY) {
+        auto socketFd = connectLoopback(address, port, config.connectionTimeoutMs);
+        if (!socketFd) {
+            return std::unexpected(socketFd.error());
+        }
+        auto resource = std::make_unique<NetworkResource>(address + ":" + std::to_string(port), *socketFd);
+        // A server that refuses the shared-memory or binary upgrade will refuse it on every retry too
+        QueryDeadline handshake;
+        handshake.expiresAt = QueryDeadline::Clock::now() + std::chrono::milliseconds(config.connectionTimeoutMs);
+        std::expected<void, ErrorInfo> upgraded;
+        if (config.transport == Transport::SHARED_MEMORY) {
+            upgraded = resource->useSharedMemory(handshake);
+        }
+        if (upgraded && config.wireProtocol == WireProtocol::BINARY) {
+            upgraded = resource->useBinaryProtocol(handshake);
+        }
+        if (!upgraded) {
+            ErrorCode code = upgraded.error().code == ErrorCode::QueryTimeout ? ErrorCode::TransientConnectionFailure : ErrorCode::PermanentConnectionFailure;
+            return std::unexpected(ErrorInfo{ code, upgraded.error().message });
+        }
         return resource;
     }
-    catch (const std::bad_alloc& ba) { // Example of an exception that std::expected doesn't typically handle
-        std::cerr << ("Failed to allocate memory for NetworkResource: " + std::string(ba.what())) << std::endl;
-        throw;
-    }
-    catch (const std::exception& e) { // Catch any other potential exceptions from NetworkResource or unique_ptr construction
-        return std::unexpected(ErrorInfo{
-            ErrorCode::NetworkResourceAcquisitionFailed,
-            "Failed to acquire network resource for " + address + ":" + std::to_string(port) + " - " + e.what() 
-            });
-    }
+
+    // Allocation failure is fatal in this build, as everywhere else in the standard library
+    return std::make_unique<NetworkResource>(address + ":" + std::to_string(port));
 }
 
 std::expected<void, ErrorInfo> ConnectionManager::establishConnection() {
+    if (currentMode == ConnectionMode::BACKUP) {
+        // A racer still running is already retrying the primary
+        if (!adoptRacedPrimary() && !primaryRacer.joinable()) {
+            probePrimary();
+        }
+        return {};
+    }
     if (currentMode != ConnectionMode::DISCONNECTED) {
         return {}; 
     }
 
     // Initial state reset
     currentMode = ConnectionMode::DISCONNECTED;
-    activeConnection.reset();
+    connectionPool.reset();
+    if (config.connectRaceDelayMs > 0 && &timeSource == &TimeSource::real()) {
+        return establishRacing();
+    }
     const int baseDelayMs = 50;
 
     // Lambda to attempt primary connection with retries
     auto attemptPrimary = [&]() -> std::expected<void, ErrorInfo> {
         ErrorInfo lastPrimaryError; // Store the last error from primary attempts
         for (int i = 0; i <= config.connectionRetries; ++i) {
+            if (!primaryBreaker.allowAttempt()) {
+                return std::unexpected(ErrorInfo{ ErrorCode::ConnectionFailed, "PRIMARY circuit breaker is open after " + std::to_string(i) + " attempts." });
+            }
             auto primaryConnectResult = connectToServer(config.primaryServerAddress, config.primaryServerPort, i + 1, config.connectionRetries + 1);
 
             if (primaryConnectResult) {
-                activeConnection = std::move(primaryConnectResult.value());
+                primaryBreaker.recordSuccess();
+                openPool(std::move(primaryConnectResult.value()), config.primaryServerAddress, config.primaryServerPort, config.connectionRetries + 1);
                 currentMode = ConnectionMode::PRIMARY;
+                openBackupPool();
                 return {}; // Successful connection to primary
             }
 
             // Primary connection attempt failed
             lastPrimaryError = primaryConnectResult.error();
+            primaryBreaker.recordFailure();
 
             if (i < config.connectionRetries) { // If more retries are left
+                if (primaryBreaker.state() != BreakerState::CLOSED) {
+                    break; // Known bad now; the rest of the ladder would only delay the failover
+                }
                 if (lastPrimaryError.code == ErrorCode::TransientConnectionFailure) {
                     long long delay = static_cast<long long>(baseDelayMs * std::pow(2, i));
-                    std::random_device rd;
-                    std::mt19937 gen(rd());
                     // Add jitter: +/- 20% of the delay
-                    std::uniform_int_distribution<> distrib(-static_cast<int>(delay / 5), static_cast<int>(delay / 5));
-                    delay += distrib(gen);
+                    delay += random.uniform(-delay / 5, delay / 5);
 
                     if (delay < baseDelayMs) delay = baseDelayMs;
                     const long long maxDelayMs = 1000;
                     if (delay > maxDelayMs) delay = maxDelayMs;
 
-                    std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+                    timeSource.sleepFor(std::chrono::milliseconds(delay));
                 }
                 else {
                     break; // Don't retry non-transient errors, break to try backup
@@ -120,9 +515,10 @@ std::expected<void, ErrorInfo> ConnectionManager::establishConnection() {
     // Lambda to attempt backup connection
     // This is called by or_else, so it receives the error from the previous step (primary)
     auto attemptBackup = [&](const ErrorInfo& primaryError) -> std::expected<void, ErrorInfo> {
+        DiagnosticsSink::shared().report(primaryError.code, "PRIMARY connection failed, trying BACKUP: " + primaryError.fullMessage());
         return connectToServer(config.backupServerAddress, config.backupServerPort, 1, 1)
             .transform([this](std::unique_ptr<NetworkResource> conn) { // Executed on successful backup connection
-                activeConnection = std::move(conn);
+                openPool(std::move(conn), config.backupServerAddress, config.backupServerPort, 1);
                 currentMode = ConnectionMode::BACKUP;
                 // The transform lambda for std::expected<void, E> should return void.
             })
@@ -135,7 +531,7 @@ std::expected<void, ErrorInfo> ConnectionManager::establishConnection() {
     // This is called by or_else if both primary and backup attempts fail.
     auto fallbackToOffline = [&](const ErrorInfo& lastConnectionError) -> std::expected<void, ErrorInfo> {
         currentMode = ConnectionMode::DISCONNECTED;
-        activeConnection.reset(); // Ensure no active connection in offline mode
+        connectionPool.reset(); // Ensure no open connections in offline mode
         return std::unexpected(ErrorInfo{
             ErrorCode::ConnectionFailed,
             "All primary and backup server connection attempts failed. Offline mode. Last error: " + lastConnectionError.message,
@@ -149,8 +545,170 @@ std::expected<void, ErrorInfo> ConnectionManager::establishConnection() {
         .or_else(fallbackToOffline);
 }
 
+void ConnectionManager::disconnect() {
+    primaryRacer = std::jthread();
+    currentMode = ConnectionMode::DISCONNECTED;
+    connectionPool.reset();
+    backupPool.reset();
+}
+
+void ConnectionManager::probePrimary() {
+    // Without a breaker the backup is kept, as before
+    if (!primaryBreaker.enabled() || !primaryBreaker.allowAttempt()) {
+        return;
+    }
+    auto connection = connectToServer(config.primaryServerAddress, config.primaryServerPort, 1, config.connectionRetries + 1);
+    if (!connection) {
+        primaryBreaker.recordFailure();
+        return;
+    }
+    primaryBreaker.recordSuccess();
+    openPool(std::move(*connection), config.primaryServerAddress, config.primaryServerPort, config.connectionRetries + 1);
+    currentMode = ConnectionMode::PRIMARY;
+    openBackupPool();
+}
+
+std::expected<void, ErrorInfo> ConnectionManager::establishRacing() {
+    primaryRacer = std::jthread(); // Stops a racer left from an earlier connect
+    {
+        std::lock_guard<std::mutex> lock(raceState.mutex);
+        raceState.connection.reset();
+        raceState.failures = 0;
+        raceState.permanent = false;
+        raceState.lastError = ErrorInfo{};
+    }
+    primaryRacer = std::jthread([this](std::stop_token stop) { racePrimary(stop); });
+
+    // The primary's head start ends early if its first attempt fails
+    {
+        std::unique_lock<std::mutex> lock(raceState.mutex);
+        raceState.changed.wait_for(lock, std::chrono::milliseconds(config.connectRaceDelayMs),
+            [this]() { return raceState.connection || raceState.failures > 0; });
+    }
+    if (adoptRacedPrimary()) {
+        return {};
+    }
+
+    // The primary may still make it within its retry ladder if this fails
+    auto backup = connectToServer(config.backupServerAddress, config.backupServerPort, 1, 1);
+    // A primary that connected while the backup was being tried got there first
+    if (adoptRacedPrimary()) {
+        return {};
+    }
+    if (backup) {
+        ErrorInfo reason;
+        {
+            std::lock_guard<std::mutex> lock(raceState.mutex);
+            reason = raceState.failures > 0
+                ? raceState.lastError
+                : ErrorInfo{ ErrorCode::TransientConnectionFailure, "No connection after " + std::to_string(config.connectRaceDelayMs) + "ms" };
+        }
+        DiagnosticsSink::shared().report(reason.code, "PRIMARY not connected, using BACKUP while retrying it in the background: " + reason.fullMessage());
+        openPool(std::move(*backup), config.backupServerAddress, config.backupServerPort, 1);
+        currentMode = ConnectionMode::BACKUP;
+        return {};
+    }
+
+    // Only the primary is left; it gets as many attempts as the retry ladder would have
+    ErrorInfo primaryError;
+    {
+        std::unique_lock<std::mutex> lock(raceState.mutex);
+        raceState.changed.wait(lock, [this]() {
+            return raceState.connection || raceState.permanent || raceState.failures > config.connectionRetries
+                || primaryBreaker.state() == BreakerState::OPEN;
+            });
+        primaryError = raceState.lastError;
+    }
+    if (adoptRacedPrimary()) {
+        return {};
+    }
+    primaryRacer = std::jthread();
+    currentMode = ConnectionMode::DISCONNECTED;
+    connectionPool.reset();
+    return std::unexpected(ErrorInfo{
+        ErrorCode::ConnectionFailed,
+        "All primary and backup server connection attempts failed. Offline mode. Last error: " + primaryError.message,
+        primaryError.lineNumber
+        });
+}
+
+void ConnectionManager::racePrimary(std::stop_token stop) {
+    const int baseDelayMs = 50;
+    for (int attempt = 0; !stop.stop_requested(); ++attempt) {
+        if (primaryBreaker.allowAttempt()) {
+            auto connection = connectToServer(config.primaryServerAddress, config.primaryServerPort, attempt + 1, config.connectionRetries + 1);
+            if (connection) {
+                primaryBreaker.recordSuccess();
+                {
+                    std::lock_guard<std::mutex> lock(raceState.mutex);
+                    raceState.connection = std::move(*connection);
+                }
+                raceState.changed.notify_all();
+                return;
+            }
+            primaryBreaker.recordFailure();
+            {
+                std::lock_guard<std::mutex> lock(raceState.mutex);
+                ++raceState.failures;
+                raceState.permanent = connection.error().code != ErrorCode::TransientConnectionFailure;
+                raceState.lastError = connection.error();
+            }
+            raceState.changed.notify_all();
+        }
+
+        // Backs off like the retry ladder, but keeps going: once the backup has won, this is the way back
+        long long delay = std::min<long long>(1000, baseDelayMs * (1LL << std::min(attempt, 5)));
+        delay += random.uniform(-delay / 5, delay / 5);
+        std::unique_lock<std::mutex> lock(raceState.mutex);
+        raceState.changed.wait_for(lock, stop, std::chrono::milliseconds(delay), []() { return false; });
+    }
+}
+
+bool ConnectionManager::adoptRacedPrimary() {
+    std::unique_ptr<NetworkResource> connection;
+    {
+        std::lock_guard<std::mutex> lock(raceState.mutex);
+        connection = std::move(raceState.connection);
+    }
+    if (!connection) {
+        return false;
+    }
+    primaryRacer = std::jthread(); // It has returned after connecting
+    openPool(std::move(connection), config.primaryServerAddress, config.primaryServerPort, config.connectionRetries + 1);
+    currentMode = ConnectionMode::PRIMARY;
+    openBackupPool();
+    return true;
+}
+
+void ConnectionManager::openPool(std::unique_ptr<NetworkResource> first, const std::string& address, int port, int totalRetries) {
+    backupPool.reset();
+    connectionPool = makePool(std::move(first), address, port, totalRetries);
+}
+
+void ConnectionManager::openBackupPool() {
+    if (config.hedgePercentile == 0 && config.readBalancing == ReadBalancing::PRIMARY_ONLY) {
+        return;
+    }
+    auto connection = connectToServer(config.backupServerAddress, config.backupServerPort, 1, 1);
+    if (!connection) {
+        DiagnosticsSink::shared().report(connection.error().code, "BACKUP unreachable, GETs go to the PRIMARY only: " + connection.error().fullMessage());
+        return;
+    }
+    backupPool = makePool(std::move(*connection), config.backupServerAddress, config.backupServerPort, 1);
+}
+
+std::unique_ptr<ConnectionPool<NetworkResource>> ConnectionManager::makePool(std::unique_ptr<NetworkResource> first, const std::string& address, int port, int totalRetries) {
+    size_t poolSize = config.poolSize > 0 ? static_cast<size_t>(config.poolSize) : std::max(1u, std::thread::hardware_concurrency());
+    return std::make_unique<ConnectionPool<NetworkResource>>(
+        poolSize,
+        [this, address, port, totalRetries]() { return connectToServer(address, port, 1, totalRetries); },
+        [](const NetworkResource& connection) { return connection.isValid(); },
+        std::chrono::seconds(1),
+        std::move(first));
+}
+
 bool ConnectionManager::isConnected() const {
-    return (currentMode == ConnectionMode::PRIMARY || currentMode == ConnectionMode::BACKUP) && activeConnection && activeConnection->isValid();
+    return (currentMode == ConnectionMode::PRIMARY || currentMode == ConnectionMode::BACKUP) && connectionPool != nullptr;
 }
 
 ConnectionMode ConnectionManager::getCurrentMode() const {
@@ -158,9 +716,6 @@ ConnectionMode ConnectionManager::getCurrentMode() const {
 }
 
 std::string ConnectionManager::getCurrentServerAddress() const { 
-    if (activeConnection && activeConnection->isValid()) {
-        return activeConnection->getAddress();
-    }
     switch (currentMode) {
     case ConnectionMode::PRIMARY: return config.primaryServerAddress + ":" + std::to_string(config.primaryServerPort);
     case ConnectionMode::BACKUP:  return config.backupServerAddress + ":" + std::to_string(config.backupServerPort);
@@ -169,7 +724,7 @@ std::string ConnectionManager::getCurrentServerAddress() const {
     }
 }
 
-QueryResult ConnectionManager::executeRemoteQuery(const Query& query, int depth) {
+QueryResult ConnectionManager::executeRemoteQuery(const Query& query, int depth, const QueryDeadline& deadline) {
     if (!isConnected()) {
         return QueryResult{
             query.id,
@@ -181,5 +736,444 @@ QueryResult ConnectionManager::executeRemoteQuery(const Query& query, int depth)
         };
     }
 
-    return server.processCommand(query, depth);
+    if (clientCache) {
+        return executeThroughCache(query, depth, deadline);
+    }
+    return sendToServer(query, depth, deadline);
+}
+
+// Time the server gets for a request, so it can stop early too; 0 means no deadline
+static std::chrono::microseconds serverTimeout(const QueryDeadline& deadline) {
+    if (deadline.expiresAt == QueryDeadline::Clock::time_point::max()) {
+        return std::chrono::microseconds(0);
+    }
+    return std::max(std::chrono::microseconds(1), std::chrono::ceil<std::chrono::microseconds>(deadline.expiresAt - QueryDeadline::Clock::now()));
+}
+
+// Sleeps in short slices so a stop request is noticed; false if the deadline comes before readyAt
+static bool sleepUntil(QueryDeadline::Clock::time_point readyAt, const QueryDeadline& deadline) {
+    while (QueryDeadline::Clock::now() < readyAt) {
+        if (deadline.expired()) {
+            return false;
+        }
+        std::this_thread::sleep_until(std::min({ readyAt, deadline.expiresAt, QueryDeadline::Clock::now() + std::chrono::milliseconds(10) }));
+    }
+    return true;
+}
+
+// The request for query in the connection's protocol; valid until the thread's next call
+static std::string_view encodeRequest(const NetworkResource& connection, const Query& query, int depth, const QueryDeadline& deadline) {
+    thread_local std::string frame; // Grows to the largest request once, then is reused
+    std::chrono::microseconds timeout = serverTimeout(deadline);
+    if (!connection.isBinary()) {
+        frame = formatKvRequest(query, depth, timeout);
+        return frame;
+    }
+    frame.resize(wireRequestSize(query, depth, timeout));
+    encodeWireRequest(query, depth, timeout, frame);
+    return frame;
+}
+
+// Returns ParseError if the response is garbled or answers another query
+static std::expected<QueryResult, ErrorInfo> decodeResponse(const NetworkResource& connection, const Query& query, const std::string& response) {
+    if (!connection.isBinary()) {
+        return parseKvResponse(response, query.id);
+    }
+    auto decoded = decodeWireResponse(response);
+    if (!decoded) {
+        return std::unexpected(decoded.error());
+    }
+    if (decoded->queryId != query.id) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ParseError, "Response for query ID " + std::to_string(decoded->queryId) + " received" });
+    }
+    return decoded->toResult();
+}
+
+// The failed result for query, with its id appended to the error
+static QueryResult failedResult(const Query& query, ErrorInfo error) {
+    error.message += " for query ID " + std::to_string(query.id);
+    return QueryResult{ query.id, std::unexpected(std::move(error)), std::chrono::milliseconds(0) };
+}
+
+QueryResult ConnectionManager::sendToServer(const Query& query, int depth, const QueryDeadline& deadline) {
+    if (!backupPool || query.type != Query::Type::GET || currentMode != ConnectionMode::PRIMARY) {
+        return sendOver(*connectionPool, currentMode == ConnectionMode::PRIMARY ? primarySim : backupSim, query, depth, deadline);
+    }
+    if (config.readBalancing == ReadBalancing::PRIMARY_ONLY) {
+        return sendHedged(query, depth, deadline);
+    }
+    auto start = QueryDeadline::Clock::now();
+    ReadTarget target = readBalancer.choose();
+    QueryResult result = target == ReadTarget::PRIMARY
+        ? sendOver(*connectionPool, primarySim, query, depth, deadline)
+        : sendOver(*backupPool, backupSim, query, depth, deadline);
+    readBalancer.finish(target, std::chrono::duration_cast<std::chrono::microseconds>(QueryDeadline::Clock::now() - start));
+    return result;
+}
+
+QueryResult ConnectionManager::sendOver(ConnectionPool<NetworkResource>& pool, FailureSimConfig& sim, const Query& query, int depth, const QueryDeadline& deadline) {
+    auto connection = pool.checkout(deadline);
+    if (!connection) {
+        return failedResult(query, connection.error());
+    }
+    ConnectionPool<NetworkResource>::Lease& lease = *connection;
+    if (!lease->isSocket()) {
+        auto readyAt = scheduleResponse(sim);
+        QueryResult result = server.processCommand(query, depth, deadline);
+        if (!sleepUntil(readyAt, deadline)) {
+            return failedResult(query, ErrorInfo{ ErrorCode::QueryTimeout, "Deadline exceeded waiting for " + lease->getAddress() });
+        }
+        return result;
+    }
+
+    auto response = lease->exchange(encodeRequest(*lease, query, depth, deadline), deadline);
+    auto result = response ? decodeResponse(*lease, query, *response) : std::unexpected(response.error());
+    if (!result) {
+        // ConnectionErrorDuringQuery, QueryTimeout, or ParseError for a garbled response
+        lease.discard();
+        return failedResult(query, result.error());
+    }
+    return std::move(*result);
+}
+
+struct ConnectionManager::HedgeLeg {
+    ConnectionPool<NetworkResource>::Lease connection;
+    std::optional<QueryResult> result;        // Set once the response has been read, or the leg failed
+    bool failed = false;
+    QueryDeadline::Clock::time_point readyAt; // A simulated connection's result only counts from then
+};
+
+std::optional<QueryResult> ConnectionManager::startLeg(HedgeLeg& leg, ConnectionPool<NetworkResource>& pool, bool wait, const Query& query, int depth, const QueryDeadline& deadline) {
+    auto connection = wait ? pool.checkout(deadline) : pool.tryCheckout();
+    if (!connection) {
+        return failedResult(query, connection.error());
+    }
+    if (!*connection) {
+        return failedResult(query, ErrorInfo{ ErrorCode::QueryTimeout, "No pooled connection became free" });
+    }
+    leg.connection = std::move(*connection);
+    if (!leg.connection->isSocket()) {
+        leg.readyAt = scheduleResponse(&pool == backupPool.get() ? backupSim : primarySim);
+        leg.result = server.processCommand(query, depth, deadline);
+        return std::nullopt;
+    }
+    if (auto sent = leg.connection->sendRequest(encodeRequest(*leg.connection, query, depth, deadline), deadline); !sent) {
+        leg.connection.discard();
+        return failedResult(query, sent.error());
+    }
+    return std::nullopt;
+}
+
+ConnectionManager::HedgeLeg* ConnectionManager::awaitLegs(std::span<HedgeLeg> legs, QueryDeadline::Clock::time_point until, const Query& query, const QueryDeadline& deadline) {
+    using Clock = QueryDeadline::Clock;
+    while (true) {
+        Clock::time_point now = Clock::now();
+        // Bounded so a stop request is noticed
+        Clock::time_point wakeAt = std::min({ until, deadline.expiresAt, now + std::chrono::milliseconds(10) });
+        pollfd sockets[2];
+        HedgeLeg* polled[2];
+        nfds_t socketCount = 0;
+        bool waiting = false;
+        for (HedgeLeg& leg : legs) {
+            if (leg.failed) {
+                continue;
+            }
+            if (leg.result) {
+                if (now >= leg.readyAt) {
+                    return &leg;
+                }
+                wakeAt = std::min(wakeAt, leg.readyAt);
+            }
+            else {
+                sockets[socketCount] = pollfd{ leg.connection->nativeSocket(), POLLIN, 0 };
+                polled[socketCount++] = &leg;
+            }
+            waiting = true;
+        }
+        if (!waiting || now >= until || deadline.expired()) {
+            return nullptr;
+        }
+
+        auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(wakeAt - now, Clock::duration::zero()));
+        timespec timeout{ static_cast<time_t>(wait.count() / 1000000000), static_cast<long>(wait.count() % 1000000000) };
+        if (::ppoll(sockets, socketCount, &timeout, nullptr) <= 0) {
+            continue;
+        }
+        for (nfds_t i = 0; i < socketCount; ++i) {
+            if (sockets[i].revents == 0) {
+                continue;
+            }
+            HedgeLeg& leg = *polled[i];
+            auto response = leg.connection->pollResponse();
+            if (response && !*response) {
+                continue;
+            }
+            auto result = response ? decodeResponse(*leg.connection, query, **response) : std::unexpected(response.error());
+            if (!result) {
+                leg.connection.discard();
+                leg.failed = true;
+                leg.result = failedResult(query, result.error());
+                continue;
+            }
+            leg.result = std::move(*result);
+        }
+    }
+}
+
+QueryResult ConnectionManager::sendHedged(const Query& query, int depth, const QueryDeadline& deadline) {
+    using Clock = QueryDeadline::Clock;
+    Clock::time_point start = Clock::now();
+    hedgeCounters.eligible.fetch_add(1, std::memory_order_relaxed);
+    hedgeBudget.deposit();
+
+    HedgeLeg legs[2];
+    if (std::optional<QueryResult> failure = startLeg(legs[0], *connectionPool, true, query, depth, deadline)) {
+        return std::move(*failure);
+    }
+    size_t started = 1;
+    HedgeLeg* winner = nullptr;
+    // Until the primary has answered enough GETs there is no percentile to hedge at
+    if (std::optional<std::chrono::microseconds> hedgeDelay = primaryLatency.percentileLatency()) {
+        winner = awaitLegs(std::span(legs, 1), start + *hedgeDelay, query, deadline);
+        if (!winner && !legs[0].failed && !deadline.expired()) {
+            if (!hedgeBudget.tryWithdraw()) {
+                hedgeCounters.budgetDenied.fetch_add(1, std::memory_order_relaxed);
+            }
+            else if (!startLeg(legs[1], *backupPool, false, query, depth, deadline)) {
+                hedgeCounters.hedged.fetch_add(1, std::memory_order_relaxed);
+                started = 2;
+            }
+        }
+    }
+    if (!winner) {
+        winner = awaitLegs(std::span(legs, started), Clock::time_point::max(), query, deadline);
+    }
+
+    // A primary that lost or ran out of time is recorded at the time it was given up on, which keeps the slow tail in the window
+    if (!legs[0].failed) {
+        primaryLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start));
+    }
+    // Gives up on the requests still outstanding. A loser's connection stays pooled and drops the late response;
+    // past the deadline the server may never answer, so the connection is closed as exchange would.
+    for (HedgeLeg& leg : std::span(legs, started)) {
+        if (&leg != winner && leg.connection && !leg.result && leg.connection->isSocket()) {
+            if (winner) {
+                leg.connection->abandonResponse();
+            }
+            else {
+                leg.connection.discard();
+            }
+        }
+    }
+
+    if (winner) {
+        if (winner == &legs[1]) {
+            hedgeCounters.hedgeWins.fetch_add(1, std::memory_order_relaxed);
+        }
+        return std::move(*winner->result);
+    }
+    if (legs[0].failed) {
+        return std::move(*legs[0].result);
+    }
+    return failedResult(query, ErrorInfo{ ErrorCode::QueryTimeout, "No response before the deadline" });
+}
+
+HedgeStats ConnectionManager::getHedgeStats() const {
+    HedgeStats stats;
+    stats.eligible = hedgeCounters.eligible.load(std::memory_order_relaxed);
+    stats.hedged = hedgeCounters.hedged.load(std::memory_order_relaxed);
+    stats.hedgeWins = hedgeCounters.hedgeWins.load(std::memory_order_relaxed);
+    stats.budgetDenied = hedgeCounters.budgetDenied.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::vector<QueryResult> ConnectionManager::executeRemoteBatch(const std::vector<Query>& queries, int depth, const std::vector<QueryDeadline>& deadlines) {
+    std::vector<QueryResult> results(queries.size());
+    if (!isConnected() || clientCache || config.transport != Transport::TCP) {
+        for (size_t i = 0; i < queries.size(); ++i) {
+            results[i] = executeRemoteQuery(queries[i], depth, deadlines[i]);
+        }
+        return results;
+    }
+    if (queries.empty()) {
+        return results;
+    }
+    auto fail = [&](size_t i, ErrorCode code, std::string message) {
+        results[i] = QueryResult{ queries[i].id, std::unexpected(ErrorInfo{ code, std::move(message) }), std::chrono::milliseconds(0) };
+        };
+
+    // The exchange runs until the latest deadline; each request carries its own to the server
+    QueryDeadline batchDeadline = deadlines.front();
+    for (const QueryDeadline& deadline : deadlines) {
+        batchDeadline.expiresAt = std::max(batchDeadline.expiresAt, deadline.expiresAt);
+    }
+
+    // Wait for one connection, then take whichever others are free right now
+    auto first = connectionPool->checkout(batchDeadline);
+    if (!first) {
+        for (size_t i = 0; i < queries.size(); ++i) {
+            fail(i, first.error().code, first.error().message + " for query ID " + std::to_string(queries[i].id));
+        }
+        return results;
+    }
+    std::vector<ConnectionPool<NetworkResource>::Lease> connections;
+    connections.push_back(std::move(*first));
+    size_t wanted = std::min(connectionPool->capacity(), queries.size());
+    while (connections.size() < wanted) {
+        auto more = connectionPool->tryCheckout();
+        if (!more || !*more) {
+            break; // A connection that fails to open only narrows the batch
+        }
+        connections.push_back(std::move(*more));
+    }
+    // The batch transport reads the sockets itself, so responses abandoned by a hedge are dropped first
+    ErrorInfo drainError;
+    for (auto it = connections.begin(); it != connections.end();) {
+        if (auto drained = (*it)->drainAbandoned(batchDeadline); !drained) {
+            drainError = drained.error();
+            it->discard();
+            it = connections.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    if (connections.empty()) {
+        for (size_t i = 0; i < queries.size(); ++i) {
+            fail(i, drainError.code, drainError.message + " for query ID " + std::to_string(queries[i].id));
+        }
+        return results;
+    }
+
+    std::vector<BatchChannel> channels(connections.size());
+    std::vector<std::vector<size_t>> assigned(connections.size()); // Query indexes in the order sent
+    for (size_t c = 0; c < connections.size(); ++c) {
+        channels[c].fd = connections[c]->nativeSocket();
+        channels[c].framed = connections[c]->isBinary();
+        channels[c].received = std::move(connections[c]->receiveBuffer());
+    }
+    for (size_t i = 0; i < queries.size(); ++i) {
+        size_t c = i % channels.size();
+        std::chrono::microseconds timeout = serverTimeout(deadlines[i]);
+        if (channels[c].framed) {
+            std::string& requests = channels[c].requests;
+            size_t offset = requests.size();
+            requests.resize(offset + wireRequestSize(queries[i], depth, timeout));
+            encodeWireRequest(queries[i], depth, timeout, std::span<char>(requests).subspan(offset));
+        }
+        else {
+            channels[c].requests += formatKvRequest(queries[i], depth, timeout);
+        }
+        ++channels[c].expectedResponses;
+        assigned[c].push_back(i);
+    }
+    {
+        std::lock_guard<std::mutex> lock(batchMutex);
+        if (!batchTransport) {
+            batchTransport = std::make_unique<BatchTransport>(ioBackend);
+        }
+        batchTransport->exchange(channels, batchDeadline);
+    }
+
+    for (size_t c = 0; c < channels.size(); ++c) {
+        BatchChannel& channel = channels[c];
+        std::string address = connections[c]->getAddress();
+        std::vector<bool> answered(assigned[c].size(), false);
+        if (channel.framed) {
+            // Each frame names the query it answers: the earliest unanswered one with that id
+            size_t firstOpen = 0;
+            for (const std::string& frame : channel.responses) {
+                auto response = decodeWireResponse(frame);
+                if (!response) {
+                    channel.error = response.error().message;
+                    break;
+                }
+                size_t k = firstOpen;
+                while (k < assigned[c].size() && (answered[k] || queries[assigned[c][k]].id != response->queryId)) {
+                    ++k;
+                }
+                if (k == assigned[c].size()) {
+                    channel.error = "Response for query ID " + std::to_string(response->queryId) + " matches no request";
+                    break;
+                }
+                results[assigned[c][k]] = response->toResult();
+                answered[k] = true;
+                while (firstOpen < answered.size() && answered[firstOpen]) {
+                    ++firstOpen;
+                }
+            }
+        }
+        else {
+            for (size_t k = 0; k < assigned[c].size() && k < channel.responses.size(); ++k) {
+                size_t i = assigned[c][k];
+                if (auto parsed = parseKvResponse(channel.responses[k], queries[i].id)) {
+                    results[i] = std::move(*parsed);
+                }
+                else {
+                    channel.error = parsed.error().message;
+                    fail(i, parsed.error().code, parsed.error().message + " for query ID " + std::to_string(queries[i].id));
+                }
+                answered[k] = true;
+            }
+        }
+        for (size_t k = 0; k < assigned[c].size(); ++k) {
+            size_t i = assigned[c][k];
+            std::string forQuery = " for query ID " + std::to_string(queries[i].id);
+            if (answered[k]) {
+                continue;
+            }
+            if (channel.timedOut) {
+                fail(i, ErrorCode::QueryTimeout, "Deadline exceeded waiting for " + address + forQuery);
+            }
+            else {
+                fail(i, ErrorCode::ConnectionErrorDuringQuery, channel.error + " (" + address + ")" + forQuery);
+            }
+        }
+        // A connection with responses still on the way would answer the next request with them
+        if (channel.complete() && channel.error.empty()) {
+            connections[c]->receiveBuffer() = std::move(channel.received);
+        }
+        else {
+            connections[c].discard();
+        }
+    }
+    return results;
+}
+
+void ConnectionManager::setIoBackend(IoBackend backend) {
+    std::lock_guard<std::mutex> lock(batchMutex);
+    ioBackend = backend;
+    batchTransport.reset();
+}
+
+BatchTransportStats ConnectionManager::getBatchTransportStats() const {
+    std::lock_guard<std::mutex> lock(batchMutex);
+    return batchTransport ? batchTransport->getStats() : BatchTransportStats{};
+}
+
+QueryResult ConnectionManager::executeThroughCache(const Query& query, int depth, const QueryDeadline& deadline) {
+    if (query.type == Query::Type::GET) {
+        if (auto cached = clientCache->lookup(query.key)) {
+            return QueryResult{ query.id, std::move(*cached), std::chrono::milliseconds(0) };
+        }
+        QueryResult result = sendToServer(query, depth, deadline);
+        if (result.result) {
+            clientCache->fill(query.key, *result.result, result.keyVersion);
+        }
+        return result;
+    }
+
+    QueryResult result = sendToServer(query, depth, deadline);
+    if (result.result) {
+        clientCache->invalidate(query.key, result.keyVersion);
+    }
+    return result;
+}
+
+ConnectionPoolStats ConnectionManager::getConnectionPoolStats() const {
+    return connectionPool ? connectionPool->getStats() : ConnectionPoolStats{};
+}
+
+ClientCacheStats ConnectionManager::getClientCacheStats() const {
+    return clientCache ? clientCache->getStats() : ClientCacheStats{};
 }
\ No newline at end of file
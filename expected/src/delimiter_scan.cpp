@@ -0,0 +1,137 @@
+#include "delimiter_scan.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DELIMITER_SCAN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(DELIMITER_SCAN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define DELIMITER_SCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DELIMITER_SCAN_TARGET_AVX2
+#endif
+
+static DelimiterMasks classifyScalar(const char* block) {
+    DelimiterMasks masks;
+    for (unsigned i = 0; i < 64; ++i) {
+        unsigned char c = static_cast<unsigned char>(block[i]);
+        if (c == '\n') {
+            masks.newline |= uint64_t(1) << i;
+        }
+        // '\t' through '\r' are whitespace like ' '
+        else if (c == ',' || c == '=' || c == ' ' || static_cast<unsigned char>(c - '\t') < 5) {
+            masks.field |= uint64_t(1) << i;
+        }
+    }
+    return masks;
+}
+
+#ifdef DELIMITER_SCAN_X86
+
+static DelimiterMasks classifySse2(const char* block) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i equals = _mm_set1_epi8('=');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i controlSpan = _mm_set1_epi8(4); // '\t' + 4 == '\r'
+
+    DelimiterMasks masks;
+    for (unsigned chunk = 0; chunk < 4; ++chunk) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + chunk * 16));
+        __m128i isNewline = _mm_cmpeq_epi8(bytes, newline);
+        // Unsigned (c - '\t') <= 4, i.e. c in ['\t', '\r']
+        __m128i offset = _mm_sub_epi8(bytes, tab);
+        __m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(offset, controlSpan), offset);
+        __m128i isField = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, comma), _mm_cmpeq_epi8(bytes, equals)),
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, space), _mm_andnot_si128(isNewline, isControl)));
+        masks.newline |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(isNewline))) << (chunk * 16);
+        masks.field |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(isField))) << (chunk * 16);
+    }
+    return masks;
+}
+
+DELIMITER_SCAN_TARGET_AVX2 static DelimiterMasks classifyAvx2(const char* block) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i equals = _mm256_set1_epi8('=');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i controlSpan = _mm256_set1_epi8(4);
+
+    DelimiterMasks masks;
+    for (unsigned chunk = 0; chunk < 2; ++chunk) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + chunk * 32));
+        __m256i isNewline = _mm256_cmpeq_epi8(bytes, newline);
+        __m256i offset = _mm256_sub_epi8(bytes, tab);
+        __m256i isControl = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, controlSpan), offset);
+        __m256i isField = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, comma), _mm256_cmpeq_epi8(bytes, equals)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, space), _mm256_andnot_si256(isNewline, isControl)));
+        masks.newline |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(isNewline))) << (chunk * 32);
+        masks.field |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(isField))) << (chunk * 32);
+    }
+    return masks;
+}
+
+#endif // DELIMITER_SCAN_X86
+
+ScanBackend detectScanBackend() {
+    static const ScanBackend detected = []() {
+#if defined(DELIMITER_SCAN_X86) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        bool sse2 = (info[3] & (1 << 26)) != 0;
+        // AVX2 also needs the OS to save the YMM registers (OSXSAVE + XCR0)
+        bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+        bool avx2 = false;
+        if (osAvx && maxLeaf >= 7) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+        return avx2 ? ScanBackend::AVX2 : sse2 ? ScanBackend::SSE2 : ScanBackend::SCALAR;
+#elif defined(DELIMITER_SCAN_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return ScanBackend::AVX2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return ScanBackend::SSE2;
+        }
+        return ScanBackend::SCALAR;
+#else
+        return ScanBackend::SCALAR;
+#endif
+    }();
+    return detected;
+}
+
+const char* scanBackendName(ScanBackend backend) {
+    switch (backend) {
+    case ScanBackend::SCALAR: return "scalar";
+    case ScanBackend::SSE2: return "sse2";
+    case ScanBackend::AVX2: return "avx2";
+    default: return "unknown";
+    }
+}
+
+DelimiterScanner::DelimiterScanner(ScanBackend backend) : selected(ScanBackend::SCALAR), classifyBlock(classifyScalar) {
+#ifdef DELIMITER_SCAN_X86
+    // Never select a backend the CPU cannot run, whatever was requested
+    ScanBackend supported = detectScanBackend();
+    if (backend == ScanBackend::AVX2 && supported == ScanBackend::AVX2) {
+        selected = ScanBackend::AVX2;
+        classifyBlock = classifyAvx2;
+    }
+    else if (backend != ScanBackend::SCALAR && supported != ScanBackend::SCALAR) {
+        selected = ScanBackend::SSE2;
+        classifyBlock = classifySse2;
+    }
+#else
+    (void)backend;
+#endif
+}
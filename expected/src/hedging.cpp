@@ -0,0 +1,48 @@
+#include "hedging.hpp"
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+void LatencyTracker::record(std::chrono::microseconds latency) {
+    uint64_t index = recordCount.fetch_add(1, std::memory_order_relaxed);
+    int64_t micros = std::clamp<int64_t>(latency.count(), 0, std::numeric_limits<uint32_t>::max());
+    samples[index % windowSize].store(static_cast<uint32_t>(micros), std::memory_order_relaxed);
+    if ((index + 1) % refreshInterval == 0) {
+        refresh(static_cast<size_t>(std::min<uint64_t>(index + 1, windowSize)));
+    }
+}
+
+void LatencyTracker::refresh(size_t recorded) {
+    std::vector<uint32_t> window(recorded);
+    for (size_t i = 0; i < recorded; ++i) {
+        window[i] = samples[i].load(std::memory_order_relaxed);
+    }
+    size_t rank = std::min(recorded - 1, recorded * static_cast<size_t>(percentile) / 100);
+    std::nth_element(window.begin(), window.begin() + rank, window.end());
+    cachedPercentile.store(window[rank], std::memory_order_relaxed);
+}
+
+std::optional<std::chrono::microseconds> LatencyTracker::percentileLatency() const {
+    int64_t micros = cachedPercentile.load(std::memory_order_relaxed);
+    if (micros < 0) {
+        return std::nullopt;
+    }
+    return std::chrono::microseconds(micros);
+}
+
+void HedgeBudget::deposit() {
+    int64_t current = hundredths.load(std::memory_order_relaxed);
+    while (current < maxBurst * 100
+        && !hundredths.compare_exchange_weak(current, std::min(current + budgetPercent, maxBurst * 100), std::memory_order_relaxed)) {
+    }
+}
+
+bool HedgeBudget::tryWithdraw() {
+    int64_t current = hundredths.load(std::memory_order_relaxed);
+    while (current >= 100) {
+        if (hundredths.compare_exchange_weak(current, current - 100, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
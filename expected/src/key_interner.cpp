@@ -0,0 +1,63 @@
+#include "key_interner.hpp"
+
+KeyInterner& KeyInterner::shared() {
+    static KeyInterner interner;
+    return interner;
+}
+
+KeyInterner::KeyInterner() : chunks(new std::atomic<std::string*>[maxChunks]) {
+    for (size_t i = 0; i < maxChunks; ++i) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+KeyInterner::~KeyInterner() {
+    for (size_t i = 0; i < maxChunks; ++i) {
+        delete[] chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+std::string* KeyInterner::slotFor(uint32_t id) {
+    size_t chunkIndex = id >> chunkBits;
+    std::string* chunk = chunks[chunkIndex].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+        std::lock_guard<std::mutex> lock(chunkMutex);
+        chunk = chunks[chunkIndex].load(std::memory_order_relaxed);
+        if (chunk == nullptr) {
+            chunk = new std::string[chunkSize];
+            chunks[chunkIndex].store(chunk, std::memory_order_release);
+        }
+    }
+    return &chunk[id & (chunkSize - 1)];
+}
+
+uint32_t KeyInterner::intern(std::string_view key) {
+    Shard& shard = shards[std::hash<std::string_view>{}(key) % shardCount];
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        if (auto it = shard.ids.find(key); it != shard.ids.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (auto it = shard.ids.find(key); it != shard.ids.end()) {
+        return it->second;
+    }
+    uint32_t id = nextId.fetch_add(1, std::memory_order_acq_rel);
+    std::string* slot = slotFor(id);
+    slot->assign(key);
+    shard.ids.emplace(std::string_view(*slot), id);
+    return id;
+}
+
+uint32_t KeyInterner::find(std::string_view key) const {
+    const Shard& shard = shards[std::hash<std::string_view>{}(key) % shardCount];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.ids.find(key);
+    return it != shard.ids.end() ? it->second : noId;
+}
+
+std::string_view KeyInterner::name(uint32_t id) const {
+    return chunks[id >> chunkBits].load(std::memory_order_acquire)[id & (chunkSize - 1)];
+}
@@ -0,0 +1,86 @@
+#include "kv_protocol.hpp"
+#include <algorithm>
+#include <charconv>
+
+// Splits off the next space-separated field of line
+static std::string_view nextField(std::string_view& line) {
+    size_t space = line.find(' ');
+    std::string_view field = line.substr(0, space);
+    line = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+    return field;
+}
+
+template <typename Int>
+static bool parseField(std::string_view field, Int& value) {
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return error == std::errc() && end == field.data() + field.size();
+}
+
+static void appendSingleLine(std::string& out, std::string_view text) {
+    for (char c : text) {
+        out.push_back(c == '\n' || c == '\r' ? ' ' : c);
+    }
+}
+
+std::string formatKvRequest(const Query& query, int depth, std::chrono::microseconds timeout) {
+    std::string line = std::to_string(depth) + ' ' + std::to_string(timeout.count()) + ' ' + std::to_string(query.id) + ',';
+    switch (query.type) {
+    case Query::Type::GET: line += "GET "; break;
+    case Query::Type::SET: line += "SET "; break;
+    case Query::Type::DELETE: line += "DELETE "; break;
+    }
+    line += query.key;
+    if (query.type == Query::Type::SET) {
+        line += '=';
+        line += query.value.value_or("");
+    }
+    line += '\n';
+    return line;
+}
+
+std::expected<KvRequest, ErrorInfo> parseKvRequest(std::string_view line) {
+    KvRequest request;
+    int64_t timeoutUs = 0;
+    if (!parseField(nextField(line), request.depth) || request.depth < 0
+        || !parseField(nextField(line), timeoutUs) || timeoutUs < 0) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ParseError, "Malformed request header" });
+    }
+    if (request.depth > maxKvRequestDepth) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ParseError,
+            "Request depth " + std::to_string(request.depth) + " exceeds the limit of " + std::to_string(maxKvRequestDepth) });
+    }
+    request.timeout = std::min(std::chrono::microseconds(timeoutUs), maxKvRequestTimeout);
+    request.queryLine = line;
+    return request;
+}
+
+std::string formatKvResponse(const QueryResult& result) {
+    std::string line;
+    if (result.result) {
+        line = "OK " + std::to_string(result.keyVersion) + ' ';
+        appendSingleLine(line, *result.result);
+    }
+    else {
+        line = "ERR " + std::to_string(static_cast<int>(result.result.error().code)) + ' ';
+        appendSingleLine(line, result.result.error().message);
+    }
+    line += '\n';
+    return line;
+}
+
+std::expected<QueryResult, ErrorInfo> parseKvResponse(std::string_view line, int queryId) {
+    std::string_view status = nextField(line);
+    uint64_t number = 0;
+    if (!parseField(nextField(line), number)) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ParseError, "Malformed response for query ID " + std::to_string(queryId) });
+    }
+    if (status == "OK") {
+        QueryResult result{ queryId, std::string(line), std::chrono::milliseconds(0) };
+        result.keyVersion = number;
+        return result;
+    }
+    if (status == "ERR" && number <= static_cast<uint64_t>(ErrorCode::UnknownError)) {
+        return QueryResult{ queryId, std::unexpected(ErrorInfo{ static_cast<ErrorCode>(number), std::string(line) }), std::chrono::milliseconds(0) };
+    }
+    return std::unexpected(ErrorInfo{ ErrorCode::ParseError, "Unknown response status for query ID " + std::to_string(queryId) });
+}
@@ -0,0 +1,56 @@
+// Runs a Server behind the loopback TCP and shared-memory transports until SIGINT or SIGTERM.
+// Usage: kvserver [port]    (port 0, the default, picks a free one)
+// Prints "kvserver listening on 127.0.0.1:<port>" once it accepts connections.
+#include "kv_server.hpp"
+#include "server.hpp"
+#include "error.hpp"
+
+#include <charconv>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static KvServer* runningServer = nullptr;
+
+static void handleStopSignal(int) {
+    if (runningServer != nullptr) {
+        runningServer->stop();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2) {
+        std::cerr << "Usage: kvserver [port]" << std::endl;
+        return 2;
+    }
+    int port = 0;
+    if (argc == 2) {
+        const char* end = argv[1] + std::strlen(argv[1]);
+        auto parsed = std::from_chars(argv[1], end, port);
+        if (parsed.ec != std::errc() || parsed.ptr != end || port < 0 || port > 65535) {
+            std::cerr << "FATAL [kvserver]: Invalid port " << argv[1] << std::endl;
+            return 2;
+        }
+    }
+
+    Server server;
+    auto kvServer = KvServer::open(server, static_cast<uint16_t>(port));
+    if (!kvServer) {
+        std::cerr << "FATAL [kvserver]: " << kvServer.error().fullMessage() << std::endl;
+        return 1;
+    }
+    runningServer = kvServer->get();
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+
+    std::cout << "kvserver listening on 127.0.0.1:" << (*kvServer)->port() << std::endl;
+    auto stopped = (*kvServer)->run();
+    runningServer = nullptr;
+    if (!stopped) {
+        std::cerr << "FATAL [kvserver]: " << stopped.error().fullMessage() << std::endl;
+        return 1;
+    }
+    std::cout << "kvserver served " << (*kvServer)->requestsServed() << " requests" << std::endl;
+    return 0;
+}
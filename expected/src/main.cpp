@@ -2,14 +2,68 @@
 #include "config.hpp"
 #include "connection.hpp"
 #include "query.hpp"
+#include "query_binary.hpp"
+#include "key_interner.hpp"
+#include "diagnostics.hpp"
+#include "query_index.hpp"
+#include "kv_protocol.hpp"
+#include "kv_wire.hpp"
 #include "server.hpp"
 #include "benchmark/benchmark.h"
+#include <zlib.h>
 
 #include <iostream>
 #include <vector>
 #include <string>
 #include <memory> 
 #include <expected>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <cstddef>
+#include <cstdio>
+#include <array>
+#include <optional>
+#include <csignal>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Counts every global heap allocation so the benchmarks can report allocations per executed query.
+// Each block carries its size in a header so liveBytes tracks the bytes currently allocated.
+static std::atomic<size_t> allocationCount{ 0 };
+static std::atomic<int64_t> liveBytes{ 0 };
+static constexpr std::size_t allocationHeader = alignof(std::max_align_t);
+
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* block = std::malloc(size + allocationHeader)) {
+        *static_cast<std::size_t*>(block) = size;
+        liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+        return static_cast<char*>(block) + allocationHeader;
+    }
+    // This variant is built without exceptions, so allocation failure is fatal as it is inside the standard library
+    std::abort();
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    void* block = static_cast<char*>(ptr) - allocationHeader;
+    liveBytes.fetch_sub(static_cast<int64_t>(*static_cast<std::size_t*>(block)), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    operator delete(ptr);
+}
 
 enum class ConnectionSuccess {
     SUCCESS,
@@ -17,7 +71,22 @@ enum class ConnectionSuccess {
     PRIMARY_PERMANENT_FAILURE,
 };
 
-void program(benchmark::State& state, std::string configFilePath, std::string queryFilePath, int queryExecuteCount, int depth = 0, ConnectionSuccess connectionSuccess = ConnectionSuccess::SUCCESS, int failureCount = 0) {
+// Builds a query directly, matching what parseQueriesFromFile produces for the equivalent line.
+Query makeQuery(int id, Query::Type type, const std::string& key, std::optional<std::string> value = std::nullopt) {
+    Query query;
+    query.id = id;
+    query.type = type;
+    query.key = key;
+    query.value = std::move(value);
+    switch (type) {
+    case Query::Type::GET: query.rawCommand = "GET " + key; break;
+    case Query::Type::SET: query.rawCommand = "SET " + key + "=" + query.value.value_or(""); break;
+    case Query::Type::DELETE: query.rawCommand = "DELETE " + key; break;
+    }
+    return query;
+}
+
+void program(benchmark::State& state, std::string configFilePath, std::string queryFilePath, int queryExecuteCount, int depth = 0, ConnectionSuccess connectionSuccess = ConnectionSuccess::SUCCESS, int failureCount = 0, ExecutionMode executionMode = ExecutionMode::ASYNC_FUTURES, bool coalesceGets = false) {
     auto configExpected = ConfigLoader::loadConfig(configFilePath);
     if (!configExpected) {
         ErrorInfo err = configExpected.error();
@@ -34,9 +103,15 @@ void program(benchmark::State& state, std::string configFilePath, std::string qu
         std::cerr << "FATAL [Main]: Connection Error - " << err.fullMessage() << std::endl;
         return;
 	}
-    QueryEngine queryEngine = QueryEngine(connectionManager);
+    QueryEngine queryEngine = QueryEngine(connectionManager, executionMode);
+    queryEngine.setGetCoalescing(coalesceGets);
 
-    std::vector<Query> baseQueries = queryEngine.parseQueriesFromFile(queryFilePath);
+    auto parsedQueries = queryEngine.parseQueriesFromFile(queryFilePath);
+    if (!parsedQueries) {
+        std::cerr << "FATAL [Main]: Query File Error - " << parsedQueries.error().fullMessage() << std::endl;
+        return;
+    }
+    std::vector<Query> baseQueries = std::move(*parsedQueries);
     std::vector<Query> queriesToRun;
     for (int i = 0; i < queryExecuteCount; ++i) {
         for (const auto& query : baseQueries) {
@@ -51,6 +126,7 @@ void program(benchmark::State& state, std::string configFilePath, std::string qu
         connectionManager.setSimulatedFailureMode("primary", failureCount, false); // Simulate permanent failure
     }
 
+    size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
     for (auto _ : state) {
         if (connectionManager.isConnected()) {
             std::vector<QueryResult> results = queryEngine.executeQueries(queriesToRun, depth);
@@ -59,6 +135,1408 @@ void program(benchmark::State& state, std::string configFilePath, std::string qu
             }*/
         }
     }
+    size_t allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+    if (state.iterations() > 0 && !queriesToRun.empty()) {
+        state.counters["allocs_per_query"] = static_cast<double>(allocations) / (static_cast<double>(state.iterations()) * queriesToRun.size());
+    }
+    uint64_t getsSent = queryEngine.getExecutedGetCount();
+    uint64_t getsCoalesced = queryEngine.getCoalescedGetCount();
+    if (getsSent + getsCoalesced > 0) {
+        state.counters["coalesced_ratio"] = static_cast<double>(getsCoalesced) / static_cast<double>(getsSent + getsCoalesced);
+    }
+}
+
+// Reconnects during a simulated transient outage of the primary. Each iteration of the outage is one failover to
+// the backup: the full retry ladder with breakerWindow 0, or a short-circuit once the breaker has opened. With
+// measureRecovery the primary comes back at the start of each iteration, which ends when the breaker's probe has
+// moved the client back to it; reconnects are attempted every 10ms meanwhile.
+void failover(benchmark::State& state, std::string configFilePath, int breakerWindow, bool measureRecovery) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    appConfig.connectionRetries = 3;
+    appConfig.breakerWindow = breakerWindow;
+    appConfig.breakerCooldownMs = 100;
+    Server server;
+    ConnectionManager connectionManager(appConfig, server);
+
+    ConnectionManager::setSimulatedFailureMode("primary", 1000, true);
+    // Opens the breaker, if there is one
+    if (auto connected = connectionManager.establishConnection(); !connected) {
+        ConnectionManager::setSimulatedFailureMode("primary", 0);
+        state.SkipWithError(connected.error().fullMessage().c_str());
+        return;
+    }
+    for (auto _ : state) {
+        if (measureRecovery) {
+            ConnectionManager::setSimulatedFailureMode("primary", 0);
+            while (connectionManager.getCurrentMode() != ConnectionMode::PRIMARY) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                benchmark::DoNotOptimize(connectionManager.establishConnection());
+            }
+            state.PauseTiming();
+            ConnectionManager::setSimulatedFailureMode("primary", 1000, true);
+            connectionManager.disconnect();
+            benchmark::DoNotOptimize(connectionManager.establishConnection());
+            state.ResumeTiming();
+        }
+        else {
+            connectionManager.disconnect();
+            benchmark::DoNotOptimize(connectionManager.establishConnection());
+        }
+    }
+    ConnectionManager::setSimulatedFailureMode("primary", 0);
+
+    CircuitBreakerStats stats = connectionManager.getPrimaryBreakerStats();
+    state.counters["trips"] = static_cast<double>(stats.trips);
+    state.counters["probes"] = static_cast<double>(stats.probes);
+    state.counters["short_circuits"] = static_cast<double>(stats.rejected);
+    state.SetLabel(connectionManager.getCurrentServerAddress());
+}
+
+// Time from a cold establishConnection to the first query's result under each ConnectionSuccess scenario, with
+// the primary tried serially through its retry ladder first or raced against the backup after raceDelayMs. A failing
+// primary fails every attempt. With racing, also reports how long after the primary comes back the client is on
+// it again, calling establishConnection every 10ms.
+void timeToFirstQuery(benchmark::State& state, std::string configFilePath, ConnectionSuccess connectionSuccess, int raceDelayMs) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    appConfig.connectRaceDelayMs = raceDelayMs;
+    Server server;
+    Query first = makeQuery(0, Query::Type::SET, "user:0", "value");
+
+    if (connectionSuccess != ConnectionSuccess::SUCCESS) {
+        ConnectionManager::setSimulatedFailureMode("primary", 1000, connectionSuccess == ConnectionSuccess::PRIMARY_TRANSIENT_FAILURE);
+    }
+    std::unique_ptr<ConnectionManager> connectionManager;
+    size_t failed = 0;
+    for (auto _ : state) {
+        connectionManager = std::make_unique<ConnectionManager>(appConfig, server);
+        benchmark::DoNotOptimize(connectionManager->establishConnection()); // A failure shows as a failed first query
+        QueryResult result = connectionManager->executeRemoteQuery(first, 0);
+        failed += result.result ? 0 : 1;
+        state.PauseTiming();
+        state.SetLabel(connectionManager->getCurrentServerAddress());
+        connectionManager.reset(); // Stops a racer still retrying the primary
+        state.ResumeTiming();
+    }
+
+    if (connectionSuccess != ConnectionSuccess::SUCCESS && raceDelayMs > 0) {
+        connectionManager = std::make_unique<ConnectionManager>(appConfig, server);
+        benchmark::DoNotOptimize(connectionManager->establishConnection());
+        ConnectionManager::setSimulatedFailureMode("primary", 0);
+        auto recovered = std::chrono::steady_clock::now();
+        while (connectionManager->getCurrentMode() != ConnectionMode::PRIMARY) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            benchmark::DoNotOptimize(connectionManager->establishConnection());
+        }
+        state.counters["upgrade_ms"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recovered).count();
+    }
+    ConnectionManager::setSimulatedFailureMode("primary", 0);
+    state.counters["failed_first_queries"] = static_cast<double>(failed);
+}
+
+// Hours of a flapping primary replayed on VirtualTime, one client after another: the primary is down for the
+// first outageMinutes of every hour, failing each connect transiently, and takes the connections of the clients on
+// it down with it. Each client starts within the first minute and calls establishConnection every 10 seconds of
+// virtual time; retry ladders, breaker cooldowns and probes all run in virtual time. Client i is seeded with
+// seed + i, so every iteration must replay the same timeline, which a fingerprint of the clients' mode changes checks.
+void virtualTimeFailover(benchmark::State& state, std::string configFilePath, int clients, int hours, int outageMinutes, int breakerWindow, uint64_t seed) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    appConfig.connectionRetries = 3;
+    appConfig.breakerWindow = breakerWindow;
+    appConfig.breakerCooldownMs = 30000;
+    Server server;
+    using Clock = TimeSource::Clock;
+    const Clock::time_point end = Clock::time_point{} + std::chrono::hours(hours);
+    const std::chrono::seconds step(10);
+
+    std::optional<uint64_t> firstFingerprint;
+    std::array<Clock::duration, 3> timeIn{}; // Indexed by ConnectionMode
+    uint64_t failovers = 0;
+    uint64_t recoveries = 0;
+    Clock::duration recoveryTime{};
+    uint64_t events = 0;
+    for (auto _ : state) {
+        uint64_t fingerprint = 14695981039346656037ull; // FNV-1a
+        timeIn = {};
+        failovers = recoveries = events = 0;
+        recoveryTime = {};
+        for (int client = 0; client < clients; ++client) {
+            VirtualTime time;
+            time.sleepFor(std::chrono::milliseconds(RandomSource(seed + static_cast<uint64_t>(client)).uniform(0, 59999)));
+            ConnectionManager connectionManager(appConfig, server, time, seed + static_cast<uint64_t>(client));
+            ConnectionMode mode = ConnectionMode::DISCONNECTED;
+            Clock::time_point modeSince = time.now();
+            Clock::time_point outageEnded = time.now();
+            std::optional<bool> primaryDown;
+            while (time.now() < end) {
+                bool down = time.now().time_since_epoch() % std::chrono::hours(1) < std::chrono::minutes(outageMinutes);
+                if (down != primaryDown) {
+                    primaryDown = down;
+                    ConnectionManager::setSimulatedFailureMode("primary", down ? 1000 : 0, true);
+                    if (down && connectionManager.getCurrentMode() == ConnectionMode::PRIMARY) {
+                        connectionManager.disconnect();
+                    }
+                    if (!down) {
+                        outageEnded = Clock::time_point{} + std::chrono::floor<std::chrono::hours>(time.now().time_since_epoch()) + std::chrono::minutes(outageMinutes);
+                    }
+                }
+                benchmark::DoNotOptimize(connectionManager.establishConnection()); // Being offline shows in offline_pct
+
+                ConnectionMode now = connectionManager.getCurrentMode();
+                if (now != mode) {
+                    timeIn[static_cast<size_t>(mode)] += time.now() - modeSince;
+                    failovers += now == ConnectionMode::BACKUP ? 1 : 0;
+                    if (now == ConnectionMode::PRIMARY && mode == ConnectionMode::BACKUP) {
+                        ++recoveries;
+                        recoveryTime += time.now() - outageEnded;
+                    }
+                    for (int64_t word : { int64_t(client), time.now().time_since_epoch().count(), int64_t(now) }) {
+                        fingerprint = (fingerprint ^ static_cast<uint64_t>(word)) * 1099511628211ull;
+                    }
+                    mode = now;
+                    modeSince = time.now();
+                }
+                time.sleepFor(step);
+            }
+            timeIn[static_cast<size_t>(mode)] += time.now() - modeSince;
+            events += time.events();
+        }
+        if (!firstFingerprint) {
+            firstFingerprint = fingerprint;
+        }
+        else if (fingerprint != *firstFingerprint) {
+            state.SkipWithError("Same seed, different timeline");
+            break;
+        }
+    }
+    ConnectionManager::setSimulatedFailureMode("primary", 0);
+
+    Clock::duration total = timeIn[0] + timeIn[1] + timeIn[2];
+    auto percentIn = [&](ConnectionMode mode) { return 100.0 * static_cast<double>(timeIn[static_cast<size_t>(mode)].count()) / static_cast<double>(std::max<Clock::rep>(1, total.count())); };
+    state.counters["virtual_hours"] = benchmark::Counter(static_cast<double>(clients) * hours * static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    state.counters["events"] = static_cast<double>(events);
+    state.counters["failovers"] = static_cast<double>(failovers);
+    state.counters["backup_pct"] = percentIn(ConnectionMode::BACKUP);
+    state.counters["offline_pct"] = percentIn(ConnectionMode::DISCONNECTED);
+    if (recoveries > 0) {
+        state.counters["recovery_s"] = std::chrono::duration<double>(recoveryTime).count() / static_cast<double>(recoveries);
+    }
+    char label[32];
+    std::snprintf(label, sizeof(label), "fingerprint %016llx", static_cast<unsigned long long>(firstFingerprint.value_or(0)));
+    state.SetLabel(label);
+}
+
+// Hot-key read/write mix through a caching client while a second, uncached client writes behind its back.
+void clientCache(benchmark::State& state, std::string configFilePath, int cacheCapacity, int validationPercent, int externalWritePercent) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    appConfig.clientCacheCapacity = cacheCapacity;
+    appConfig.clientCacheValidationPercent = validationPercent;
+    AppConfig writerConfig = appConfig;
+    writerConfig.clientCacheCapacity = 0;
+    Server server;
+
+    ConnectionManager reader(appConfig, server);
+    ConnectionManager writer(writerConfig, server);
+    if (auto connected = reader.establishConnection(); !connected) {
+        std::cerr << "FATAL [Main]: Connection Error - " << connected.error().fullMessage() << std::endl;
+        return;
+    }
+    if (auto connected = writer.establishConnection(); !connected) {
+        std::cerr << "FATAL [Main]: Connection Error - " << connected.error().fullMessage() << std::endl;
+        return;
+    }
+    QueryEngine readerEngine(reader, ExecutionMode::PREALLOCATED_SLOTS);
+    QueryEngine writerEngine(writer, ExecutionMode::PREALLOCATED_SLOTS);
+
+    const int keyCount = 64;
+    std::vector<Query> seed;
+    std::vector<Query> workload;
+    std::vector<Query> externalWrites;
+    for (int k = 0; k < keyCount; ++k) {
+        seed.push_back(makeQuery(k, Query::Type::SET, "user:" + std::to_string(k), "v0"));
+    }
+    // 90% GETs over the hot keys; every 10th query is a SET issued through the caching client itself
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = "user:" + std::to_string(i % keyCount);
+        workload.push_back(i % 10 == 9
+            ? makeQuery(i, Query::Type::SET, key, "v" + std::to_string(i))
+            : makeQuery(i, Query::Type::GET, key));
+    }
+    for (int k = 0; k < keyCount * externalWritePercent / 100; ++k) {
+        externalWrites.push_back(makeQuery(k, Query::Type::SET, "user:" + std::to_string(k * 3 % keyCount), "external"));
+    }
+
+    readerEngine.executeQueries(seed, 0);
+    for (auto _ : state) {
+        if (!externalWrites.empty()) {
+            writerEngine.executeQueries(externalWrites, 0);
+        }
+        benchmark::DoNotOptimize(readerEngine.executeQueries(workload, 0));
+    }
+
+    ClientCacheStats stats = reader.getClientCacheStats();
+    if (stats.hits + stats.misses > 0) {
+        state.counters["hit_rate"] = static_cast<double>(stats.hits) / static_cast<double>(stats.hits + stats.misses);
+    }
+    if (stats.validations > 0) {
+        state.counters["stale_rate"] = static_cast<double>(stats.staleHits) / static_cast<double>(stats.validations);
+    }
+}
+
+// A kvserver process started from the app's directory on a free loopback port and stopped with SIGTERM.
+class KvServerProcess {
+public:
+    static std::expected<std::unique_ptr<KvServerProcess>, ErrorInfo> start() {
+        std::error_code ec;
+        std::string binary = (std::filesystem::read_symlink("/proc/self/exe", ec).parent_path() / "kvserver").string();
+        int output[2];
+        if (ec || ::pipe(output) < 0) {
+            return std::unexpected(ErrorInfo{ ErrorCode::FileOpenFailed, "Failed to prepare to start kvserver" });
+        }
+        std::unique_ptr<KvServerProcess> process(new KvServerProcess());
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, output[1], STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&actions, output[0]);
+        posix_spawn_file_actions_addclose(&actions, output[1]);
+        char* argv[] = { binary.data(), nullptr };
+        int spawnError = posix_spawn(&process->pid, binary.c_str(), &actions, nullptr, argv, environ);
+        posix_spawn_file_actions_destroy(&actions);
+        ::close(output[1]);
+        process->outputFd = output[0];
+        if (spawnError != 0) {
+            process->pid = 0;
+            ::close(process->outputFd);
+            return std::unexpected(ErrorInfo{ ErrorCode::FileOpenFailed, "Failed to start " + binary });
+        }
+
+        // Its first line names the port: "kvserver listening on 127.0.0.1:<port>"
+        std::string line;
+        char c;
+        while (::read(process->outputFd, &c, 1) == 1 && c != '\n') {
+            line.push_back(c);
+        }
+        size_t colon = line.rfind(':');
+        process->serverPort = colon == std::string::npos ? 0 : std::atoi(line.c_str() + colon + 1);
+        if (process->serverPort == 0) {
+            return std::unexpected(ErrorInfo{ ErrorCode::ConnectionFailed, "kvserver did not report a port: '" + line + "'" });
+        }
+        return process;
+    }
+    ~KvServerProcess() { stop(); }
+
+    KvServerProcess(const KvServerProcess&) = delete;
+    KvServerProcess& operator=(const KvServerProcess&) = delete;
+
+    int port() const { return serverPort; }
+
+    void stop() {
+        if (pid > 0) {
+            ::kill(pid, SIGTERM);
+            ::waitpid(pid, nullptr, 0);
+            ::close(outputFd);
+            pid = 0;
+        }
+    }
+
+private:
+    KvServerProcess() = default;
+
+    pid_t pid = 0;
+    int outputFd = -1;
+    int serverPort = 0;
+};
+
+// Replays a query file over the simulated transport, or over loopback TCP or shared memory to kvserver
+// processes for the primary and backup of the config. With primaryDown the primary's process has exited, so the client fails over.
+void loopbackTransport(benchmark::State& state, std::string configFilePath, std::string queryFilePath, int queryExecuteCount, Transport transport, bool primaryDown = false) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    appConfig.transport = transport;
+    std::unique_ptr<KvServerProcess> primary;
+    std::unique_ptr<KvServerProcess> backup;
+    if (transport != Transport::SIMULATED) {
+        auto startedPrimary = KvServerProcess::start();
+        auto startedBackup = KvServerProcess::start();
+        if (!startedPrimary || !startedBackup) {
+            std::cerr << "FATAL [Main]: kvserver Error - " << (!startedPrimary ? startedPrimary.error() : startedBackup.error()).fullMessage() << std::endl;
+            return;
+        }
+        primary = std::move(*startedPrimary);
+        backup = std::move(*startedBackup);
+        appConfig.primaryServerAddress = "127.0.0.1";
+        appConfig.primaryServerPort = primary->port();
+        appConfig.backupServerAddress = "127.0.0.1";
+        appConfig.backupServerPort = backup->port();
+        if (primaryDown) {
+            primary->stop();
+        }
+    }
+    Server server;
+    ConnectionManager connectionManager(appConfig, server);
+    if (auto connected = connectionManager.establishConnection(); !connected) {
+        state.SkipWithError(connected.error().fullMessage().c_str());
+        return;
+    }
+    QueryEngine queryEngine(connectionManager, ExecutionMode::PREALLOCATED_SLOTS);
+
+    auto parsedQueries = queryEngine.parseQueriesFromFile(queryFilePath);
+    if (!parsedQueries) {
+        std::cerr << "FATAL [Main]: Query File Error - " << parsedQueries.error().fullMessage() << std::endl;
+        return;
+    }
+    std::vector<Query> queriesToRun;
+    for (int i = 0; i < queryExecuteCount; ++i) {
+        queriesToRun.insert(queriesToRun.end(), parsedQueries->begin(), parsedQueries->end());
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(queryEngine.executeQueries(queriesToRun, 0));
+    }
+    state.SetItemsProcessed(state.iterations() * queriesToRun.size());
+    state.SetLabel(connectionManager.getCurrentServerAddress());
+}
+
+// One query at a time from a single thread, so each iteration is one full round trip: a call into the
+// in-process Server for the simulated transport, or a request to a kvserver process over TCP or shared memory.
+void transportLatency(benchmark::State& state, std::string configFilePath, std::string queryFilePath, Transport transport) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    appConfig.transport = transport;
+    appConfig.poolSize = 1;
+    std::unique_ptr<KvServerProcess> kvServer;
+    if (transport != Transport::SIMULATED) {
+        auto started = KvServerProcess::start();
+        if (!started) {
+            std::cerr << "FATAL [Main]: kvserver Error - " << started.error().fullMessage() << std::endl;
+            return;
+        }
+        kvServer = std::move(*started);
+        appConfig.primaryServerAddress = "127.0.0.1";
+        appConfig.primaryServerPort = kvServer->port();
+    }
+    Server server;
+    ConnectionManager connectionManager(appConfig, server);
+    if (auto connected = connectionManager.establishConnection(); !connected) {
+        state.SkipWithError(connected.error().fullMessage().c_str());
+        return;
+    }
+    QueryEngine queryEngine(connectionManager);
+    auto queries = queryEngine.parseQueriesFromFile(queryFilePath);
+    if (!queries) {
+        std::cerr << "FATAL [Main]: Query File Error - " << queries.error().fullMessage() << std::endl;
+        return;
+    }
+
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(connectionManager.executeRemoteQuery((*queries)[next], 0));
+        next = next + 1 == queries->size() ? 0 : next + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// GETs one at a time. Over the simulated transport both servers usually answer in about 200us but 2% of
+// requests take 5ms; over TCP, to a kvserver process each, the variance is whatever loopback has. Reports the
+// latency percentiles, and the share of GETs that were hedged as the extra work.
+void hedging(benchmark::State& state, std::string configFilePath, Transport transport, int hedgePercentile, int hedgeBudgetPercent) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    appConfig.transport = transport;
+    appConfig.hedgePercentile = hedgePercentile;
+    appConfig.hedgeBudgetPercent = hedgeBudgetPercent;
+    std::unique_ptr<KvServerProcess> primary;
+    std::unique_ptr<KvServerProcess> backup;
+    if (transport == Transport::TCP) {
+        auto startedPrimary = KvServerProcess::start();
+        auto startedBackup = KvServerProcess::start();
+        if (!startedPrimary || !startedBackup) {
+            std::cerr << "FATAL [Main]: kvserver Error - " << (!startedPrimary ? startedPrimary.error() : startedBackup.error()).fullMessage() << std::endl;
+            return;
+        }
+        primary = std::move(*startedPrimary);
+        backup = std::move(*startedBackup);
+        appConfig.primaryServerAddress = "127.0.0.1";
+        appConfig.primaryServerPort = primary->port();
+        appConfig.backupServerAddress = "127.0.0.1";
+        appConfig.backupServerPort = backup->port();
+    }
+    Server server;
+    ConnectionManager connectionManager(appConfig, server);
+    if (auto connected = connectionManager.establishConnection(); !connected) {
+        state.SkipWithError(connected.error().fullMessage().c_str());
+        return;
+    }
+
+    // The servers are separate processes over TCP that do not replicate, which is why a config file cannot turn
+    // hedging on with transport = tcp. Seeding the backup with the same keys and only reading stands in for a
+    // replicated backup.
+    AppConfig seederConfig = appConfig;
+    seederConfig.primaryServerPort = appConfig.backupServerPort;
+    seederConfig.hedgePercentile = 0;
+    Server seederServer;
+    std::unique_ptr<ConnectionManager> seeder;
+    if (transport == Transport::TCP) {
+        seeder = std::make_unique<ConnectionManager>(seederConfig, seederServer);
+        if (auto connected = seeder->establishConnection(); !connected) {
+            state.SkipWithError(connected.error().fullMessage().c_str());
+            return;
+        }
+    }
+
+    std::vector<Query> gets;
+    for (int i = 0; i < 256; ++i) {
+        Query set = makeQuery(i, Query::Type::SET, "key:" + std::to_string(i), "value");
+        connectionManager.executeRemoteQuery(set, 0);
+        if (seeder) {
+            seeder->executeRemoteQuery(set, 0);
+        }
+        gets.push_back(makeQuery(i, Query::Type::GET, "key:" + std::to_string(i)));
+    }
+    for (const char* serverType : { "primary", "backup" }) {
+        ConnectionManager::setSimulatedLatency(serverType, std::chrono::microseconds(200), 2, std::chrono::milliseconds(5));
+    }
+    for (const Query& get : gets) {
+        benchmark::DoNotOptimize(connectionManager.executeRemoteQuery(get, 0)); // Fills the latency window
+    }
+    HedgeStats warmup = connectionManager.getHedgeStats();
+
+    std::vector<double> latenciesUs;
+    for (auto _ : state) {
+        for (const Query& get : gets) {
+            auto start = std::chrono::steady_clock::now();
+            benchmark::DoNotOptimize(connectionManager.executeRemoteQuery(get, 0));
+            latenciesUs.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+    for (const char* serverType : { "primary", "backup" }) {
+        ConnectionManager::setSimulatedLatency(serverType, std::chrono::microseconds(0));
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(latenciesUs.size()));
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    state.counters["p50_us"] = latenciesUs[latenciesUs.size() / 2];
+    state.counters["p99_us"] = latenciesUs[latenciesUs.size() * 99 / 100];
+    state.counters["p999_us"] = latenciesUs[latenciesUs.size() * 999 / 1000];
+    HedgeStats stats = connectionManager.getHedgeStats();
+    state.counters["hedged_percent"] = 100.0 * static_cast<double>(stats.hedged - warmup.hedged) / static_cast<double>(latenciesUs.size());
+    state.counters["hedge_wins"] = static_cast<double>(stats.hedgeWins - warmup.hedgeWins);
+}
+
+// Worker threads sending GETs, and writePercent SETs, to simulated servers that each work on one request at a
+// time, so the servers are the bottleneck: the primary takes 200us per request and the backup backupLatencyUs.
+// Reports the share of reads the backup served alongside throughput.
+void readBalancing(benchmark::State& state, std::string configFilePath, ReadBalancing readBalancing, int backupLatencyUs, int writePercent) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    appConfig.readBalancing = readBalancing;
+    const int workerCount = 8;
+    appConfig.poolSize = workerCount;
+    Server server;
+    ConnectionManager connectionManager(appConfig, server);
+    if (auto connected = connectionManager.establishConnection(); !connected) {
+        state.SkipWithError(connected.error().fullMessage().c_str());
+        return;
+    }
+
+    const int keyCount = 64;
+    const int queriesPerWorker = 250;
+    std::vector<Query> queries;
+    for (int k = 0; k < keyCount; ++k) {
+        connectionManager.executeRemoteQuery(makeQuery(k, Query::Type::SET, "user:" + std::to_string(k), "value"), 0);
+    }
+    for (int i = 0; i < queriesPerWorker; ++i) {
+        std::string key = "user:" + std::to_string(i % keyCount);
+        queries.push_back(i % 100 < writePercent ? makeQuery(i, Query::Type::SET, key, "value") : makeQuery(i, Query::Type::GET, key));
+    }
+    ConnectionManager::setSimulatedLatency("primary", std::chrono::microseconds(200));
+    ConnectionManager::setSimulatedLatency("backup", std::chrono::microseconds(backupLatencyUs));
+    for (const char* serverType : { "primary", "backup" }) {
+        ConnectionManager::setSimulatedCapacity(serverType, 1);
+    }
+
+    auto runWorkers = [&]() {
+        std::vector<std::thread> workers;
+        for (int w = 0; w < workerCount; ++w) {
+            workers.emplace_back([&]() {
+                for (const Query& query : queries) {
+                    benchmark::DoNotOptimize(connectionManager.executeRemoteQuery(query, 0));
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    };
+    runWorkers(); // Opens the connections and fills the latency averages outside the timed loop
+    ReadBalancerStats before = connectionManager.getReadBalancerStats();
+
+    for (auto _ : state) {
+        runWorkers();
+    }
+    for (const char* serverType : { "primary", "backup" }) {
+        ConnectionManager::setSimulatedLatency(serverType, std::chrono::microseconds(0));
+        ConnectionManager::setSimulatedCapacity(serverType, 0);
+    }
+
+    ReadBalancerStats stats = connectionManager.getReadBalancerStats();
+    uint64_t reads = (stats.primaryReads - before.primaryReads) + (stats.backupReads - before.backupReads);
+    state.SetItemsProcessed(state.iterations() * workerCount * queriesPerWorker);
+    state.counters["backup_read_percent"] = reads > 0 ? 100.0 * static_cast<double>(stats.backupReads - before.backupReads) / static_cast<double>(reads) : 0.0;
+}
+
+// How a batch of GETs reaches kvserver: one blocking round trip per query from the worker pool, or the whole
+// batch pipelined across the pooled connections by the epoll or io_uring batch transport.
+enum class BatchPath {
+    PER_QUERY,
+    EPOLL,
+    IO_URING,
+};
+
+// Reports the system calls each query costs on its path alongside throughput.
+void batchTransport(benchmark::State& state, std::string configFilePath, int batchSize, int poolSize, BatchPath path) {
+    if (path == BatchPath::IO_URING && detectIoBackend() != IoBackend::IO_URING) {
+        state.SkipWithError("io_uring is unavailable");
+        return;
+    }
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    auto kvServer = KvServerProcess::start();
+    if (!kvServer) {
+        std::cerr << "FATAL [Main]: kvserver Error - " << kvServer.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    appConfig.transport = Transport::TCP;
+    appConfig.poolSize = poolSize;
+    appConfig.primaryServerAddress = appConfig.backupServerAddress = "127.0.0.1";
+    appConfig.primaryServerPort = appConfig.backupServerPort = (*kvServer)->port();
+    Server server;
+    ConnectionManager connectionManager(appConfig, server);
+    if (auto connected = connectionManager.establishConnection(); !connected) {
+        state.SkipWithError(connected.error().fullMessage().c_str());
+        return;
+    }
+    connectionManager.setIoBackend(path == BatchPath::IO_URING ? IoBackend::IO_URING : IoBackend::EPOLL);
+    QueryEngine queryEngine(connectionManager, path == BatchPath::PER_QUERY ? ExecutionMode::PREALLOCATED_SLOTS : ExecutionMode::PIPELINED_BATCH);
+
+    const int keyCount = 64;
+    std::vector<Query> queries;
+    for (int k = 0; k < keyCount; ++k) {
+        connectionManager.executeRemoteQuery(makeQuery(k, Query::Type::SET, "user:" + std::to_string(k), "value"), 0);
+    }
+    for (int i = 0; i < batchSize; ++i) {
+        queries.push_back(makeQuery(i, Query::Type::GET, "user:" + std::to_string(i % keyCount)));
+    }
+    benchmark::DoNotOptimize(queryEngine.executeQueries(queries, 0)); // Opens the connections outside the timed loop
+
+    auto syscalls = [&]() {
+        return path == BatchPath::PER_QUERY ? NetworkResource::exchangeSyscalls() : connectionManager.getBatchTransportStats().syscalls;
+        };
+    uint64_t before = syscalls();
+    size_t failed = 0;
+    for (auto _ : state) {
+        std::vector<QueryResult> results = queryEngine.executeQueries(queries, 0);
+        failed += std::count_if(results.begin(), results.end(), [](const QueryResult& result) { return !result.result; });
+    }
+    double executed = static_cast<double>(state.iterations()) * batchSize;
+    state.SetItemsProcessed(state.iterations() * batchSize);
+    state.counters["syscalls_per_query"] = static_cast<double>(syscalls() - before) / executed;
+    state.counters["failure_rate"] = static_cast<double>(failed) / executed;
+    state.SetLabel(path == BatchPath::PER_QUERY ? "per-query" : ioBackendName(path == BatchPath::IO_URING ? IoBackend::IO_URING : IoBackend::EPOLL));
+}
+
+enum class WireCodecStep {
+    ENCODE_REQUEST,
+    DECODE_REQUEST,
+    ENCODE_RESPONSE,
+    DECODE_RESPONSE,
+};
+
+// Nanoseconds per message for one step of the line protocol or the binary framing. Decoding a text request
+// includes parsing its query line, which is the work the binary framing saves the server.
+void wireCodec(benchmark::State& state, WireProtocol protocol, WireCodecStep step) {
+    const int messageCount = 64;
+    const std::chrono::microseconds timeout(5000);
+    std::vector<Query> queries;
+    std::vector<QueryResult> results;
+    for (int i = 0; i < messageCount; ++i) {
+        std::string key = "user:" + std::to_string(i);
+        queries.push_back(i % 4 == 0 ? makeQuery(i, Query::Type::SET, key, "value" + std::to_string(i)) : makeQuery(i, Query::Type::GET, key));
+        if (i % 8 != 0) {
+            results.push_back(QueryResult{ i, "value" + std::to_string(i), std::chrono::milliseconds(0) });
+        }
+        else {
+            results.push_back(QueryResult{ i, std::unexpected(ErrorInfo{ ErrorCode::QueryExecutionError, "Key not found for GET: '" + key + "'" }), std::chrono::milliseconds(0) });
+        }
+        results.back().keyVersion = static_cast<uint64_t>(i);
+    }
+    // Encoded forms, for the decode steps
+    std::vector<std::string> requests;
+    std::vector<std::string> responses;
+    for (int i = 0; i < messageCount; ++i) {
+        if (protocol == WireProtocol::TEXT) {
+            std::string request = formatKvRequest(queries[i], 0, timeout);
+            std::string response = formatKvResponse(results[i]);
+            requests.push_back(request.substr(0, request.size() - 1));
+            responses.push_back(response.substr(0, response.size() - 1));
+        }
+        else {
+            requests.emplace_back(wireRequestSize(queries[i], 0, timeout), '\0');
+            encodeWireRequest(queries[i], 0, timeout, requests.back());
+            responses.emplace_back(wireResponseSize(results[i]), '\0');
+            encodeWireResponse(results[i], responses.back());
+        }
+    }
+    std::vector<char> buffer(4096);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        switch (step) {
+        case WireCodecStep::ENCODE_REQUEST:
+            if (protocol == WireProtocol::TEXT) {
+                benchmark::DoNotOptimize(formatKvRequest(queries[i], 0, timeout));
+            }
+            else {
+                benchmark::DoNotOptimize(encodeWireRequest(queries[i], 0, timeout, buffer));
+            }
+            break;
+        case WireCodecStep::DECODE_REQUEST:
+            if (protocol == WireProtocol::TEXT) {
+                auto request = parseKvRequest(requests[i]);
+                benchmark::DoNotOptimize(QueryEngine::parseQueryLine(request->queryLine, 0));
+            }
+            else {
+                benchmark::DoNotOptimize(decodeWireRequest(requests[i]));
+            }
+            break;
+        case WireCodecStep::ENCODE_RESPONSE:
+            if (protocol == WireProtocol::TEXT) {
+                benchmark::DoNotOptimize(formatKvResponse(results[i]));
+            }
+            else {
+                benchmark::DoNotOptimize(encodeWireResponse(results[i], buffer));
+            }
+            break;
+        case WireCodecStep::DECODE_RESPONSE:
+            if (protocol == WireProtocol::TEXT) {
+                benchmark::DoNotOptimize(parseKvResponse(responses[i], static_cast<int>(i)));
+            }
+            else {
+                benchmark::DoNotOptimize(decodeWireResponse(responses[i]));
+            }
+            break;
+        }
+        i = i + 1 == queries.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Throughput of one connection to kvserver with depth requests in flight: the GETs go out in batches of depth,
+// each pipelined on the connection and completed before the next is sent.
+void wirePipeline(benchmark::State& state, std::string configFilePath, WireProtocol protocol, int depth) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    auto kvServer = KvServerProcess::start();
+    if (!kvServer) {
+        std::cerr << "FATAL [Main]: kvserver Error - " << kvServer.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    appConfig.transport = Transport::TCP;
+    appConfig.wireProtocol = protocol;
+    appConfig.poolSize = 1;
+    appConfig.primaryServerAddress = appConfig.backupServerAddress = "127.0.0.1";
+    appConfig.primaryServerPort = appConfig.backupServerPort = (*kvServer)->port();
+    Server server;
+    ConnectionManager connectionManager(appConfig, server);
+    if (auto connected = connectionManager.establishConnection(); !connected) {
+        state.SkipWithError(connected.error().fullMessage().c_str());
+        return;
+    }
+    QueryEngine queryEngine(connectionManager, ExecutionMode::PIPELINED_BATCH);
+
+    const int keyCount = 64;
+    const int queryCount = 4096;
+    for (int k = 0; k < keyCount; ++k) {
+        connectionManager.executeRemoteQuery(makeQuery(k, Query::Type::SET, "user:" + std::to_string(k), "value"), 0);
+    }
+    std::vector<std::vector<Query>> batches(queryCount / depth);
+    for (int i = 0; i < queryCount; ++i) {
+        batches[i / depth].push_back(makeQuery(i, Query::Type::GET, "user:" + std::to_string(i % keyCount)));
+    }
+
+    uint64_t before = connectionManager.getBatchTransportStats().syscalls;
+    size_t failed = 0;
+    for (auto _ : state) {
+        for (const std::vector<Query>& batch : batches) {
+            std::vector<QueryResult> results = queryEngine.executeQueries(batch, 0);
+            failed += std::count_if(results.begin(), results.end(), [](const QueryResult& result) { return !result.result; });
+        }
+    }
+    double executed = static_cast<double>(state.iterations()) * queryCount;
+    state.SetItemsProcessed(state.iterations() * queryCount);
+    state.counters["syscalls_per_query"] = static_cast<double>(connectionManager.getBatchTransportStats().syscalls - before) / executed;
+    state.counters["failure_rate"] = static_cast<double>(failed) / executed;
+    state.SetLabel(protocol == WireProtocol::BINARY ? "binary" : "text");
+}
+
+// Worker threads sharing one ConnectionManager whose pool holds poolSize connections; depth sets how long each query keeps its connection.
+void connectionPool(benchmark::State& state, std::string configFilePath, int poolSize, int workerCount, int depth) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    appConfig.poolSize = poolSize;
+    Server server;
+    ConnectionManager connectionManager(appConfig, server);
+    if (auto connected = connectionManager.establishConnection(); !connected) {
+        std::cerr << "FATAL [Main]: Connection Error - " << connected.error().fullMessage() << std::endl;
+        return;
+    }
+
+    const int keyCount = 64;
+    const int queriesPerWorker = 2000;
+    std::vector<Query> gets;
+    for (int k = 0; k < keyCount; ++k) {
+        connectionManager.executeRemoteQuery(makeQuery(k, Query::Type::SET, "user:" + std::to_string(k), "value"), 0);
+        gets.push_back(makeQuery(k, Query::Type::GET, "user:" + std::to_string(k)));
+    }
+
+    auto runWorkers = [&]() {
+        std::vector<std::thread> workers;
+        for (int w = 0; w < workerCount; ++w) {
+            workers.emplace_back([&, w]() {
+                for (int i = 0; i < queriesPerWorker; ++i) {
+                    benchmark::DoNotOptimize(connectionManager.executeRemoteQuery(gets[(w + i) % keyCount], depth));
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    };
+    runWorkers(); // Opens the connections the workers need outside the timed loop
+    ConnectionPoolStats before = connectionManager.getConnectionPoolStats();
+
+    for (auto _ : state) {
+        runWorkers();
+    }
+
+    ConnectionPoolStats stats = connectionManager.getConnectionPoolStats();
+    double checkouts = static_cast<double>(stats.checkouts - before.checkouts);
+    state.SetItemsProcessed(state.iterations() * workerCount * queriesPerWorker);
+    state.counters["connections"] = static_cast<double>(stats.opened);
+    if (checkouts > 0) {
+        state.counters["wait_rate"] = static_cast<double>(stats.waits - before.waits) / checkouts;
+        state.counters["affinity_rate"] = static_cast<double>(stats.affinityHits - before.affinityHits) / checkouts;
+    }
+}
+
+// Replays a query file under per-query and per-batch deadlines and reports the share of queries that missed them.
+void deadlines(benchmark::State& state, std::string configFilePath, std::string queryFilePath, int queryExecuteCount, int depth, int queryTimeoutUs, int batchTimeoutUs, ExecutionMode executionMode) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    Server server;
+    ConnectionManager connectionManager = ConnectionManager(appConfig, server);
+    if (auto connected = connectionManager.establishConnection(); !connected) {
+        std::cerr << "FATAL [Main]: Connection Error - " << connected.error().fullMessage() << std::endl;
+        return;
+    }
+    QueryEngine queryEngine = QueryEngine(connectionManager, executionMode);
+    queryEngine.setQueryTimeout(std::chrono::microseconds(queryTimeoutUs));
+    queryEngine.setBatchTimeout(std::chrono::microseconds(batchTimeoutUs));
+
+    auto parsedQueries = queryEngine.parseQueriesFromFile(queryFilePath);
+    if (!parsedQueries) {
+        std::cerr << "FATAL [Main]: Query File Error - " << parsedQueries.error().fullMessage() << std::endl;
+        return;
+    }
+    std::vector<Query> baseQueries = std::move(*parsedQueries);
+    std::vector<Query> queriesToRun;
+    for (int i = 0; i < queryExecuteCount; ++i) {
+        queriesToRun.insert(queriesToRun.end(), baseQueries.begin(), baseQueries.end());
+    }
+
+    size_t executed = 0;
+    size_t missed = 0;
+    for (auto _ : state) {
+        std::vector<QueryResult> results = queryEngine.executeQueries(queriesToRun, depth);
+        for (const auto& result : results) {
+            missed += (!result.result && result.result.error().code == ErrorCode::QueryTimeout) ? 1 : 0;
+        }
+        executed += results.size();
+    }
+    if (executed > 0) {
+        state.counters["deadline_miss_ratio"] = static_cast<double>(missed) / static_cast<double>(executed);
+    }
+}
+
+// Latency of small interactive batches while a 100K-SET bulk batch runs concurrently on the same engine.
+// Without priorities every query lands in the NORMAL class and interactive work queues behind the bulk load.
+void priorityLatency(benchmark::State& state, std::string configFilePath, bool usePriorities) {
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    Server server;
+    ConnectionManager connectionManager = ConnectionManager(appConfig, server);
+    if (auto connected = connectionManager.establishConnection(); !connected) {
+        std::cerr << "FATAL [Main]: Connection Error - " << connected.error().fullMessage() << std::endl;
+        return;
+    }
+    QueryEngine queryEngine = QueryEngine(connectionManager, ExecutionMode::PREALLOCATED_SLOTS);
+
+    std::vector<Query> bulkQueries;
+    for (int i = 0; i < 100000; ++i) {
+        bulkQueries.push_back(makeQuery(i, Query::Type::SET, "bulk:" + std::to_string(i % 1024), "payload"));
+        bulkQueries.back().priority = usePriorities ? Query::Priority::BULK : Query::Priority::NORMAL;
+    }
+    std::vector<Query> interactiveQueries;
+    for (int i = 0; i < 8; ++i) {
+        interactiveQueries.push_back(makeQuery(i, Query::Type::GET, "bulk:" + std::to_string(i)));
+        interactiveQueries.back().priority = usePriorities ? Query::Priority::INTERACTIVE : Query::Priority::NORMAL;
+    }
+
+    std::vector<double> latenciesUs;
+    for (auto _ : state) {
+        std::atomic<bool> bulkDone{ false };
+        std::chrono::steady_clock::time_point bulkFinishedAt;
+        std::thread bulkThread([&]() {
+            auto bulkResults = queryEngine.executeQueries(bulkQueries, 0);
+            bulkFinishedAt = std::chrono::steady_clock::now();
+            bulkDone = true;
+            });
+        // Give the bulk batch time to be queued so every interactive sample competes with it
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::vector<std::pair<std::chrono::steady_clock::time_point, double>> samples;
+        while (!bulkDone) {
+            auto start = std::chrono::steady_clock::now();
+            benchmark::DoNotOptimize(queryEngine.executeQueries(interactiveQueries, 0));
+            samples.emplace_back(start, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            std::this_thread::sleep_for(std::chrono::microseconds(100)); // Interactive clients have think time
+        }
+        bulkThread.join();
+        // Only batches submitted while the bulk load was still running count
+        for (const auto& [start, latencyUs] : samples) {
+            if (start < bulkFinishedAt) {
+                latenciesUs.push_back(latencyUs);
+            }
+        }
+    }
+
+    if (!latenciesUs.empty()) {
+        std::sort(latenciesUs.begin(), latenciesUs.end());
+        state.counters["interactive_p50_us"] = latenciesUs[latenciesUs.size() / 2];
+        state.counters["interactive_p99_us"] = latenciesUs[latenciesUs.size() * 99 / 100];
+        state.counters["interactive_max_us"] = latenciesUs.back();
+        state.counters["interactive_batches"] = static_cast<double>(latenciesUs.size());
+    }
+}
+
+enum class ParseMode {
+    STREAM,
+    MAPPED,
+    MAPPED_SCAN,
+    COMPILED,      // Binary file from querycompile, materialised
+    COMPILED_SCAN, // Binary file from querycompile, visited in place
+};
+
+// Writes a synthetic query file of roughly targetBytes into the temp directory, reusing it across runs.
+// SET values are short unless valueBytes is given; badLinePercent of the lines are malformed.
+std::string generatedQueryFile(size_t targetBytes, size_t valueBytes = 0, int badLinePercent = 0) {
+    std::string fileName = "queries_" + std::to_string(targetBytes >> 20) + "MB";
+    if (valueBytes > 0) {
+        fileName += "_value" + std::to_string(valueBytes);
+    }
+    if (badLinePercent > 0) {
+        fileName += "_bad" + std::to_string(badLinePercent);
+    }
+    std::error_code ec;
+    std::filesystem::path filePath = std::filesystem::temp_directory_path(ec) / (fileName + ".txt");
+    std::string longValue(valueBytes, 'v');
+    if (uintmax_t existingBytes = std::filesystem::file_size(filePath, ec); !ec && existingBytes >= targetBytes) {
+        return filePath.string();
+    }
+    std::ofstream out(filePath, std::ios::binary | std::ios::trunc);
+    size_t written = 0;
+    for (int id = 1; written < targetBytes; ++id) {
+        std::string line = std::to_string(id);
+        switch (id % 4) {
+        case 0: line += ",SET user:" + std::to_string(id % 4096) + "=" + (valueBytes > 0 ? longValue : "value" + std::to_string(id)); break;
+        case 3: line += ",DELETE user:" + std::to_string(id % 4096); break;
+        default: line += ",GET user:" + std::to_string(id % 4096); break;
+        }
+        if (static_cast<int>((id * 37) % 100) < badLinePercent) {
+            // A mix of the ways a line can fail: unparsable id, unknown command, missing command
+            switch (id % 3) {
+            case 0: line = "x" + std::to_string(id) + ",GET user:1"; break;
+            case 1: line = std::to_string(id) + ",PUT user:1"; break;
+            default: line = std::to_string(id); break;
+            }
+        }
+        line += '\n';
+        out << line;
+        written += line.size();
+    }
+    return filePath.string();
+}
+
+// gzip-compressed copy of generatedQueryFile(targetBytes)
+std::string gzippedQueryFile(size_t targetBytes) {
+    std::string textPath = generatedQueryFile(targetBytes);
+    std::string gzipPath = textPath + ".gz";
+    std::error_code ec;
+    if (std::filesystem::exists(gzipPath, ec)) {
+        return gzipPath;
+    }
+    std::ifstream in(textPath, std::ios::binary);
+    gzFile out = gzopen(gzipPath.c_str(), "wb6");
+    std::vector<char> buffer(size_t(1) << 20);
+    while (in.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || in.gcount() > 0) {
+        gzwrite(out, buffer.data(), static_cast<unsigned>(in.gcount()));
+    }
+    gzclose(out);
+    return gzipPath;
+}
+
+void parseThroughput(benchmark::State& state, std::string configFilePath, ParseMode parseMode, size_t fileBytes, ScanBackend scanBackend = detectScanBackend(), size_t valueBytes = 0, size_t threadCount = 1) {
+    std::string queryFilePath = generatedQueryFile(fileBytes, valueBytes);
+    std::error_code ec;
+    size_t actualBytes = static_cast<size_t>(std::filesystem::file_size(queryFilePath, ec));
+
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    Server server;
+    ConnectionManager connectionManager = ConnectionManager(appConfig, server);
+    QueryEngine queryEngine = QueryEngine(connectionManager);
+    queryEngine.setScanBackend(scanBackend);
+    state.SetLabel(scanBackendName(queryEngine.getScanBackend()));
+    std::string compiledFilePath = std::filesystem::path(queryFilePath).replace_extension(".qbin").string();
+    if ((parseMode == ParseMode::COMPILED || parseMode == ParseMode::COMPILED_SCAN) && !std::filesystem::exists(compiledFilePath)) {
+        CompiledQueryWriter writer;
+        auto scanned = queryEngine.scanQueriesFromMappedFile(queryFilePath, [&](const QueryView& query) { writer.append(query); });
+        if (!scanned) {
+            state.SkipWithError(scanned.error().fullMessage().c_str());
+            return;
+        }
+        std::string contents = writer.finish();
+        std::ofstream(compiledFilePath, std::ios::binary | std::ios::trunc).write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    for (auto _ : state) {
+        size_t parsed = 0;
+        switch (parseMode) {
+        case ParseMode::STREAM: {
+            auto queries = queryEngine.parseQueriesFromFile(queryFilePath);
+            if (!queries) {
+                state.SkipWithError(queries.error().fullMessage().c_str());
+                return;
+            }
+            parsed = queries->size();
+            break;
+        }
+        case ParseMode::MAPPED: {
+            auto queries = queryEngine.parseQueriesFromMappedFile(queryFilePath, threadCount);
+            if (!queries) {
+                state.SkipWithError(queries.error().fullMessage().c_str());
+                return;
+            }
+            parsed = queries->size();
+            break;
+        }
+        case ParseMode::MAPPED_SCAN: {
+            auto scanned = queryEngine.scanQueriesFromMappedFile(queryFilePath, [](const QueryView& query) {
+                benchmark::DoNotOptimize(query.key.data());
+                });
+            if (!scanned) {
+                state.SkipWithError(scanned.error().fullMessage().c_str());
+                return;
+            }
+            parsed = *scanned;
+            break;
+        }
+        case ParseMode::COMPILED: {
+            auto queries = QueryEngine::loadCompiledQueries(compiledFilePath);
+            if (!queries) {
+                state.SkipWithError(queries.error().fullMessage().c_str());
+                return;
+            }
+            parsed = queries->size();
+            break;
+        }
+        case ParseMode::COMPILED_SCAN: {
+            auto scanned = QueryEngine::scanCompiledQueries(compiledFilePath, [](const QueryView& query) {
+                benchmark::DoNotOptimize(query.key.data());
+                });
+            if (!scanned) {
+                state.SkipWithError(scanned.error().fullMessage().c_str());
+                return;
+            }
+            parsed = *scanned;
+            break;
+        }
+        }
+        benchmark::DoNotOptimize(parsed);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * actualBytes));
+    state.counters["MB_per_s"] = benchmark::Counter(static_cast<double>(state.iterations() * actualBytes) / (1 << 20), benchmark::Counter::kIsRate);
+}
+
+// Cost of rejecting malformed lines: badLinePercent of the lines fail to parse
+void malformedInput(benchmark::State& state, std::string configFilePath, ParseMode parseMode, size_t fileBytes, int badLinePercent, bool muteDiagnostics = true) {
+    std::string queryFilePath = generatedQueryFile(fileBytes, 0, badLinePercent);
+    std::error_code ec;
+    size_t actualBytes = static_cast<size_t>(std::filesystem::file_size(queryFilePath, ec));
+    size_t lineCount = 0;
+
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    Server server;
+    ConnectionManager connectionManager = ConnectionManager(appConfig, server);
+    QueryEngine queryEngine = QueryEngine(connectionManager);
+
+    // Diagnostics are muted so the benchmark measures detecting and skipping bad lines, not terminal output.
+    // Unmuted, the shared sink writes at most its rate limit per second and counts the rest.
+    if (muteDiagnostics) {
+        std::cerr.setstate(std::ios::failbit);
+    }
+    for (auto _ : state) {
+        size_t parsed = 0;
+        if (parseMode == ParseMode::STREAM) {
+            auto queries = queryEngine.parseQueriesFromFile(queryFilePath);
+            parsed = queries ? queries->size() : 0;
+        }
+        else {
+            auto queries = queryEngine.parseQueriesFromMappedFile(queryFilePath);
+            parsed = queries ? queries->size() : 0;
+        }
+        benchmark::DoNotOptimize(parsed);
+        lineCount = parsed;
+    }
+    std::cerr.clear();
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * actualBytes));
+    state.counters["valid_queries"] = static_cast<double>(lineCount);
+}
+
+enum class IngestMode {
+    PLAIN,                  // Uncompressed file through parseQueriesFromFile
+    DECOMPRESS_TO_DISK,     // gunzip to a temporary file, then parseQueriesFromFile on it
+    STREAMING_DECOMPRESSION // parseQueriesFromFile on the .gz, inflated on a background thread
+};
+
+// Replaying a gzip-compressed query capture; bytes_per_second counts uncompressed bytes
+void gzipIngest(benchmark::State& state, std::string configFilePath, IngestMode mode, size_t fileBytes) {
+    std::string textPath = generatedQueryFile(fileBytes);
+    std::string gzipPath = gzippedQueryFile(fileBytes);
+    std::error_code ec;
+    std::string scratchPath = (std::filesystem::temp_directory_path(ec) / "gunzipped_queries.txt").string();
+    size_t actualBytes = static_cast<size_t>(std::filesystem::file_size(textPath, ec));
+    IngestStats stats;
+
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    Server server;
+    ConnectionManager connectionManager = ConnectionManager(appConfig, server);
+    QueryEngine queryEngine = QueryEngine(connectionManager);
+
+    for (auto _ : state) {
+        std::expected<std::vector<Query>, ErrorInfo> queries;
+        switch (mode) {
+        case IngestMode::PLAIN:
+            queries = queryEngine.parseQueriesFromFile(textPath);
+            break;
+        case IngestMode::DECOMPRESS_TO_DISK: {
+            gzFile in = gzopen(gzipPath.c_str(), "rb");
+            std::ofstream out(scratchPath, std::ios::binary | std::ios::trunc);
+            std::vector<char> buffer(size_t(1) << 20);
+            for (int n; (n = gzread(in, buffer.data(), static_cast<unsigned>(buffer.size()))) > 0;) {
+                out.write(buffer.data(), n);
+            }
+            gzclose(in);
+            out.close();
+            queries = queryEngine.parseQueriesFromFile(scratchPath);
+            break;
+        }
+        case IngestMode::STREAMING_DECOMPRESSION:
+            queries = queryEngine.parseQueriesFromGzipFile(gzipPath, &stats);
+            break;
+        }
+        if (!queries) {
+            state.SkipWithError(queries.error().fullMessage().c_str());
+            return;
+        }
+        benchmark::DoNotOptimize(queries->size());
+    }
+    std::filesystem::remove(scratchPath, ec);
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * actualBytes));
+    if (mode == IngestMode::STREAMING_DECOMPRESSION) {
+        auto megabytesPerSecond = [&](std::chrono::nanoseconds busy) {
+            return busy.count() > 0 ? static_cast<double>(stats.decompressedBytes) / (1 << 20) / (static_cast<double>(busy.count()) / 1e9) : 0.0;
+            };
+        state.counters["decompress_MB_per_s"] = megabytesPerSecond(stats.decompressBusy);
+        state.counters["parse_MB_per_s"] = megabytesPerSecond(stats.parseBusy);
+        state.counters["compression_ratio"] = static_cast<double>(stats.decompressedBytes) / static_cast<double>(stats.compressedBytes);
+    }
+}
+
+// Replaying the queries with ids in [firstId, lastId] from the middle of a large file
+void idRangeReplay(benchmark::State& state, std::string configFilePath, size_t fileBytes, int firstId, int lastId, bool indexed) {
+    std::string queryFilePath = generatedQueryFile(fileBytes);
+    size_t replayed = 0;
+
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    Server server;
+    ConnectionManager connectionManager = ConnectionManager(appConfig, server);
+    QueryEngine queryEngine = QueryEngine(connectionManager);
+
+    if (indexed) {
+        // The first replay builds the sidecar; time it separately from the replays that use it
+        std::error_code ec;
+        std::filesystem::remove(QueryFileIndex::sidecarPath(queryFilePath), ec);
+        auto buildStart = std::chrono::steady_clock::now();
+        auto first = queryEngine.parseQueriesFromFile(queryFilePath, firstId, lastId);
+        if (!first) {
+            state.SkipWithError(first.error().fullMessage().c_str());
+            return;
+        }
+        state.counters["first_replay_ms"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+    }
+    for (auto _ : state) {
+        std::expected<std::vector<Query>, ErrorInfo> queries;
+        if (indexed) {
+            queries = queryEngine.parseQueriesFromFile(queryFilePath, firstId, lastId);
+        }
+        else {
+            queries = queryEngine.parseQueriesFromMappedFile(queryFilePath);
+            if (queries) {
+                std::erase_if(*queries, [&](const Query& query) { return query.id < firstId || query.id > lastId; });
+            }
+        }
+        if (!queries) {
+            state.SkipWithError(queries.error().fullMessage().c_str());
+            return;
+        }
+        replayed = queries->size();
+        benchmark::DoNotOptimize(queries->data());
+    }
+    state.counters["replayed_queries"] = static_cast<double>(replayed);
+}
+
+enum class DiagnosticsMode {
+    SYNCHRONOUS,      // Formatted and flushed by the reporting thread, as with std::cerr << ... << std::endl
+    SINK,             // Handed to a DiagnosticsSink with no rate limit
+    SINK_RATE_LIMITED // Handed to a DiagnosticsSink with the default rate limit
+};
+
+// Cost to the reporting threads of emitting one diagnostic, written to a file so the terminal does not dominate
+void diagnosticsReport(benchmark::State& state, DiagnosticsMode mode) {
+    static std::ofstream out;
+    static std::unique_ptr<DiagnosticsSink> sink;
+    static std::mutex outMutex;
+    if (state.thread_index() == 0) {
+        out.open(std::filesystem::temp_directory_path() / "diagnostics_bench.log", std::ios::trunc);
+        if (mode != DiagnosticsMode::SYNCHRONOUS) {
+            sink = std::make_unique<DiagnosticsSink>(out, 4096, mode == DiagnosticsMode::SINK ? 0 : 100);
+        }
+    }
+
+    int lineNumber = 0;
+    for (auto _ : state) {
+        ++lineNumber;
+        ErrorInfo error{ ErrorCode::ParseError, "Invalid command type", lineNumber };
+        if (mode == DiagnosticsMode::SYNCHRONOUS) {
+            std::lock_guard<std::mutex> lock(outMutex);
+            out << "Skipping malformed line " << lineNumber << ": " << error.fullMessage() << std::endl;
+        }
+        else {
+            sink->report(error.code, "Skipping malformed line " + std::to_string(lineNumber) + ": " + error.fullMessage());
+        }
+    }
+
+    if (state.thread_index() == 0) {
+        if (sink) {
+            DiagnosticsSink::Counts counts = sink->counts(ErrorCode::ParseError);
+            sink->flush();
+            sink.reset();
+            state.counters["dropped_or_suppressed"] = static_cast<double>(counts.dropped + counts.suppressed);
+        }
+        out.close();
+    }
+}
+
+// Runs a whole query file either parse-then-execute or through the parse/execute pipeline
+void pipeline(benchmark::State& state, std::string configFilePath, size_t fileBytes, size_t batchSize, size_t queueCapacity, bool pipelined) {
+    std::string queryFilePath = generatedQueryFile(fileBytes);
+    PipelineStats stats;
+
+    auto configExpected = ConfigLoader::loadConfig(configFilePath);
+    if (!configExpected) {
+        std::cerr << "FATAL [Main]: Configuration Error - " << configExpected.error().fullMessage() << std::endl;
+        return;
+    }
+    AppConfig appConfig = configExpected.value();
+    Server server;
+    ConnectionManager connectionManager = ConnectionManager(appConfig, server);
+    if (auto connected = connectionManager.establishConnection(); !connected) {
+        std::cerr << "FATAL [Main]: Connection Error - " << connected.error().fullMessage() << std::endl;
+        return;
+    }
+    QueryEngine queryEngine = QueryEngine(connectionManager, ExecutionMode::PREALLOCATED_SLOTS);
+
+    for (auto _ : state) {
+        if (pipelined) {
+            auto run = queryEngine.executeQueryFilePipelined(queryFilePath, 0, batchSize, queueCapacity);
+            if (!run) {
+                state.SkipWithError(run.error().fullMessage().c_str());
+                return;
+            }
+            stats = *run;
+            continue;
+        }
+        // Baseline: parse everything, then execute in the same batch size
+        auto start = std::chrono::steady_clock::now();
+        auto queries = queryEngine.parseQueriesFromMappedFile(queryFilePath);
+        if (!queries) {
+            state.SkipWithError(queries.error().fullMessage().c_str());
+            return;
+        }
+        stats.parsedQueries = queries->size();
+        for (size_t begin = 0; begin < queries->size(); begin += batchSize) {
+            std::vector<Query> batch(queries->begin() + begin, queries->begin() + std::min(queries->size(), begin + batchSize));
+            benchmark::DoNotOptimize(queryEngine.executeQueries(batch, 0));
+            if (begin == 0) {
+                stats.firstResultLatency = std::chrono::steady_clock::now() - start;
+            }
+        }
+    }
+
+    auto toMs = [](std::chrono::nanoseconds duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+    state.counters["first_result_ms"] = toMs(stats.firstResultLatency);
+    state.counters["queries"] = static_cast<double>(stats.parsedQueries);
+    // Queries held in memory at once: the whole file without the pipeline, the queue plus one batch per stage with it
+    state.counters["resident_queries_max"] = static_cast<double>(pipelined ? std::min(stats.parsedQueries, (queueCapacity + 2) * batchSize) : stats.parsedQueries);
+    if (pipelined) {
+        state.counters["parse_busy_ms"] = toMs(stats.parseBusy);
+        state.counters["parse_blocked_ms"] = toMs(stats.parseBlocked);
+        state.counters["execute_busy_ms"] = toMs(stats.executeBusy);
+        state.counters["execute_starved_ms"] = toMs(stats.executeStarved);
+        state.counters["queue_depth_avg"] = stats.averageQueueDepth;
+        state.counters["queue_depth_max"] = static_cast<double>(stats.maxQueueDepth);
+    }
+}
+
+// Server store keyed by string vs by interned id: bytes per stored entry and GET throughput. Only the store
+// shrinks: a Query keeps its key string either way, so the queries cost the same.
+void keyIndexing(benchmark::State& state, KeyIndexing indexing, int keyCount) {
+    Server server(indexing);
+
+    // Interner cost per distinct key, measured on a private table since the shared one may already hold these keys
+    int64_t bytesBefore = liveBytes.load();
+    {
+        KeyInterner interner;
+        for (int i = 0; i < keyCount; ++i) {
+            interner.intern("user:" + std::to_string(i));
+        }
+        state.counters["interner_bytes_per_key"] = static_cast<double>(liveBytes.load() - bytesBefore) / keyCount;
+    }
+
+    auto withKeyId = [&](Query query) {
+        if (indexing == KeyIndexing::INTERNED) {
+            query.keyId = KeyInterner::shared().intern(query.key);
+        }
+        return query;
+        };
+    std::vector<Query> sets;
+    std::vector<Query> gets;
+    for (int i = 0; i < keyCount; ++i) {
+        sets.push_back(withKeyId(makeQuery(i, Query::Type::SET, "user:" + std::to_string(i), "value")));
+    }
+    gets.reserve(keyCount);
+    for (int i = 0; i < keyCount; ++i) {
+        gets.push_back(withKeyId(makeQuery(i, Query::Type::GET, "user:" + std::to_string(i))));
+    }
+
+    bytesBefore = liveBytes.load();
+    for (const auto& query : sets) {
+        benchmark::DoNotOptimize(server.processCommand(query, 0));
+    }
+    state.counters["store_bytes_per_entry"] = static_cast<double>(liveBytes.load() - bytesBefore) / keyCount;
+
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(server.processCommand(gets[next], 0));
+        next = next + 1 == gets.size() ? 0 : next + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
 }
 
 BENCHMARK_CAPTURE(program, success100_100, "configs/example_primary.cfg", "queries/success100.txt", 25);
@@ -92,4 +1570,145 @@ BENCHMARK_CAPTURE(program, success50_1000, "configs/example_primary.cfg", "queri
 BENCHMARK_CAPTURE(program, success25_1000, "configs/example_primary.cfg", "queries/success25.txt", 250);
 BENCHMARK_CAPTURE(program, success0_1000, "configs/example_primary.cfg", "queries/success0.txt", 250);
 
+BENCHMARK_CAPTURE(program, success100_1000_slots, "configs/example_primary.cfg", "queries/success100.txt", 250, 0, ConnectionSuccess::SUCCESS, 0, ExecutionMode::PREALLOCATED_SLOTS);
+BENCHMARK_CAPTURE(program, success50_1000_slots, "configs/example_primary.cfg", "queries/success50.txt", 250, 0, ConnectionSuccess::SUCCESS, 0, ExecutionMode::PREALLOCATED_SLOTS);
+BENCHMARK_CAPTURE(program, success0_1000_slots, "configs/example_primary.cfg", "queries/success0.txt", 250, 0, ConnectionSuccess::SUCCESS, 0, ExecutionMode::PREALLOCATED_SLOTS);
+
+BENCHMARK_CAPTURE(program, success100_1000_coalesced, "configs/example_primary.cfg", "queries/success100.txt", 250, 0, ConnectionSuccess::SUCCESS, 0, ExecutionMode::ASYNC_FUTURES, true);
+BENCHMARK_CAPTURE(program, success50_1000_coalesced, "configs/example_primary.cfg", "queries/success50.txt", 250, 0, ConnectionSuccess::SUCCESS, 0, ExecutionMode::ASYNC_FUTURES, true);
+BENCHMARK_CAPTURE(program, success100_1000_slots_coalesced, "configs/example_primary.cfg", "queries/success100.txt", 250, 0, ConnectionSuccess::SUCCESS, 0, ExecutionMode::PREALLOCATED_SLOTS, true);
+BENCHMARK_CAPTURE(program, success50_1000_slots_coalesced, "configs/example_primary.cfg", "queries/success50.txt", 250, 0, ConnectionSuccess::SUCCESS, 0, ExecutionMode::PREALLOCATED_SLOTS, true);
+
+BENCHMARK_CAPTURE(failover, retry_ladder, "configs/example_primary.cfg", 0, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(failover, circuit_breaker, "configs/example_primary.cfg", 8, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(failover, circuit_breaker_recovery, "configs/example_primary.cfg", 8, true)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(timeToFirstQuery, success_serial, "configs/example_primary.cfg", ConnectionSuccess::SUCCESS, 0)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(timeToFirstQuery, success_race, "configs/example_primary.cfg", ConnectionSuccess::SUCCESS, 50)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(timeToFirstQuery, transient_serial, "configs/example_primary.cfg", ConnectionSuccess::PRIMARY_TRANSIENT_FAILURE, 0)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(timeToFirstQuery, transient_race, "configs/example_primary.cfg", ConnectionSuccess::PRIMARY_TRANSIENT_FAILURE, 50)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(timeToFirstQuery, permanent_serial, "configs/example_primary.cfg", ConnectionSuccess::PRIMARY_PERMANENT_FAILURE, 0)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(timeToFirstQuery, permanent_race, "configs/example_primary.cfg", ConnectionSuccess::PRIMARY_PERMANENT_FAILURE, 50)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(virtualTimeFailover, ladder_1000_clients_24h, "configs/example_primary.cfg", 1000, 24, 15, 0, 42)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(virtualTimeFailover, breaker_1000_clients_24h, "configs/example_primary.cfg", 1000, 24, 15, 8, 42)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(hedging, off, "configs/example_primary.cfg", Transport::SIMULATED, 0, 0)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(hedging, p95_budget5, "configs/example_primary.cfg", Transport::SIMULATED, 95, 5)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(hedging, p90_budget10, "configs/example_primary.cfg", Transport::SIMULATED, 90, 10)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(hedging, p95_budget1, "configs/example_primary.cfg", Transport::SIMULATED, 95, 1)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(hedging, tcp_off, "configs/example_primary.cfg", Transport::TCP, 0, 0)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(hedging, tcp_p90_budget10, "configs/example_primary.cfg", Transport::TCP, 90, 10)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(readBalancing, primary_only, "configs/example_primary.cfg", ReadBalancing::PRIMARY_ONLY, 200, 0)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(readBalancing, least_outstanding, "configs/example_primary.cfg", ReadBalancing::LEAST_OUTSTANDING, 200, 0)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(readBalancing, least_outstanding_slow_backup, "configs/example_primary.cfg", ReadBalancing::LEAST_OUTSTANDING, 600, 0)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(readBalancing, primary_only_writes10, "configs/example_primary.cfg", ReadBalancing::PRIMARY_ONLY, 200, 10)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(readBalancing, least_outstanding_writes10, "configs/example_primary.cfg", ReadBalancing::LEAST_OUTSTANDING, 200, 10)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(clientCache, disabled, "configs/example_primary.cfg", 0, 0, 0);
+BENCHMARK_CAPTURE(clientCache, enabled, "configs/example_primary.cfg", 1024, 0, 0);
+BENCHMARK_CAPTURE(clientCache, enabled_external_writes, "configs/example_primary.cfg", 1024, 10, 25);
+BENCHMARK_CAPTURE(clientCache, undersized_external_writes, "configs/example_primary.cfg", 32, 10, 25);
+
+BENCHMARK_CAPTURE(loopbackTransport, simulated_success50, "configs/example_primary.cfg", "queries/success50.txt", 250, Transport::SIMULATED)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(loopbackTransport, tcp_success50, "configs/example_primary.cfg", "queries/success50.txt", 250, Transport::TCP)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(loopbackTransport, tcp_success50_primary_down, "configs/example_primary.cfg", "queries/success50.txt", 250, Transport::TCP, true)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(loopbackTransport, shm_success50, "configs/example_primary.cfg", "queries/success50.txt", 250, Transport::SHARED_MEMORY)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(transportLatency, in_process, "configs/example_primary.cfg", "queries/success100.txt", Transport::SIMULATED)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(transportLatency, tcp, "configs/example_primary.cfg", "queries/success100.txt", Transport::TCP)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(transportLatency, shm, "configs/example_primary.cfg", "queries/success100.txt", Transport::SHARED_MEMORY)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(batchTransport, per_query_batch256, "configs/example_primary.cfg", 256, 4, BatchPath::PER_QUERY)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(batchTransport, epoll_batch256, "configs/example_primary.cfg", 256, 4, BatchPath::EPOLL)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(batchTransport, io_uring_batch256, "configs/example_primary.cfg", 256, 4, BatchPath::IO_URING)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(batchTransport, epoll_batch4096, "configs/example_primary.cfg", 4096, 4, BatchPath::EPOLL)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(batchTransport, io_uring_batch4096, "configs/example_primary.cfg", 4096, 4, BatchPath::IO_URING)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(wireCodec, text_encode_request, WireProtocol::TEXT, WireCodecStep::ENCODE_REQUEST);
+BENCHMARK_CAPTURE(wireCodec, binary_encode_request, WireProtocol::BINARY, WireCodecStep::ENCODE_REQUEST);
+BENCHMARK_CAPTURE(wireCodec, text_decode_request, WireProtocol::TEXT, WireCodecStep::DECODE_REQUEST);
+BENCHMARK_CAPTURE(wireCodec, binary_decode_request, WireProtocol::BINARY, WireCodecStep::DECODE_REQUEST);
+BENCHMARK_CAPTURE(wireCodec, text_encode_response, WireProtocol::TEXT, WireCodecStep::ENCODE_RESPONSE);
+BENCHMARK_CAPTURE(wireCodec, binary_encode_response, WireProtocol::BINARY, WireCodecStep::ENCODE_RESPONSE);
+BENCHMARK_CAPTURE(wireCodec, text_decode_response, WireProtocol::TEXT, WireCodecStep::DECODE_RESPONSE);
+BENCHMARK_CAPTURE(wireCodec, binary_decode_response, WireProtocol::BINARY, WireCodecStep::DECODE_RESPONSE);
+
+BENCHMARK_CAPTURE(wirePipeline, text_depth1, "configs/example_primary.cfg", WireProtocol::TEXT, 1)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(wirePipeline, binary_depth1, "configs/example_primary.cfg", WireProtocol::BINARY, 1)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(wirePipeline, text_depth16, "configs/example_primary.cfg", WireProtocol::TEXT, 16)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(wirePipeline, binary_depth16, "configs/example_primary.cfg", WireProtocol::BINARY, 16)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(wirePipeline, text_depth256, "configs/example_primary.cfg", WireProtocol::TEXT, 256)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(wirePipeline, binary_depth256, "configs/example_primary.cfg", WireProtocol::BINARY, 256)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(connectionPool, pool1_workers1, "configs/example_primary.cfg", 1, 1, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(connectionPool, pool1_workers4, "configs/example_primary.cfg", 1, 4, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(connectionPool, pool1_workers8, "configs/example_primary.cfg", 1, 8, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(connectionPool, pool2_workers1, "configs/example_primary.cfg", 2, 1, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(connectionPool, pool2_workers4, "configs/example_primary.cfg", 2, 4, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(connectionPool, pool2_workers8, "configs/example_primary.cfg", 2, 8, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(connectionPool, pool4_workers1, "configs/example_primary.cfg", 4, 1, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(connectionPool, pool4_workers4, "configs/example_primary.cfg", 4, 4, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(connectionPool, pool4_workers8, "configs/example_primary.cfg", 4, 8, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(connectionPool, pool8_workers1, "configs/example_primary.cfg", 8, 1, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(connectionPool, pool8_workers4, "configs/example_primary.cfg", 8, 4, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(connectionPool, pool8_workers8, "configs/example_primary.cfg", 8, 8, 200)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(deadlines, success50_1000_200_query10ms_futures, "configs/example_primary.cfg", "queries/success50.txt", 250, 200, 10000, 0, ExecutionMode::ASYNC_FUTURES);
+BENCHMARK_CAPTURE(deadlines, success50_1000_200_query10ms_slots, "configs/example_primary.cfg", "queries/success50.txt", 250, 200, 10000, 0, ExecutionMode::PREALLOCATED_SLOTS);
+BENCHMARK_CAPTURE(deadlines, success50_1000_200_batch5ms_futures, "configs/example_primary.cfg", "queries/success50.txt", 250, 200, 10000, 5000, ExecutionMode::ASYNC_FUTURES);
+BENCHMARK_CAPTURE(deadlines, success50_1000_200_batch5ms_slots, "configs/example_primary.cfg", "queries/success50.txt", 250, 200, 10000, 5000, ExecutionMode::PREALLOCATED_SLOTS);
+
+BENCHMARK_CAPTURE(priorityLatency, fifo, "configs/example_primary.cfg", false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(priorityLatency, weighted_fair, "configs/example_primary.cfg", true)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(parseThroughput, stream_64MB, "configs/example_primary.cfg", ParseMode::STREAM, size_t(64) << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, mapped_64MB, "configs/example_primary.cfg", ParseMode::MAPPED, size_t(64) << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, mapped_scan_1GB, "configs/example_primary.cfg", ParseMode::MAPPED_SCAN, size_t(1) << 30)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(parseThroughput, scan_short_keys_scalar, "configs/example_primary.cfg", ParseMode::MAPPED_SCAN, size_t(64) << 20, ScanBackend::SCALAR)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, scan_short_keys_sse2, "configs/example_primary.cfg", ParseMode::MAPPED_SCAN, size_t(64) << 20, ScanBackend::SSE2)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, scan_short_keys_avx2, "configs/example_primary.cfg", ParseMode::MAPPED_SCAN, size_t(64) << 20, ScanBackend::AVX2)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, scan_long_values_scalar, "configs/example_primary.cfg", ParseMode::MAPPED_SCAN, size_t(64) << 20, ScanBackend::SCALAR, 256)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, scan_long_values_sse2, "configs/example_primary.cfg", ParseMode::MAPPED_SCAN, size_t(64) << 20, ScanBackend::SSE2, 256)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, scan_long_values_avx2, "configs/example_primary.cfg", ParseMode::MAPPED_SCAN, size_t(64) << 20, ScanBackend::AVX2, 256)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(parseThroughput, mapped_256MB_threads1, "configs/example_primary.cfg", ParseMode::MAPPED, size_t(256) << 20, detectScanBackend(), 0, 1)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, mapped_256MB_threads2, "configs/example_primary.cfg", ParseMode::MAPPED, size_t(256) << 20, detectScanBackend(), 0, 2)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, mapped_256MB_threads4, "configs/example_primary.cfg", ParseMode::MAPPED, size_t(256) << 20, detectScanBackend(), 0, 4)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, mapped_256MB_threads_per_core, "configs/example_primary.cfg", ParseMode::MAPPED, size_t(256) << 20, detectScanBackend(), 0, 0)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Bytes processed count the text file in every mode, so MB_per_s compares formats for the same queries
+BENCHMARK_CAPTURE(parseThroughput, text_load_64MB, "configs/example_primary.cfg", ParseMode::MAPPED, size_t(64) << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, compiled_load_64MB, "configs/example_primary.cfg", ParseMode::COMPILED, size_t(64) << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, text_scan_64MB, "configs/example_primary.cfg", ParseMode::MAPPED_SCAN, size_t(64) << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(parseThroughput, compiled_scan_64MB, "configs/example_primary.cfg", ParseMode::COMPILED_SCAN, size_t(64) << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(malformedInput, stream_bad0, "configs/example_primary.cfg", ParseMode::STREAM, size_t(8) << 20, 0)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(malformedInput, stream_bad50, "configs/example_primary.cfg", ParseMode::STREAM, size_t(8) << 20, 50)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(malformedInput, mapped_bad0, "configs/example_primary.cfg", ParseMode::MAPPED, size_t(8) << 20, 0)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(malformedInput, mapped_bad50, "configs/example_primary.cfg", ParseMode::MAPPED, size_t(8) << 20, 50)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(malformedInput, stream_bad50_unmuted, "configs/example_primary.cfg", ParseMode::STREAM, size_t(8) << 20, 50, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(malformedInput, mapped_bad50_unmuted, "configs/example_primary.cfg", ParseMode::MAPPED, size_t(8) << 20, 50, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(gzipIngest, plain_64MB, "configs/example_primary.cfg", IngestMode::PLAIN, size_t(64) << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(gzipIngest, decompress_to_disk_64MB, "configs/example_primary.cfg", IngestMode::DECOMPRESS_TO_DISK, size_t(64) << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(gzipIngest, streaming_64MB, "configs/example_primary.cfg", IngestMode::STREAMING_DECOMPRESSION, size_t(64) << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(idRangeReplay, full_parse_64MB, "configs/example_primary.cfg", size_t(64) << 20, 2000000, 2100000, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(idRangeReplay, sidecar_index_64MB, "configs/example_primary.cfg", size_t(64) << 20, 2000000, 2100000, true)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(diagnosticsReport, synchronous, DiagnosticsMode::SYNCHRONOUS)->Threads(1)->Threads(4)->UseRealTime();
+BENCHMARK_CAPTURE(diagnosticsReport, sink, DiagnosticsMode::SINK)->Threads(1)->Threads(4)->UseRealTime();
+BENCHMARK_CAPTURE(diagnosticsReport, sink_rate_limited, DiagnosticsMode::SINK_RATE_LIMITED)->Threads(1)->Threads(4)->UseRealTime();
+
+BENCHMARK_CAPTURE(pipeline, parse_then_execute_4MB, "configs/example_primary.cfg", size_t(4) << 20, 1024, 8, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(pipeline, pipelined_4MB, "configs/example_primary.cfg", size_t(4) << 20, 1024, 8, true)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_CAPTURE(keyIndexing, string_4K, KeyIndexing::STRING, 4096);
+BENCHMARK_CAPTURE(keyIndexing, interned_4K, KeyIndexing::INTERNED, 4096);
+BENCHMARK_CAPTURE(keyIndexing, string_1M, KeyIndexing::STRING, 1 << 20);
+BENCHMARK_CAPTURE(keyIndexing, interned_1M, KeyIndexing::INTERNED, 1 << 20);
+
 BENCHMARK_MAIN();
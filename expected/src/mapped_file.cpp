@@ -0,0 +1,125 @@
+#include "mapped_file.hpp"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+std::expected<MappedFile, ErrorInfo> MappedFile::open(const std::string& filePath) {
+    MappedFile mapped;
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return std::unexpected(ErrorInfo{ ErrorCode::FileOpenFailed, "Could not open file " + filePath });
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return std::unexpected(ErrorInfo{ ErrorCode::FileOpenFailed, "Could not determine size of file " + filePath });
+    }
+    mapped.fileHandle = file;
+    mapped.length = static_cast<size_t>(fileSize.QuadPart);
+    if (mapped.length == 0) {
+        return mapped;
+    }
+
+    mapped.mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapped.mappingHandle == nullptr) {
+        return std::unexpected(ErrorInfo{ ErrorCode::FileOpenFailed, "Could not map file " + filePath });
+    }
+    mapped.data = static_cast<const char*>(MapViewOfFile(mapped.mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (mapped.data == nullptr) {
+        return std::unexpected(ErrorInfo{ ErrorCode::FileOpenFailed, "Could not map file " + filePath });
+    }
+    return mapped;
+}
+
+void MappedFile::release() noexcept {
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr) {
+        CloseHandle(fileHandle);
+    }
+    data = nullptr;
+    length = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+
+#else
+
+std::expected<MappedFile, ErrorInfo> MappedFile::open(const std::string& filePath) {
+    MappedFile mapped;
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::unexpected(ErrorInfo{ ErrorCode::FileOpenFailed, "Could not open file " + filePath });
+    }
+    struct stat fileStat;
+    if (::fstat(fd, &fileStat) != 0) {
+        ::close(fd);
+        return std::unexpected(ErrorInfo{ ErrorCode::FileOpenFailed, "Could not determine size of file " + filePath });
+    }
+    size_t length = static_cast<size_t>(fileStat.st_size);
+    if (length == 0) {
+        ::close(fd);
+        return mapped;
+    }
+
+    void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps its own reference to the file
+    if (mapping == MAP_FAILED) {
+        return std::unexpected(ErrorInfo{ ErrorCode::FileOpenFailed, "Could not map file " + filePath });
+    }
+    ::madvise(mapping, length, MADV_SEQUENTIAL);
+    mapped.data = static_cast<const char*>(mapping);
+    mapped.length = length;
+    return mapped;
+}
+
+void MappedFile::release() noexcept {
+    if (data != nullptr) {
+        ::munmap(const_cast<char*>(data), length);
+    }
+    data = nullptr;
+    length = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data(std::exchange(other.data, nullptr)),
+      length(std::exchange(other.length, 0))
+#ifdef _WIN32
+    , fileHandle(std::exchange(other.fileHandle, nullptr)),
+      mappingHandle(std::exchange(other.mappingHandle, nullptr))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        release();
+        data = std::exchange(other.data, nullptr);
+        length = std::exchange(other.length, 0);
+#ifdef _WIN32
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
@@ -0,0 +1,155 @@
+#include "query_binary.hpp"
+#include <cstring>
+
+static constexpr char compiledQueryMagic[4] = { 'Q', 'B', 'I', 'N' };
+
+static void appendLittleEndian(std::string& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static uint64_t readLittleEndian(const char* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= uint64_t(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+static void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void CompiledQueryWriter::append(const QueryView& query) {
+    uint8_t tag = static_cast<uint8_t>(query.type) | static_cast<uint8_t>(static_cast<uint8_t>(query.priority) << 2);
+    if (query.value) {
+        tag |= 1 << 4;
+    }
+    records.push_back(static_cast<char>(tag));
+    // Zigzag keeps small negative ids short
+    uint32_t id = static_cast<uint32_t>(query.id);
+    appendVarint(records, (id << 1) ^ static_cast<uint32_t>(query.id >> 31));
+    appendVarint(records, query.key.size());
+    records.append(query.key);
+    if (query.value) {
+        appendVarint(records, query.value->size());
+        records.append(*query.value);
+    }
+    ++count;
+}
+
+std::string CompiledQueryWriter::finish() {
+    std::string out;
+    out.reserve(compiledQueryHeaderSize + records.size());
+    out.append(compiledQueryMagic, sizeof(compiledQueryMagic));
+    appendLittleEndian(out, compiledQueryVersion, 2);
+    appendLittleEndian(out, 0, 2); // Flags
+    appendLittleEndian(out, count, 4);
+    out += records;
+    records.clear();
+    count = 0;
+    return out;
+}
+
+std::expected<CompiledQueryReader, ErrorInfo> CompiledQueryReader::open(std::string_view data) {
+    if (data.size() < compiledQueryHeaderSize || std::memcmp(data.data(), compiledQueryMagic, sizeof(compiledQueryMagic)) != 0) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ParseError, "Not a compiled query file" });
+    }
+    uint16_t version = static_cast<uint16_t>(readLittleEndian(data.data() + 4, 2));
+    if (version != compiledQueryVersion) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ParseError, "Unsupported compiled query version " + std::to_string(version) });
+    }
+    CompiledQueryReader reader(data);
+    if (readLittleEndian(data.data() + 6, 2) != 0) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ParseError, "Unknown compiled query flags" });
+    }
+    reader.count = static_cast<uint32_t>(readLittleEndian(data.data() + 8, 4));
+    return reader;
+}
+
+// Record errors carry the 1-based record number in lineNumber
+ErrorInfo CompiledQueryReader::recordError(const std::string& message) const {
+    return ErrorInfo{ ErrorCode::ParseError, message, static_cast<int>(consumed + 1) };
+}
+
+std::expected<uint64_t, ErrorInfo> CompiledQueryReader::readVarint() {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (offset >= data.size()) {
+            return std::unexpected(recordError("Truncated compiled query record"));
+        }
+        uint8_t byte = static_cast<uint8_t>(data[offset++]);
+        value |= uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    return std::unexpected(recordError("Overlong varint in compiled query record"));
+}
+
+std::expected<std::string_view, ErrorInfo> CompiledQueryReader::readBytes(size_t length) {
+    if (length > data.size() - offset) {
+        return std::unexpected(recordError("Truncated compiled query record"));
+    }
+    std::string_view bytes = data.substr(offset, length);
+    offset += length;
+    return bytes;
+}
+
+std::expected<bool, ErrorInfo> CompiledQueryReader::next(QueryView& query) {
+    if (consumed == count) {
+        if (offset != data.size()) {
+            return std::unexpected(ErrorInfo{ ErrorCode::ParseError, "Trailing bytes after the last compiled query record" });
+        }
+        return false;
+    }
+
+    auto tagByte = readBytes(1);
+    if (!tagByte) {
+        return std::unexpected(tagByte.error());
+    }
+    uint8_t tag = static_cast<uint8_t>((*tagByte)[0]);
+    uint8_t type = tag & 0x3;
+    uint8_t priority = (tag >> 2) & 0x3;
+    if (type > static_cast<uint8_t>(Query::Type::DELETE) || priority > static_cast<uint8_t>(Query::Priority::BULK) || (tag >> 5) != 0) {
+        return std::unexpected(recordError("Invalid tag in compiled query record"));
+    }
+    query.type = static_cast<Query::Type>(type);
+    query.priority = static_cast<Query::Priority>(priority);
+
+    auto zigzag = readVarint();
+    if (!zigzag) {
+        return std::unexpected(zigzag.error());
+    }
+    uint32_t encodedId = static_cast<uint32_t>(*zigzag);
+    query.id = static_cast<int>((encodedId >> 1) ^ (0u - (encodedId & 1)));
+    auto keyLength = readVarint();
+    if (!keyLength) {
+        return std::unexpected(keyLength.error());
+    }
+    auto key = readBytes(*keyLength);
+    if (!key) {
+        return std::unexpected(key.error());
+    }
+    query.key = *key;
+    query.value.reset();
+    if (tag & (1 << 4)) {
+        auto valueLength = readVarint();
+        if (!valueLength) {
+            return std::unexpected(valueLength.error());
+        }
+        auto value = readBytes(*valueLength);
+        if (!value) {
+            return std::unexpected(value.error());
+        }
+        query.value = *value;
+    }
+    query.rawCommand = {};
+    ++consumed;
+    return true;
+}
@@ -0,0 +1,184 @@
+#include "query_index.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+static constexpr char queryIndexMagic[4] = { 'Q', 'I', 'D', 'X' };
+static constexpr uint16_t queryIndexVersion = 1;
+static constexpr size_t queryIndexHeaderSize = 40;
+static constexpr size_t queryIndexBlockSize = 16;
+
+static void appendLittleEndian(std::string& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static uint64_t readLittleEndian(const char* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= uint64_t(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+// Size and mtime of the file as stored in the sidecar; nullopt if the file cannot be inspected
+static std::optional<std::pair<uint64_t, int64_t>> fileStamp(const std::string& filePath) {
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(filePath, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    auto mtime = std::filesystem::last_write_time(filePath, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    return std::make_pair(static_cast<uint64_t>(size), static_cast<int64_t>(mtime.time_since_epoch().count()));
+}
+
+QueryFileIndex::QueryFileIndex(uint32_t stride) : linesPerBlock(stride > 0 ? stride : defaultStride) {}
+
+void QueryFileIndex::addLine(uint64_t offset, std::string_view line) {
+    if (lines % linesPerBlock == 0) {
+        entries.push_back(Block{ offset });
+    }
+    ++lines;
+
+    // Only the id is read; lines without one leave the block's range unchanged
+    size_t idBegin = line.find_first_not_of(" \t");
+    if (idBegin == std::string_view::npos) {
+        return;
+    }
+    int id = 0;
+    if (std::from_chars(line.data() + idBegin, line.data() + line.size(), id).ec == std::errc()) {
+        Block& block = entries.back();
+        block.minId = std::min(block.minId, static_cast<int32_t>(id));
+        block.maxId = std::max(block.maxId, static_cast<int32_t>(id));
+    }
+}
+
+QueryFileIndex QueryFileIndex::build(std::string_view text, uint32_t stride) {
+    QueryFileIndex index(stride);
+    size_t offset = 0;
+    while (offset < text.size()) {
+        size_t newline = text.find('\n', offset);
+        size_t end = newline != std::string_view::npos ? newline : text.size();
+        index.addLine(offset, text.substr(offset, end - offset));
+        offset = end + 1;
+    }
+    index.finish(text.size());
+    return index;
+}
+
+std::optional<QueryFileIndex> QueryFileIndex::load(const std::string& filePath) {
+    auto stamp = fileStamp(filePath);
+    if (!stamp) {
+        return std::nullopt;
+    }
+    std::ifstream in(sidecarPath(filePath), std::ios::binary);
+    if (!in.is_open()) {
+        return std::nullopt;
+    }
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < queryIndexHeaderSize || std::memcmp(data.data(), queryIndexMagic, sizeof(queryIndexMagic)) != 0
+        || readLittleEndian(data.data() + 4, 2) != queryIndexVersion) {
+        return std::nullopt;
+    }
+    uint64_t fileBytes = readLittleEndian(data.data() + 16, 8);
+    int64_t mtime = static_cast<int64_t>(readLittleEndian(data.data() + 24, 8));
+    uint64_t blockCount = readLittleEndian(data.data() + 32, 8);
+    if (fileBytes != stamp->first || mtime != stamp->second
+        || blockCount != (data.size() - queryIndexHeaderSize) / queryIndexBlockSize
+        || (data.size() - queryIndexHeaderSize) % queryIndexBlockSize != 0) {
+        return std::nullopt;
+    }
+
+    uint32_t stride = static_cast<uint32_t>(readLittleEndian(data.data() + 8, 4));
+    if (stride == 0) {
+        return std::nullopt;
+    }
+
+    QueryFileIndex index(stride);
+    index.entries.reserve(blockCount);
+    for (uint64_t i = 0; i < blockCount; ++i) {
+        const char* entry = data.data() + queryIndexHeaderSize + i * queryIndexBlockSize;
+        Block block;
+        block.offset = readLittleEndian(entry, 8);
+        block.minId = static_cast<int32_t>(static_cast<uint32_t>(readLittleEndian(entry + 8, 4)));
+        block.maxId = static_cast<int32_t>(static_cast<uint32_t>(readLittleEndian(entry + 12, 4)));
+        if (block.offset >= fileBytes || (!index.entries.empty() && block.offset <= index.entries.back().offset)) {
+            return std::nullopt; // Offsets must be increasing and inside the file
+        }
+        index.entries.push_back(block);
+    }
+    index.indexedBytes = fileBytes;
+    return index;
+}
+
+bool QueryFileIndex::save(const std::string& filePath) const {
+    auto stamp = fileStamp(filePath);
+    if (!stamp || stamp->first != indexedBytes) {
+        return false; // The file changed since it was indexed
+    }
+    std::string out;
+    out.reserve(queryIndexHeaderSize + entries.size() * queryIndexBlockSize);
+    out.append(queryIndexMagic, sizeof(queryIndexMagic));
+    appendLittleEndian(out, queryIndexVersion, 2);
+    appendLittleEndian(out, 0, 2);
+    appendLittleEndian(out, linesPerBlock, 4);
+    appendLittleEndian(out, 0, 4);
+    appendLittleEndian(out, stamp->first, 8);
+    appendLittleEndian(out, static_cast<uint64_t>(stamp->second), 8);
+    appendLittleEndian(out, entries.size(), 8);
+    for (const Block& block : entries) {
+        appendLittleEndian(out, block.offset, 8);
+        appendLittleEndian(out, static_cast<uint32_t>(block.minId), 4);
+        appendLittleEndian(out, static_cast<uint32_t>(block.maxId), 4);
+    }
+
+    // Written aside and renamed so a concurrent reader never sees a partial sidecar
+    std::string sidecar = sidecarPath(filePath);
+    std::string temporary = sidecar + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(out.data(), static_cast<std::streamsize>(out.size()))) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temporary, sidecar, ec);
+    return !ec;
+}
+
+std::pair<uint64_t, uint64_t> QueryFileIndex::locateLine(uint64_t lineNumber) const {
+    if (entries.empty() || lineNumber == 0) {
+        return { 0, 1 };
+    }
+    size_t block = std::min<size_t>((lineNumber - 1) / linesPerBlock, entries.size() - 1);
+    return { entries[block].offset, uint64_t(block) * linesPerBlock + 1 };
+}
+
+std::vector<std::pair<size_t, size_t>> QueryFileIndex::blocksForIds(int firstId, int lastId) const {
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].maxId < firstId || entries[i].minId > lastId) {
+            continue;
+        }
+        if (!runs.empty() && runs.back().second == i) {
+            runs.back().second = i + 1;
+        }
+        else {
+            runs.emplace_back(i, i + 1);
+        }
+    }
+    return runs;
+}
+
+std::pair<uint64_t, uint64_t> QueryFileIndex::byteRange(size_t beginBlock, size_t endBlock) const {
+    uint64_t begin = beginBlock < entries.size() ? entries[beginBlock].offset : indexedBytes;
+    uint64_t end = endBlock < entries.size() ? entries[endBlock].offset : indexedBytes;
+    return { begin, end };
+}
@@ -0,0 +1,53 @@
+// Converts a text query file ("id,COMMAND[,priority]" per line) into the compiled binary format.
+// Usage: querycompile <input.txt> <output.qbin>
+#include "query.hpp"
+#include "query_binary.hpp"
+#include "mapped_file.hpp"
+#include "error.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: querycompile <input.txt> <output.qbin>" << std::endl;
+        return 2;
+    }
+    std::string inputPath = argv[1];
+    std::string outputPath = argv[2];
+
+    auto input = MappedFile::open(inputPath);
+    if (!input) {
+        std::cerr << "FATAL [querycompile]: " << input.error().fullMessage() << std::endl;
+        return 1;
+    }
+    CompiledQueryWriter writer;
+    std::string_view remaining = input->view();
+    int lineNumber = 0;
+    int skipped = 0;
+    while (!remaining.empty()) {
+        size_t lineEnd = remaining.find('\n');
+        std::string_view line = remaining.substr(0, lineEnd);
+        remaining.remove_prefix(lineEnd == std::string_view::npos ? remaining.size() : lineEnd + 1);
+        ++lineNumber;
+        auto query = QueryEngine::parseQueryLine(line, lineNumber);
+        if (!query) {
+            std::cerr << "Skipping malformed line " << lineNumber << ": " << query.error().fullMessage() << std::endl;
+            ++skipped;
+            continue;
+        }
+        writer.append(*query);
+    }
+
+    size_t compiled = writer.size();
+    std::string contents = writer.finish();
+    std::ofstream output(outputPath, std::ios::binary | std::ios::trunc);
+    if (!output || !output.write(contents.data(), static_cast<std::streamsize>(contents.size()))) {
+        std::cerr << "FATAL [querycompile]: " << ErrorInfo{ ErrorCode::FileOpenFailed, "Could not write " + outputPath }.fullMessage() << std::endl;
+        return 1;
+    }
+    std::cout << "Compiled " << compiled << " queries (" << skipped << " skipped) from " << inputPath
+        << " into " << outputPath << " (" << contents.size() << " bytes)" << std::endl;
+    return 0;
+}
@@ -1,15 +1,33 @@
 #include "server.hpp"
 #include "query.hpp"
+#include "key_interner.hpp"
+
+static constexpr int deadlineCheckLevels = 16;
+
+QueryResult Server::processCommand(const Query& query, int depth, const QueryDeadline& deadline) {
+    if (depth % deadlineCheckLevels == 0 && deadline.expired()) {
+        return QueryResult{
+            query.id,
+            std::unexpected(ErrorInfo{
+                ErrorCode::QueryTimeout,
+                "Deadline exceeded while processing query ID " + std::to_string(query.id)
+                }),
+            std::chrono::milliseconds(0)
+        };
+    }
 
-QueryResult Server::processCommand(const Query& query, int depth) {
     if (depth > 0) {
-		auto tmp = processCommand(query, depth - 1);
+		auto tmp = processCommand(query, depth - 1, deadline);
         static volatile int sink = 0;
         sink += 1;
 		return tmp;
     }
 
     std::lock_guard<std::mutex> lock(storeMutex);
+    if (keyIndexing == KeyIndexing::INTERNED) {
+        return applyInterned(query);
+    }
+
     QueryResult result;
     result.queryId = query.id;
 
@@ -17,6 +35,7 @@ QueryResult Server::processCommand(const Query& query, int depth) {
         case Query::Type::GET: {
             if (auto it = keyValueStore.find(query.key); it != keyValueStore.end()) {
 				result.result = it->second;
+                result.keyVersion = keyVersions[query.key];
             }
             else {
                 result.result = std::unexpected(ErrorInfo{
@@ -28,11 +47,13 @@ QueryResult Server::processCommand(const Query& query, int depth) {
         }
         case Query::Type::SET: {
             keyValueStore[query.key] = query.value.value_or("");
+            result.keyVersion = keyVersions[query.key] = ++lastVersion;
 			result.result = "SET successful for key '" + query.key + "'";
             break;
         }
         case Query::Type::DELETE: {
             if (keyValueStore.erase(query.key) > 0) {
+                result.keyVersion = keyVersions[query.key] = ++lastVersion;
 				result.result = "DELETE successful for key '" + query.key + "'";
             }
             else {
@@ -45,4 +66,67 @@ QueryResult Server::processCommand(const Query& query, int depth) {
         }
     }
     return result;
+}
+
+QueryResult Server::applyInterned(const Query& query) {
+    // Parsers leave the id unset, so that only a process with an INTERNED store pays for the table
+    uint32_t keyId = query.keyId != KeyInterner::noId ? query.keyId : KeyInterner::shared().intern(query.key);
+    Entry* entry = keyId < entriesById.size() ? &entriesById[keyId] : nullptr;
+
+    QueryResult result;
+    result.queryId = query.id;
+
+    switch (query.type) {
+        case Query::Type::GET: {
+            if (entry && entry->present) {
+                result.result = entry->value;
+                result.keyVersion = entry->version;
+            }
+            else {
+                result.result = std::unexpected(ErrorInfo{
+                    ErrorCode::QueryExecutionError,
+                    "Key not found for GET: '" + query.key + "'"
+                    });
+            }
+            break;
+        }
+        case Query::Type::SET: {
+            if (!entry) {
+                entriesById.resize(static_cast<size_t>(keyId) + 1);
+                entry = &entriesById[keyId];
+            }
+            entry->value = query.value.value_or("");
+            entry->present = true;
+            result.keyVersion = entry->version = ++lastVersion;
+            result.result = "SET successful for key '" + query.key + "'";
+            break;
+        }
+        case Query::Type::DELETE: {
+            if (entry && entry->present) {
+                entry->value.clear();
+                entry->value.shrink_to_fit();
+                entry->present = false;
+                result.keyVersion = entry->version = ++lastVersion;
+                result.result = "DELETE successful for key '" + query.key + "'";
+            }
+            else {
+                result.result = std::unexpected(ErrorInfo{
+                    ErrorCode::QueryExecutionError,
+                    "Key not found for DELETE: '" + query.key + "'"
+                    });
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+uint64_t Server::getKeyVersion(const std::string& key) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (keyIndexing == KeyIndexing::INTERNED) {
+        uint32_t keyId = KeyInterner::shared().find(key);
+        return keyId < entriesById.size() ? entriesById[keyId].version : 0;
+    }
+    auto it = keyVersions.find(key);
+    return it != keyVersions.end() ? it->second : 0;
 }
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "shm_channel.hpp"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+    "futex words must be plain 32-bit integers");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring positions are shared between processes");
+
+namespace {
+
+using Clock = ShmRing::Clock;
+
+constexpr uint32_t wrapMarker = UINT32_MAX; // The rest of the buffer is unused; the record starts at offset 0
+constexpr size_t offsetMask = ShmRing::capacity - 1;
+const char* const regionPrefix = "/kvclient-";
+
+// A record's length field and payload, padded so every record starts 8-byte aligned
+size_t recordSize(size_t length) {
+    return (sizeof(uint32_t) + length + 7) & ~size_t(7);
+}
+
+// Spinning only pays when the peer runs on another CPU meanwhile; on one CPU it just delays the peer
+int spinIterations() {
+    static const int iterations = std::thread::hardware_concurrency() > 1 ? 256 : 0;
+    return iterations;
+}
+
+void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Process-shared futexes: the waiter and the waker live in different processes
+void futexWait(std::atomic<uint32_t>& word, uint32_t expected, Clock::time_point giveUpAt) {
+    timespec timeout{};
+    timespec* relative = nullptr;
+    if (giveUpAt != Clock::time_point::max()) {
+        auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(giveUpAt - Clock::now());
+        if (remaining.count() <= 0) {
+            return;
+        }
+        timeout.tv_sec = static_cast<time_t>(remaining.count() / 1000000000);
+        timeout.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+        relative = &timeout;
+    }
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, relative, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t>& word) {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace
+
+template <typename Ready>
+bool ShmRing::waitUntil(Ready ready, std::atomic<uint32_t>& sleeping, Clock::time_point giveUpAt) {
+    for (int i = 0, spins = spinIterations(); i < spins; ++i) {
+        if (ready()) {
+            return true;
+        }
+        cpuRelax();
+    }
+    while (true) {
+        sleeping.store(1, std::memory_order_relaxed);
+        // Pairs with the fence in wake(): either the peer sees the flag or this check sees its update
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ready()) {
+            sleeping.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        if (isClosed() || Clock::now() >= giveUpAt) {
+            sleeping.store(0, std::memory_order_relaxed);
+            return false;
+        }
+        // Returns at once if the peer has already cleared the flag to wake us
+        futexWait(sleeping, 1, giveUpAt);
+    }
+}
+
+void ShmRing::wake(std::atomic<uint32_t>& sleeping) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed) != 0) {
+        sleeping.store(0, std::memory_order_relaxed);
+        futexWake(sleeping);
+    }
+}
+
+bool ShmRing::write(std::string_view record, Clock::time_point giveUpAt) {
+    if (record.size() > maxRecord) {
+        return false;
+    }
+    uint64_t position = tail.load(std::memory_order_relaxed);
+    size_t offset = position & offsetMask;
+    size_t contiguous = capacity - offset;
+    size_t size = recordSize(record.size());
+    // A record that would straddle the end starts over at offset 0, behind a wrap marker
+    size_t needed = size > contiguous ? contiguous + size : size;
+    auto hasRoom = [&]() { return position + needed - head.load(std::memory_order_acquire) <= capacity; };
+    if (isClosed() || !waitUntil(hasRoom, writerSleeping, giveUpAt)) {
+        return false;
+    }
+    if (size > contiguous) {
+        std::memcpy(data + offset, &wrapMarker, sizeof(wrapMarker));
+        position += contiguous;
+        offset = 0;
+    }
+    uint32_t length = static_cast<uint32_t>(record.size());
+    std::memcpy(data + offset, &length, sizeof(length));
+    std::memcpy(data + offset + sizeof(length), record.data(), record.size());
+    tail.store(position + size, std::memory_order_release);
+    wake(readerSleeping);
+    return true;
+}
+
+std::optional<std::string_view> ShmRing::read(Clock::time_point giveUpAt) {
+    uint64_t position = head.load(std::memory_order_relaxed);
+    auto hasRecord = [&]() { return tail.load(std::memory_order_acquire) != position; };
+    if (isClosed() || !waitUntil(hasRecord, readerSleeping, giveUpAt)) {
+        return std::nullopt;
+    }
+    size_t offset = position & offsetMask;
+    uint32_t length = wrapMarker;
+    if (offset <= capacity - sizeof(length)) {
+        std::memcpy(&length, data + offset, sizeof(length));
+    }
+    if (length == wrapMarker) {
+        position += capacity - offset;
+        offset = 0;
+        std::memcpy(&length, data, sizeof(length));
+    }
+    // The peer writes the length, so it is not trusted to stay inside the buffer
+    if (length > capacity - offset - sizeof(length)) {
+        close();
+        return std::nullopt;
+    }
+    readEnd = position + recordSize(length);
+    return std::string_view(data + offset + sizeof(length), length);
+}
+
+void ShmRing::pop() {
+    head.store(readEnd, std::memory_order_release);
+    wake(writerSleeping);
+}
+
+void ShmRing::close() {
+    closed.store(1, std::memory_order_release);
+    // Clearing the flags first makes a waiter about to call futexWait return at once
+    for (std::atomic<uint32_t>* sleeping : { &readerSleeping, &writerSleeping }) {
+        sleeping->store(0, std::memory_order_seq_cst);
+        futexWake(*sleeping);
+    }
+}
+
+std::expected<std::unique_ptr<ShmRegion>, ErrorInfo> ShmRegion::create() {
+    static std::atomic<uint64_t> nextId{ 0 };
+    std::string name = regionPrefix + std::to_string(::getpid()) + "-" + std::to_string(nextId.fetch_add(1, std::memory_order_relaxed));
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ConnectionFailed, "Failed to create shared memory " + name + ": " + std::strerror(errno) });
+    }
+    void* memory = MAP_FAILED;
+    if (::ftruncate(fd, sizeof(Layout)) == 0) {
+        memory = ::mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int error = errno;
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        ::shm_unlink(name.c_str());
+        return std::unexpected(ErrorInfo{ ErrorCode::ConnectionFailed, "Failed to map shared memory " + name + ": " + std::strerror(error) });
+    }
+    return std::unique_ptr<ShmRegion>(new ShmRegion(std::move(name), new (memory) Layout(), true));
+}
+
+std::expected<std::unique_ptr<ShmRegion>, ErrorInfo> ShmRegion::open(const std::string& name) {
+    // Only regions created by ShmRegion::create, never an arbitrary object a client names
+    if (name.rfind(regionPrefix, 0) != 0 || name.find('/', 1) != std::string::npos) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ConnectionFailed, "Not a client shared memory region: " + name });
+    }
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ConnectionFailed, "Failed to open shared memory " + name + ": " + std::strerror(errno) });
+    }
+    struct stat status {};
+    void* memory = MAP_FAILED;
+    if (::fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) == sizeof(Layout)) {
+        memory = ::mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return std::unexpected(ErrorInfo{ ErrorCode::ConnectionFailed, "Failed to map shared memory " + name });
+    }
+    return std::unique_ptr<ShmRegion>(new ShmRegion(name, std::launder(static_cast<Layout*>(memory)), false));
+}
+
+ShmRegion::~ShmRegion() {
+    ::munmap(layout, sizeof(Layout));
+    unlink();
+}
+
+void ShmRegion::unlink() {
+    if (linked) {
+        ::shm_unlink(regionName.c_str());
+        linked = false;
+    }
+}
+
+void ShmRegion::close() {
+    layout->requests.close();
+    layout->responses.close();
+}
@@ -0,0 +1,188 @@
+#include "worker_pool.hpp"
+#include <algorithm>
+
+namespace {
+    // Strides are inversely proportional to weight; a large numerator keeps integer rounding negligible.
+    constexpr uint64_t strideNumerator = 1u << 20;
+}
+
+WorkerPool::WorkerPool(size_t workerCount, std::vector<unsigned> classWeights) {
+    if (classWeights.empty()) {
+        classWeights.push_back(1);
+    }
+    classes.resize(classWeights.size());
+    for (size_t c = 0; c < classWeights.size(); ++c) {
+        classes[c].stride = strideNumerator / std::max(1u, classWeights[c]);
+    }
+
+    if (workerCount == 0) {
+        workerCount = 1;
+    }
+    workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workQueued.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)>& task, const std::function<size_t(size_t)>& classOf) {
+    if (count == 0) {
+        return;
+    }
+
+    Batch batch{ &task, count };
+
+    // Most batches have a single class and are queued as the plain range [0, count)
+    const size_t lastClass = classes.size() - 1;
+    const size_t firstClass = classOf ? std::min(classOf(0), lastClass) : 0;
+    size_t mixedFrom = count;
+    if (classOf && lastClass > 0) {
+        for (size_t i = 1; i < count; ++i) {
+            if (std::min(classOf(i), lastClass) != firstClass) {
+                mixedFrom = i;
+                break;
+            }
+        }
+    }
+
+    Range single;
+    std::vector<size_t> order;                                        // The indices grouped by class, for a mixed batch
+    std::vector<Range> ranges(mixedFrom < count ? classes.size() : 0); // Each class's run of order
+    if (mixedFrom == count) {
+        single.batch = &batch;
+        single.end = count;
+    }
+    else {
+        // Sorting class * count + index groups by class and keeps submission order within each
+        order.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            order[i] = (i < mixedFrom ? firstClass : std::min(classOf(i), lastClass)) * count + i;
+        }
+        std::sort(order.begin(), order.end());
+        for (size_t k = 0; k < count; ++k) {
+            Range& range = ranges[order[k] / count];
+            order[k] %= count;
+            if (range.batch == nullptr) {
+                range.batch = &batch;
+                range.indices = order.data();
+                range.next.store(k, std::memory_order_relaxed);
+            }
+            range.end = k + 1;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(stateMutex);
+    if (mixedFrom == count) {
+        enqueueLocked(firstClass, single);
+    }
+    else {
+        for (size_t c = 0; c < ranges.size(); ++c) {
+            if (ranges[c].batch != nullptr) {
+                enqueueLocked(c, ranges[c]);
+            }
+        }
+    }
+    wakeWorkers(count);
+
+    // Help out until our own batch is done; the work picked may belong to another caller's batch. The batch, and
+    // the ranges in it, must outlive every thread still taking its indices.
+    while (batch.remaining.load(std::memory_order_acquire) > 0 || batch.users > 0) {
+        if (!runQueuedLocked(lock, &batch)) {
+            batchDone.wait(lock);
+        }
+    }
+}
+
+void WorkerPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    for (;;) {
+        workQueued.wait(lock, [this]() { return stopping || busyClasses.load(std::memory_order_relaxed) > 0; });
+        if (stopping) {
+            return;
+        }
+        runQueuedLocked(lock, nullptr);
+    }
+}
+
+bool WorkerPool::runQueuedLocked(std::unique_lock<std::mutex>& lock, const Batch* own) {
+    SchedulingClass* chosen = nullptr;
+    for (auto& schedulingClass : classes) {
+        if (!schedulingClass.queue.empty() && (chosen == nullptr || schedulingClass.pass < chosen->pass)) {
+            chosen = &schedulingClass;
+        }
+    }
+    if (chosen == nullptr) {
+        return false;
+    }
+
+    globalPass = chosen->pass;
+    chosen->pass += chosen->stride;
+    Range& range = *chosen->queue.front();
+    Batch& batch = *range.batch;
+    ++batch.users;
+    lock.unlock();
+
+    // Alone in the queues, keep taking indices until another class queues work and the stride pick is due again
+    for (;;) {
+        size_t position = range.next.fetch_add(1, std::memory_order_relaxed);
+        if (position >= range.end) {
+            break;
+        }
+        (*batch.task)(range.indices ? range.indices[position] : position);
+        batch.remaining.fetch_sub(1, std::memory_order_acq_rel);
+        if (busyClasses.load(std::memory_order_relaxed) > 1 || (own && own->remaining.load(std::memory_order_relaxed) == 0)) {
+            break;
+        }
+    }
+
+    lock.lock();
+    if (range.next.load(std::memory_order_relaxed) >= range.end) {
+        retireLocked(*chosen, range);
+    }
+    if (--batch.users == 0 && batch.remaining.load(std::memory_order_acquire) == 0) {
+        batchDone.notify_all();
+    }
+    return true;
+}
+
+void WorkerPool::enqueueLocked(size_t classIndex, Range& range) {
+    SchedulingClass& schedulingClass = classes[classIndex];
+    if (schedulingClass.queue.empty()) {
+        // A class that was idle must not bank credit for the time it had nothing queued
+        schedulingClass.pass = std::max(schedulingClass.pass, globalPass);
+        busyClasses.fetch_add(1, std::memory_order_relaxed);
+    }
+    schedulingClass.queue.push_back(&range);
+}
+
+void WorkerPool::retireLocked(SchedulingClass& schedulingClass, Range& range) {
+    // Whoever saw the range run out first has removed it already
+    auto it = std::find(schedulingClass.queue.begin(), schedulingClass.queue.end(), &range);
+    if (it == schedulingClass.queue.end()) {
+        return;
+    }
+    schedulingClass.queue.erase(it);
+    if (schedulingClass.queue.empty()) {
+        busyClasses.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void WorkerPool::wakeWorkers(size_t tasks) {
+    if (tasks >= workers.size()) {
+        workQueued.notify_all();
+        return;
+    }
+    for (size_t i = 0; i < tasks; ++i) {
+        workQueued.notify_one();
+    }
+}